@@ -19,6 +19,9 @@
 #include <config.h>
 #endif /* HAVE_CONFIG_H */
 
+#include <string.h>
+#include <unistd.h>
+
 #include <R.h>
 #include <Rdefines.h>
 #include <Rinternals.h>
@@ -27,215 +30,339 @@
 #include <adaptive-sampling/datatypes.h>
 #include <adaptive-sampling/interface.h>
 
+/******************************************************************************
+ * Options
+ *****************************************************************************/
+
+/* options are passed as a single numeric vector, the order must match
+ * pack.options() in make.options.R */
+enum {
+        OPT_N_MOMENTS = 0,
+        OPT_MODEL_POSTERIOR,
+        OPT_BPROB,
+        OPT_KL_PSI,
+        OPT_KL_MULTIBIN,
+        OPT_EFFECTIVE_COUNTS,
+        OPT_EFFECTIVE_POSTERIOR_COUNTS,
+        OPT_DENSITY,
+        OPT_DENSITY_STEP,
+        OPT_DENSITY_FROM,
+        OPT_DENSITY_TO,
+        OPT_EPSILON,
+        OPT_THREADS,
+        OPT_STACKSIZE,
+        OPT_ALGORITHM,
+        OPT_WHICH,
+        OPT_HMM,
+        OPT_RHO,
+        OPT_PRUNE,
+        OPT_PRUNE_TIES,
+        OPT_BURNIN,
+        OPT_SAMPLES,
+        OPT_COVERAGE,
+        OPT_DENSITY_ACCURACY,
+        OPT_EVENT_MASK,
+        OPT_STATS,
+        OPT_N_LEVELS,
+        /* followed by the levels */
+        OPT_SIZE
+};
+
+/* zero threads use all available processors */
 static
-double getreal(SEXP env, const char* name, size_t n)
+int getThreads(double threads)
 {
-        SEXP ans;
-        double result;
-
-        if(!isEnvironment(env)) {
-                error("should be an environment");
-        }
-        PROTECT(ans = findVar(install(name), env));
-        if(isSymbol(ans) && isNull(TAG(ans))) {
-                error("options entry for %s is null", name);
+#ifdef _SC_NPROCESSORS_ONLN
+        if (threads <= 0) {
+                threads = sysconf(_SC_NPROCESSORS_ONLN);
         }
-        result = REAL(ans)[n];
-        UNPROTECT(1);
-
-        return result;
+#endif
+        return threads < 1 ? 1 : threads;
 }
 
 static
-int getbool(SEXP env, const char* name, size_t n)
+void getOptions(options_t *options, SEXP r_options)
 {
-        SEXP ans;
-        int result;
+        double *opt = REAL(r_options);
+
+        options->n_moments                  = opt[OPT_N_MOMENTS];
+        options->model_posterior            = opt[OPT_MODEL_POSTERIOR];
+        options->bprob                      = opt[OPT_BPROB];
+        options->kl_psi                     = opt[OPT_KL_PSI];
+        options->kl_multibin                = opt[OPT_KL_MULTIBIN];
+        options->effective_counts           = opt[OPT_EFFECTIVE_COUNTS];
+        options->effective_posterior_counts = opt[OPT_EFFECTIVE_POSTERIOR_COUNTS];
+        options->density                    = opt[OPT_DENSITY];
+        options->density_step               = opt[OPT_DENSITY_STEP];
+        options->density_range.from         = opt[OPT_DENSITY_FROM];
+        options->density_range.to           = opt[OPT_DENSITY_TO];
+        options->n_density                  = floor(1.0/options->density_step) + 1;
+        options->epsilon                    = opt[OPT_EPSILON];
+        options->verbose                    = 0;
+        options->prombsTest                 = 0;
+        options->threads                    = getThreads(opt[OPT_THREADS]);
+        options->stacksize                  = opt[OPT_STACKSIZE];
+        options->algorithm                  = opt[OPT_ALGORITHM];
+        options->which                      = opt[OPT_WHICH];
+        options->samples[0]                 = opt[OPT_BURNIN];
+        options->samples[1]                 = opt[OPT_SAMPLES];
+        options->hmm                        = opt[OPT_HMM];
+        options->rho                        = opt[OPT_RHO];
+        options->prune                      = opt[OPT_PRUNE];
+        options->prune_ties                 = opt[OPT_PRUNE_TIES];
+        options->coverage                   = opt[OPT_COVERAGE];
+        options->density_accuracy           = opt[OPT_DENSITY_ACCURACY];
+        options->event_mask                 = opt[OPT_EVENT_MASK];
+        options->stats                      = opt[OPT_STATS];
+        options->n_levels                   = opt[OPT_N_LEVELS];
+        options->levels                     = opt + OPT_SIZE;
+}
 
-        if(!isEnvironment(env)) {
-                error("should be an environment");
-        }
-        PROTECT(ans = findVar(install(name), env));
-        if(isSymbol(ans) && isNull(TAG(ans))) {
-                error("options entry for %s is null", name);
-        }
-        result = LOGICAL(ans)[n];
-        UNPROTECT(1);
+/******************************************************************************
+ * Interrupts
+ *****************************************************************************/
 
-        return result;
+static
+void checkInterrupt_fn(void *dummy)
+{
+        R_CheckUserInterrupt();
 }
 
+/* R_CheckUserInterrupt() does not return if the user pressed Ctrl-C,
+ * which is why it is run in a top-level context */
 static
-void copyMatrixToC(matrix_t* to, SEXP from, size_t rows, size_t columns, size_t offset) {
-        double *r_counts = REAL(from);
-        size_t i, j;
-
-        for (i = 0; i < rows; i++) {
-                for (j = 0; j < columns; j++) {
-                        to->content[i][j] = r_counts[j*columns+i+offset];
-                }
-        }
+int checkInterrupt(void)
+{
+        return !R_ToplevelExec(checkInterrupt_fn, NULL);
 }
 
 static
-void copyVectorToC(vector_t* to, SEXP from, size_t length) {
-        double *r_counts = REAL(from);
-        size_t i;
-
-        for (i = 0; i < length; i++) {
-                to->content[i] = r_counts[i];
-        }
+void beginInterruptible(void)
+{
+        setInterruptHook(checkInterrupt);
 }
 
+/* returns nonzero if the computation was interrupted */
 static
-SEXP copyMatrixToR(matrix_t* from) {
-        SEXP r_matrix;
-        PROTECT(r_matrix = allocMatrix(REALSXP, from->rows, from->columns));
-        double *rp_matrix = REAL(r_matrix);
-        size_t i, j;
+int endInterruptible(void)
+{
+        int result = interruptPending();
 
-        for (i = 0; i < from->rows; i++) {
-                for (j = 0; j < from->columns; j++) {
-                        rp_matrix[j*from->rows+i] = from->content[i][j];
-                }
-        }
-        UNPROTECT(1);
-        return r_matrix;
+        setInterruptHook(NULL);
+
+        return result;
 }
 
+/******************************************************************************
+ * Data
+ *****************************************************************************/
+
+/* The k-th slice of an LxLxK array is a column-major LxL matrix at
+ * offset k*L*L, the views share the memory of the R array. */
 static
-SEXP copyVectorToR(vector_t* from) {
-        SEXP r_vector;
-        PROTECT(r_vector = allocVector(REALSXP, from->size));
-        double *rp_vector = REAL(r_vector);
-        size_t i;
+matrix_view_t** getCountsView(SEXP r_counts, size_t L, size_t K)
+{
+        matrix_view_t** views = (matrix_view_t**)R_alloc(K, sizeof(matrix_view_t*));
+        size_t k;
 
-        for (i = 0; i < from->size; i++) {
-                rp_vector[i] = from->content[i];
+        for (k = 0; k < K; k++) {
+                views[k] = alloc_matrix_view(REAL(r_counts) + k*L*L, L, L, L, MATRIX_COLUMN_MAJOR);
         }
-        UNPROTECT(1);
-        return r_vector;
+        return views;
 }
 
 static
-matrix_t** getCounts(size_t L, size_t K, SEXP r_counts) {
-        matrix_t** counts = (matrix_t**)malloc((K+1)*sizeof(matrix_t*));
+void freeCountsView(matrix_view_t** views, size_t K)
+{
         size_t k;
 
         for (k = 0; k < K; k++) {
-                counts[k] = alloc_matrix(L, L);
-                copyMatrixToC(counts[k], r_counts, L, L, k*L*L);
+                free_matrix_view(views[k]);
         }
-        counts[k] = NULL;
-
-        return counts;
 }
 
 static
-void freeCounts(matrix_t** counts) {
-        size_t i;
-
-        for (i = 0; counts[i]; i++) {
-                free_matrix(counts[i]);
-        }
-        free(counts);
+matrix_view_t* getGammaView(SEXP r_gamma, size_t L)
+{
+        return alloc_matrix_view(REAL(r_gamma), L, L, L, MATRIX_COLUMN_MAJOR);
 }
 
 static
-vector_t* getBeta(SEXP r_beta, size_t L) {
-        vector_t* beta = alloc_vector(L);
+vector_t getBeta(SEXP r_beta)
+{
+        vector_t beta;
 
-        copyVectorToC(beta, r_beta, L);
+        beta.size    = length(r_beta);
+        beta.content = REAL(r_beta);
 
         return beta;
 }
 
 static
-matrix_t* getGamma(SEXP r_gamma, size_t L) {
-        matrix_t* gamma = alloc_matrix(L, L);
-
-        copyMatrixToC(gamma, r_gamma, L, L, 0);
+SEXP copyMatrixToR(matrix_t* from) {
+        SEXP r_matrix;
+        PROTECT(r_matrix = allocMatrix(REALSXP, from->rows, from->columns));
+        double *rp_matrix = REAL(r_matrix);
+        size_t i, j;
 
-        return gamma;
+        for (i = 0; i < from->rows; i++) {
+                for (j = 0; j < from->columns; j++) {
+                        rp_matrix[j*from->rows+i] = from->content[i][j];
+                }
+        }
+        UNPROTECT(1);
+        return r_matrix;
 }
 
 static
-options_t* getOptions(SEXP r_options)
-{
-        options_t* options = (options_t*)malloc(sizeof(options_t));
-
-        options->model_posterior            = getbool(r_options, "model.posterior", 0);
-        options->kl_psi                     = getbool(r_options, "kl.psi", 0);
-        options->kl_multibin                = getbool(r_options, "kl.multibin",  0);
-        options->effective_counts           = getbool(r_options, "effective.counts", 0);
-        options->effective_posterior_counts = getbool(r_options, "effective.posterior.counts", 0);
-        options->bprob                      = getbool(r_options, "bprob", 0);
-        options->density                    = getbool(r_options, "density", 0);
-        options->density_step               = getreal(r_options, "density.step", 0);
-        options->density_range.from         = getreal(r_options, "density.range", 0);
-        options->density_range.to           = getreal(r_options, "density.range", 1);
-        options->n_moments                  = getreal(r_options, "n.moments", 0);
-        options->n_density                  = floor(1.0/options->density_step) + 1;
-        options->epsilon                    = getreal(r_options, "epsilon", 0);
-        options->verbose                    = 0;
-        options->prombsTest                 = 0;
-        options->threads                    = getreal(r_options, "threads", 0);
-        options->stacksize                  = getreal(r_options, "stacksize", 0);
-        options->algorithm                  = getreal(r_options, "algorithm", 0);
-        options->which                      = getreal(r_options, "which", 0);
-        options->samples[0]                 = getreal(r_options, "samples", 0);
-        options->samples[1]                 = getreal(r_options, "samples", 1);
-        options->hmm                        = getbool(r_options, "hmm", 0);
-        options->rho                        = getreal(r_options, "rho", 0);
-
-        return options;
+SEXP copyVectorToR(vector_t* from) {
+        SEXP r_vector;
+        PROTECT(r_vector = allocVector(REALSXP, from->size));
+        memcpy(REAL(r_vector), from->content, from->size*sizeof(double));
+        UNPROTECT(1);
+        return r_vector;
 }
 
-SEXP check_input(
+static
+void checkData(
         SEXP r_counts,
         SEXP r_alpha,
         SEXP r_beta,
-        SEXP r_gamma,
-        SEXP r_options)
+        SEXP r_gamma)
 {
         /* check counts */
         SEXP dim = getAttrib(r_counts, R_DimSymbol);
-        if(length(dim) != 3) {
+        if(!isReal(r_counts) || length(dim) != 3 || INTEGER(dim)[0] != INTEGER(dim)[1]) {
                 error("counts has invalid dimension");
         }
         size_t L = INTEGER(dim)[0];
         size_t K = INTEGER(dim)[2];
         /* check alpha */
         dim = getAttrib(r_alpha, R_DimSymbol);
-        if(length(dim) != 3 || INTEGER(dim)[0] != L || INTEGER(dim)[2] != K) {
+        if(!isReal(r_alpha) || length(dim) != 3 || INTEGER(dim)[0] != L || INTEGER(dim)[1] != L || INTEGER(dim)[2] != K) {
                 error("alpha has invalid dimension");
         }
         /* check beta */
-        if(length(r_beta) != L) {
+        if(!isReal(r_beta) || length(r_beta) != L) {
                 error("beta has invalid dimension");
         }
         /* check gamma */
         dim = getAttrib(r_gamma, R_DimSymbol);
-        if(length(dim) != 2 || INTEGER(dim)[0] != L || INTEGER(dim)[1] != L) {
+        if(!isReal(r_gamma) || length(dim) != 2 || INTEGER(dim)[0] != L || INTEGER(dim)[1] != L) {
                 error("gamma has invalid dimension");
         }
+}
+
+SEXP check_input(
+        SEXP r_counts,
+        SEXP r_alpha,
+        SEXP r_beta,
+        SEXP r_gamma,
+        SEXP r_options)
+{
+        checkData(r_counts, r_alpha, r_beta, r_gamma);
         /* check r_options */
-        if(!isEnvironment(r_options)) {
-                error("options should be an environment");
+        if(!isReal(r_options) || length(r_options) < OPT_SIZE ||
+           length(r_options) != OPT_SIZE + REAL(r_options)[OPT_N_LEVELS]) {
+                error("options should be created by pack.options");
         }
 
         return R_NilValue;
 }
 
+/* Views on the data of a single call, all memory is shared with the
+ * R arrays. */
+typedef struct {
+        size_t L;
+        size_t K;
+        matrix_view_t **counts;
+        matrix_view_t **alpha;
+        vector_t beta;
+        matrix_view_t *gamma;
+} data_view_t;
+
+static
+void getDataView(
+        data_view_t *view,
+        SEXP r_counts,
+        SEXP r_alpha,
+        SEXP r_beta,
+        SEXP r_gamma)
+{
+        SEXP dim = getAttrib(r_counts, R_DimSymbol);
+
+        view->L      = INTEGER(dim)[0];
+        view->K      = INTEGER(dim)[2];
+        view->counts = getCountsView(r_counts, view->L, view->K);
+        view->alpha  = getCountsView(r_alpha,  view->L, view->K);
+        view->beta   = getBeta(r_beta);
+        view->gamma  = getGammaView(r_gamma, view->L);
+}
+
+static
+void freeDataView(data_view_t *view)
+{
+        freeCountsView(view->counts, view->K);
+        freeCountsView(view->alpha,  view->K);
+        free_matrix_view(view->gamma);
+}
+
 /******************************************************************************
  * posterior
  *****************************************************************************/
 
+static
+void defineReal(const char *name, double value, SEXP r_env) {
+        SEXP r_value;
+
+        PROTECT(r_value = ScalarReal(value));
+        defineVar(install(name), r_value, r_env);
+        UNPROTECT(1);
+}
+
+static
+SEXP copyStats(stats_t* stats) {
+        const char *phases[STATS_PHASES] = {
+                "evidence", "coverage", "moments", "density", "bprob", "utility"
+        };
+        SEXP r_names;
+        SEXP r_wall;
+        SEXP r_cpu;
+        SEXP r_result;
+        int i;
+
+        PROTECT(r_result = allocSExp(ENVSXP));
+        PROTECT(r_names  = allocVector(STRSXP,  STATS_PHASES));
+        PROTECT(r_wall   = allocVector(REALSXP, STATS_PHASES));
+        PROTECT(r_cpu    = allocVector(REALSXP, STATS_PHASES));
+
+        for (i = 0; i < STATS_PHASES; i++) {
+                SET_STRING_ELT(r_names, i, mkChar(phases[i]));
+                REAL(r_wall)[i] = stats->wall[i];
+                REAL(r_cpu) [i] = stats->cpu [i];
+        }
+        setAttrib(r_wall, R_NamesSymbol, r_names);
+        setAttrib(r_cpu,  R_NamesSymbol, r_names);
+        defineVar(install("wall"), r_wall, r_result);
+        defineVar(install("cpu"),  r_cpu,  r_result);
+        defineReal("prombs.calls",       stats->prombs_calls,       r_result);
+        defineReal("evaluations",        stats->evaluations,        r_result);
+        defineReal("lngamma.calls",      stats->lngamma_calls,      r_result);
+        defineReal("thread.utilization", stats->thread_utilization, r_result);
+        defineReal("peak.scratch",       stats->peak_scratch,       r_result);
+        UNPROTECT(4);
+
+        return r_result;
+}
+
 static
 SEXP copyPosterior(marginal_t* result) {
         SEXP r_matrix;
         SEXP r_vector;
         SEXP r_result;
+        SEXP r_events;
+        SEXP r_stats;
+        int k;
 
         PROTECT(r_result = allocSExp(ENVSXP));
 
@@ -259,6 +386,41 @@ SEXP copyPosterior(marginal_t* result) {
                 defineVar(install("mpost"), r_vector, r_result);
                 UNPROTECT(1);
         }
+        if (result->coverage) {
+                PROTECT(r_matrix = copyMatrixToR(result->coverage));
+                defineVar(install("coverage"), r_matrix, r_result);
+                UNPROTECT(1);
+        }
+        if (result->density_points) {
+                PROTECT(r_matrix = copyMatrixToR(result->density_points));
+                defineVar(install("density.points"), r_matrix, r_result);
+                UNPROTECT(1);
+        }
+        if (result->quantiles) {
+                PROTECT(r_matrix = copyMatrixToR(result->quantiles));
+                defineVar(install("quantiles"), r_matrix, r_result);
+                UNPROTECT(1);
+        }
+        if (result->hdi) {
+                PROTECT(r_matrix = copyMatrixToR(result->hdi));
+                defineVar(install("hdi"), r_matrix, r_result);
+                UNPROTECT(1);
+        }
+        if (result->event) {
+                PROTECT(r_events = allocVector(VECSXP, result->events));
+                for (k = 0; k < result->events; k++) {
+                        if (result->event[k]) {
+                                SET_VECTOR_ELT(r_events, k, copyPosterior(result->event[k]));
+                        }
+                }
+                defineVar(install("events"), r_events, r_result);
+                UNPROTECT(1);
+        }
+        if (result->stats) {
+                PROTECT(r_stats = copyStats(result->stats));
+                defineVar(install("stats"), r_stats, r_result);
+                UNPROTECT(1);
+        }
         UNPROTECT(1);
 
         return r_result;
@@ -266,6 +428,8 @@ SEXP copyPosterior(marginal_t* result) {
 
 static
 void freePosterior(marginal_t * result) {
+        int k;
+
         if (result->moments) {
                 free_matrix(result->moments);
         }
@@ -278,44 +442,30 @@ void freePosterior(marginal_t * result) {
         if (result->mpost) {
                 free_vector(result->mpost);
         }
+        if (result->coverage) {
+                free_matrix(result->coverage);
+        }
+        if (result->density_points) {
+                free_matrix(result->density_points);
+        }
+        if (result->quantiles) {
+                free_matrix(result->quantiles);
+        }
+        if (result->hdi) {
+                free_matrix(result->hdi);
+        }
+        if (result->event) {
+                for (k = 0; k < result->events; k++) {
+                        if (result->event[k]) {
+                                freePosterior(result->event[k]);
+                        }
+                }
+                free(result->event);
+        }
+        free(result->stats);
         free(result);
 }
 
-static
-marginal_t * callPosterior(
-        SEXP r_counts,
-        SEXP r_alpha,
-        SEXP r_beta,
-        SEXP r_gamma,
-        SEXP r_options) {
-
-        SEXP dim = getAttrib(r_counts, R_DimSymbol);
-        size_t L = INTEGER(dim)[0];
-        size_t K = INTEGER(dim)[2];
-        matrix_t** counts;
-        matrix_t** alpha;
-        vector_t* beta;
-        matrix_t* gamma;
-        options_t* options;
-        marginal_t * result;
-
-        counts  = getCounts(L, K, r_counts);
-        alpha   = getCounts(L, K, r_alpha);
-        beta    = getBeta(r_beta, L);
-        gamma   = getGamma(r_gamma, L);
-        options = getOptions(r_options);
-
-        result  = posterior(K, counts, alpha, beta, gamma, options);
-
-        freeCounts(counts);
-        freeCounts(alpha);
-        free_vector(beta);
-        free_matrix(gamma);
-        free(options);
-
-        return result;
-}
-
 SEXP call_posterior(
         SEXP r_counts,
         SEXP r_alpha,
@@ -323,12 +473,23 @@ SEXP call_posterior(
         SEXP r_gamma,
         SEXP r_options)
 {
+        data_view_t view;
+        options_t options;
         marginal_t *result;
         SEXP r_result;
 
         check_input(r_counts, r_alpha, r_beta, r_gamma, r_options);
 
-        result = callPosterior(r_counts, r_alpha, r_beta, r_gamma, r_options);
+        getOptions(&options, r_options);
+        getDataView(&view, r_counts, r_alpha, r_beta, r_gamma);
+
+        beginInterruptible();
+        result = posteriorView(view.K, view.counts, view.alpha, &view.beta, view.gamma, &options);
+        freeDataView(&view);
+        if (endInterruptible()) {
+                freePosterior(result);
+                error("interrupted");
+        }
         PROTECT(r_result = copyPosterior(result));
         freePosterior(result);
         UNPROTECT(1);
@@ -336,50 +497,113 @@ SEXP call_posterior(
         return r_result;
 }
 
-/******************************************************************************
- * utility
- *****************************************************************************/
-
-static
-utility_t* callUtility(
+/* r_counts is a list of count arrays, elements of r_alpha, r_beta and
+ * r_gamma that are NULL are replaced by the prior of the first data
+ * set */
+SEXP call_posterior_batch(
         SEXP r_counts,
         SEXP r_alpha,
         SEXP r_beta,
         SEXP r_gamma,
-        SEXP r_options) {
+        SEXP r_options)
+{
+        size_t i, n = length(r_counts);
+        data_view_t *view;
+        matrix_view_t ***counts, ***alpha, **gamma;
+        vector_t **beta;
+        options_t options;
+        marginal_t **result;
+        SEXP r_result, r_tmp;
+        int interrupted;
+
+        if (!isNewList(r_counts) || n == 0 ||
+            length(r_alpha) != n || length(r_beta) != n || length(r_gamma) != n) {
+                error("counts and priors should be lists of equal length");
+        }
+        check_input(VECTOR_ELT(r_counts, 0), VECTOR_ELT(r_alpha, 0), VECTOR_ELT(r_beta, 0),
+                    VECTOR_ELT(r_gamma, 0), r_options);
+        for (i = 1; i < n; i++) {
+#define PRIOR(x, i) (isNull(VECTOR_ELT(x, i)) ? VECTOR_ELT(x, 0) : VECTOR_ELT(x, i))
+                checkData(VECTOR_ELT(r_counts, i), PRIOR(r_alpha, i), PRIOR(r_beta, i), PRIOR(r_gamma, i));
+#undef PRIOR
+                if (INTEGER(getAttrib(VECTOR_ELT(r_counts, i), R_DimSymbol))[2] !=
+                    INTEGER(getAttrib(VECTOR_ELT(r_counts, 0), R_DimSymbol))[2]) {
+                        error("all data sets must have the same number of events");
+                }
+        }
+        getOptions(&options, r_options);
+
+        view   = (data_view_t     *)R_alloc(n, sizeof(data_view_t));
+        counts = (matrix_view_t ***)R_alloc(n, sizeof(matrix_view_t **));
+        alpha  = (matrix_view_t ***)R_alloc(n, sizeof(matrix_view_t **));
+        beta   = (vector_t       **)R_alloc(n, sizeof(vector_t *));
+        gamma  = (matrix_view_t  **)R_alloc(n, sizeof(matrix_view_t *));
+
+        /* shared priors are passed as NULL, so that the library can
+         * recognize data sets with the same prior */
+        for (i = 0; i < n; i++) {
+                SEXP dim = getAttrib(VECTOR_ELT(r_counts, i), R_DimSymbol);
+                view[i].L      = INTEGER(dim)[0];
+                view[i].K      = INTEGER(dim)[2];
+                counts[i]      = getCountsView(VECTOR_ELT(r_counts, i), view[i].L, view[i].K);
+                alpha [i]      = NULL;
+                beta  [i]      = NULL;
+                gamma [i]      = NULL;
+                if (!isNull(VECTOR_ELT(r_alpha, i))) {
+                        alpha[i] = getCountsView(VECTOR_ELT(r_alpha, i), view[i].L, view[i].K);
+                }
+                if (!isNull(VECTOR_ELT(r_beta, i))) {
+                        view[i].beta = getBeta(VECTOR_ELT(r_beta, i));
+                        beta[i]      = &view[i].beta;
+                }
+                if (!isNull(VECTOR_ELT(r_gamma, i))) {
+                        gamma[i] = getGammaView(VECTOR_ELT(r_gamma, i), view[i].L);
+                }
+        }
 
-        SEXP dim = getAttrib(r_counts, R_DimSymbol);
-        size_t L = INTEGER(dim)[0];
-        size_t K = INTEGER(dim)[2];
-        matrix_t** counts;
-        matrix_t** alpha;
-        vector_t* beta;
-        matrix_t* gamma;
-        options_t* options;
-        utility_t * result;
-
-        counts  = getCounts(L, K, r_counts);
-        alpha   = getCounts(L, K, r_alpha);
-        beta    = getBeta(r_beta, L);
-        gamma   = getGamma(r_gamma, L);
-        options = getOptions(r_options);
-
-        result  = utility(K, counts, alpha, beta, gamma, options);
-
-        freeCounts(counts);
-        freeCounts(alpha);
-        free_vector(beta);
-        free_matrix(gamma);
-        free(options);
+        beginInterruptible();
+        result = posteriorBatchView(n, view[0].K, counts, alpha, beta, gamma, &options);
+        interrupted = endInterruptible();
 
-        return result;
+        for (i = 0; i < n; i++) {
+                freeCountsView(counts[i], view[i].K);
+                if (alpha[i]) {
+                        freeCountsView(alpha[i], view[i].K);
+                }
+                if (gamma[i]) {
+                        free_matrix_view(gamma[i]);
+                }
+        }
+        if (interrupted) {
+                for (i = 0; i < n; i++) {
+                        freePosterior(result[i]);
+                }
+                free(result);
+                error("interrupted");
+        }
+        PROTECT(r_result = allocVector(VECSXP, n));
+        for (i = 0; i < n; i++) {
+                PROTECT(r_tmp = copyPosterior(result[i]));
+                SET_VECTOR_ELT(r_result, i, r_tmp);
+                UNPROTECT(1);
+                freePosterior(result[i]);
+        }
+        free(result);
+        UNPROTECT(1);
+
+        return r_result;
 }
 
+/******************************************************************************
+ * utility
+ *****************************************************************************/
+
 static
 SEXP copyUtility(utility_t* result) {
         SEXP r_matrix;
         SEXP r_vector;
         SEXP r_result;
+        SEXP r_stats;
 
         PROTECT(r_result = allocSExp(ENVSXP));
 
@@ -393,6 +617,11 @@ SEXP copyUtility(utility_t* result) {
                 defineVar(install("utility"), r_vector, r_result);
                 UNPROTECT(1);
         }
+        if (result->stats) {
+                PROTECT(r_stats = copyStats(result->stats));
+                defineVar(install("stats"), r_stats, r_result);
+                UNPROTECT(1);
+        }
         UNPROTECT(1);
 
         return r_result;
@@ -406,6 +635,14 @@ void freeUtility(utility_t * result) {
         if (result->utility) {
                 free_vector(result->utility);
         }
+        if (result->complete) {
+                free_vector(result->complete);
+        }
+        if (result->batch) {
+                free_vector(result->batch);
+        }
+        free(result->stats);
+        free(result);
 }
 
 SEXP call_utility(
@@ -415,16 +652,73 @@ SEXP call_utility(
         SEXP r_gamma,
         SEXP r_options)
 {
+        data_view_t view;
+        options_t options;
         utility_t* result;
         SEXP r_result;
-        SEXP r_matrix;
 
         check_input(r_counts, r_alpha, r_beta, r_gamma, r_options);
 
-        result = callUtility(r_counts, r_alpha, r_beta, r_gamma, r_options);
+        getOptions(&options, r_options);
+        getDataView(&view, r_counts, r_alpha, r_beta, r_gamma);
+
+        beginInterruptible();
+        result = utilityView(view.K, view.counts, view.alpha, &view.beta, view.gamma, &options);
+        freeDataView(&view);
+        if (endInterruptible()) {
+                freeUtility(result);
+                error("interrupted");
+        }
         PROTECT(r_result = copyUtility(result));
         freeUtility(result);
         UNPROTECT(1);
 
         return r_result;
 }
+
+/* positions (starting at one) of the next q samples, the statistics
+ * are attached as an attribute if requested */
+SEXP call_utility_batch(
+        SEXP r_q,
+        SEXP r_counts,
+        SEXP r_alpha,
+        SEXP r_beta,
+        SEXP r_gamma,
+        SEXP r_options)
+{
+        data_view_t view;
+        options_t options;
+        utility_t* result;
+        SEXP r_result;
+        SEXP r_stats;
+        int i;
+
+        check_input(r_counts, r_alpha, r_beta, r_gamma, r_options);
+
+        if (asInteger(r_q) <= 0) {
+                error("q must be positive");
+        }
+        getOptions(&options, r_options);
+        getDataView(&view, r_counts, r_alpha, r_beta, r_gamma);
+
+        beginInterruptible();
+        result = utilityBatchView(asInteger(r_q), view.K, view.counts, view.alpha, &view.beta, view.gamma, &options);
+        freeDataView(&view);
+        if (endInterruptible()) {
+                freeUtility(result);
+                error("interrupted");
+        }
+        PROTECT(r_result = allocVector(INTSXP, result->batch->size));
+        for (i = 0; i < result->batch->size; i++) {
+                INTEGER(r_result)[i] = (int)result->batch->content[i] + 1;
+        }
+        if (result->stats) {
+                PROTECT(r_stats = copyStats(result->stats));
+                setAttrib(r_result, install("stats"), r_stats);
+                UNPROTECT(1);
+        }
+        freeUtility(result);
+        UNPROTECT(1);
+
+        return r_result;
+}
@@ -25,18 +25,6 @@
 
 #include <adaptive-sampling/prombs.h>
 
-static
-void copyMatrixToC(prob_t** to, SEXP from, size_t L) {
-        double *r_counts = REAL(from);
-        size_t i, j;
-
-        for (i = 0; i < L; i++) {
-                for (j = 0; j < L; j++) {
-                        to[i][j] = r_counts[j*L+i];
-                }
-        }
-}
-
 static
 void copyVectorToC(prob_t* to, SEXP from, size_t L) {
         double *r_counts = REAL(from);
@@ -47,22 +35,6 @@ void copyVectorToC(prob_t* to, SEXP from, size_t L) {
         }
 }
 
-static
-SEXP copyMatrixToR(prob_t** from, size_t L) {
-        SEXP r_matrix;
-        PROTECT(r_matrix = allocMatrix(REALSXP, L, L));
-        double *rp_matrix = REAL(r_matrix);
-        size_t i, j;
-
-        for (i = 0; i < L; i++) {
-                for (j = 0; j < L; j++) {
-                        rp_matrix[j*L+i] = from[i][j];
-                }
-        }
-        UNPROTECT(1);
-        return r_matrix;
-}
-
 static
 SEXP copyVectorToR(prob_t* from, size_t L) {
         SEXP r_vector;
@@ -122,29 +94,6 @@ SEXP check_input(
 }
 
 
-/******************************************************************************
- * tools
- *****************************************************************************/
-
-static __inline__
-prob_t** alloc_prombs_matrix(size_t L) {
-        size_t i;
-        prob_t** m = (prob_t **)malloc(L*sizeof(prob_t*));
-        for (i = 0; i < L; i++) {
-                m[i] = (prob_t *)malloc(L*sizeof(prob_t));
-        }
-        return m;
-}
-
-static __inline__
-void free_prombs_matrix(prob_t** m, size_t L) {
-        size_t i;
-        for (i = 0; i < L; i++) {
-                free(m[i]);
-        }
-        free(m);
-}
-
 /******************************************************************************
  * prombs interface
  *****************************************************************************/
@@ -166,18 +115,16 @@ SEXP call_prombs(
 
         /* copy arguments */
         prob_t* result = (prob_t *)malloc(L*sizeof(prob_t));
-        prob_t*  g     = (prob_t *)malloc(L*sizeof(prob_t));
-        prob_t** f     = alloc_prombs_matrix(L);
+        prob_t* g      = (prob_t *)malloc(L*sizeof(prob_t));
         copyVectorToC(g, r_g, L);
-        copyMatrixToC(f, r_f, L);
 
-        prombs(result, f, g, NULL, L, m, NULL);
+        /* f is read directly from the column-major R matrix */
+        prombs_dense(result, g, REAL(r_f), L, L, m);
 
         PROTECT(r_result = copyVectorToR(result, L));
 
         free(result);
         free(g);
-        free_prombs_matrix(f, L);
 
         UNPROTECT(1);
         return r_result;
@@ -187,26 +134,6 @@ SEXP call_prombs(
  * extended prombs interface
  *****************************************************************************/
 
-typedef struct _data_t_ {
-        const double* f;
-        const double* h;
-        const size_t L;
-} data_t;
-
-prob_t prombs_f(int i, int j, void* _data)
-{
-        data_t* data = (data_t *)_data;
-
-        return data->f[j*data->L+i];
-}
-
-prob_t prombs_h(int i, int j, void* _data)
-{
-        data_t* data = (data_t *)_data;
-
-        return data->h[j*data->L+i];
-}
-
 SEXP call_prombs_extended(
         SEXP r_g,
         SEXP r_f,
@@ -228,19 +155,17 @@ SEXP call_prombs_extended(
         size_t m = INTEGER(r_m)[0] - 1;
 
         /* copy arguments */
-        data_t  data   = { REAL(r_f), REAL(r_h), L };
         prob_t* result = (prob_t *)malloc(L*sizeof(prob_t));
-        prob_t*  g     = (prob_t *)malloc(L*sizeof(prob_t));
-        prob_t** ak    = alloc_prombs_matrix(L);
+        prob_t* g      = (prob_t *)malloc(L*sizeof(prob_t));
         copyVectorToC(g, r_g, L);
 
-        prombsExt(result, ak, g, prombs_f, prombs_h, L, m, &data);
+        /* f and h are read directly from the column-major R matrices */
+        prombsExt_dense(result, g, REAL(r_f), REAL(r_h), L, L, m);
 
         PROTECT(r_result = copyVectorToR(result, L));
 
         free(result);
         free(g);
-        free_prombs_matrix(ak, L);
 
         UNPROTECT(1);
         return r_result;
@@ -45,6 +45,7 @@ def importMatplotlib(backend=None):
 
 import config
 import interface
+import resultfile
 import statistics
 import policy
 
@@ -71,6 +72,10 @@ def usage():
     print "   -m  --density                     - compute full density distribution"
     print "   -r  --density-range=(FROM,TO)     - limit range for the density distribution"
     print "   -s  --density-step=STEP           - step size for the density distribution"
+    print "       --density-accuracy=EPS        - evaluate the density adaptively up to"
+    print "                                       the given L1 error"
+    print "       --levels=P:P:...              - compute quantiles and highest density"
+    print "                                       intervals at the given levels"
     print "       --no-model-posterior           - do not compute the model posterior"
     print "       --epsilon=EPSILON              - epsilon for the extended prombs"
     print "   -n  --samples=N                    - number of samples"
@@ -80,11 +85,21 @@ def usage():
     print "       --mgs-samples=BURN_IN:SAMPLES  - number of samples [default: 100:2000] for mgs"
     print "       --path-iteratin                - use path iteration algorithm instead of backward"
     print "                                        to compute n-step utilities"
+    print "       --batch=Q                      - select Q stimuli per round before any result"
+    print "                                        comes back [default: 1]"
+    print "       --deadline=SECONDS             - bound the utility computation by a wall-clock budget,"
+    print "                                        positions are evaluated in the order of their last"
+    print "                                        utility"
+    print
+    print "       --replicates=R                 - simulate R replicates of the experiment with the"
+    print "                                        ground truth and print the metrics of each trial"
+    print "       --seed=SEED                    - seed of the simulation"
     print
     print "       --port=PORT                    - connect to port from a matlab server for data collection"
     print
     print "       --threads=THREADS              - number of threads [default: 1]"
     print "       --stacksize=BYTES              - thread stack size [default: 256*1024]"
+    print "       --trace=FILE                   - save a Chrome trace of all threads"
     print
     print "       --load=FILE                    - load result from file"
     print "       --save=FILE                    - save result to file"
@@ -103,6 +118,9 @@ def usage():
     print "                                        add the psi divergence"
     print "       --kl-multibin                  - if kl-divergence is selected as strategy then use"
     print "                                        add the multibin divergence"
+    print "       --prune                        - compute the exact kl-divergence only where its"
+    print "                                        upper bound exceeds the best lower bound"
+    print "       --prune-ties                   - same as --prune, but also keep exact ties"
     print
 
 # tools
@@ -146,26 +164,35 @@ def open_msocket():
 # ------------------------------------------------------------------------------
 
 def saveResult(result):
-    config = ConfigParser.ConfigParser()
-    config.add_section('Sampling Result')
-    config.set('Sampling Result', 'counts',    "\n"+"\n".join(map(lambda arg: " ".join(map(str, arg)), result['counts'])))
-    config.set('Sampling Result', 'moments',   "\n"+"\n".join(map(lambda arg: " ".join(map(str, arg)), result['moments'])))
-    config.set('Sampling Result', 'density',   "\n"+"\n".join(map(lambda arg: " ".join(map(str, arg)), result['density'])))
-    config.set('Sampling Result', 'samples',   " ".join(map(str, result['samples'])))
-    config.set('Sampling Result', 'utility',   " ".join(map(str, result['utility'])))
-    config.set('Sampling Result', 'bprob',     " ".join(map(str, result['bprob'])))
-    config.set('Sampling Result', 'mpost',     " ".join(map(str, result['mpost'])))
-    config.set('Sampling Result', 'distances', " ".join(map(str, result['distances'])))
-    config.set('Sampling Result', 'states',    "\n".join(map(str, result['states'])))
-    configfile = open(options['save'], 'wb')
-    config.write(configfile)
-    configfile.close()
+    resultfile.save(options['save'],
+                    [ ('counts',    result['counts']),
+                      ('moments',   result['moments']),
+                      ('density',   result['density']),
+                      ('samples',   result['samples']),
+                      ('utility',   result['utility']),
+                      ('bprob',     result['bprob']),
+                      ('mpost',     result['mpost']),
+                      ('distances', result['distances']),
+                      ('states',    "\n".join(map(str, result['states']))) ])
 
 # load results from file
 # ------------------------------------------------------------------------------
 
 def loadResult():
-    if options['load']:
+    if options['load'] and resultfile.isResultFile(options['load']):
+        arrays = resultfile.load(options['load'])
+        # counts, samples, distances and states are extended by
+        # the sampler and therefore converted to lists
+        result = {
+            'distances' : arrays.get('distances', np.zeros(0)).tolist(),
+            'moments'   : arrays['moments'],
+            'density'   : arrays['density'],
+            'bprob'     : arrays.get('bprob', []),
+            'mpost'     : arrays['mpost'],
+            'counts'    : arrays['counts'].tolist(),
+            'samples'   : arrays['samples'].tolist(),
+            'states'    : [ eval(state) for state in arrays['states'].split('\n') if state != '' ] }
+    elif options['load']:
         config_parser = ConfigParser.RawConfigParser()
         config_parser.read(options['load'])
         if not config_parser.has_section('Sampling Result'):
@@ -226,6 +253,24 @@ def call_utility(counts_v, data, bin_options):
     gamma         = data['gamma']
     return interface.utility(events, counts, alpha, beta, gamma, bin_options)
 
+def call_utilityDeadline(budget, priority, counts_v, data, bin_options):
+    """Call the binning library."""
+    events        = len(counts_v)
+    counts        = statistics.countStatistic(counts_v)
+    alpha         = data['alpha']
+    beta          = data['beta']
+    gamma         = data['gamma']
+    return interface.utilityDeadline(budget, priority, events, counts, alpha, beta, gamma, bin_options)
+
+def call_utilityBatch(q, counts_v, data, bin_options):
+    """Call the binning library."""
+    events        = len(counts_v)
+    counts        = statistics.countStatistic(counts_v)
+    alpha         = data['alpha']
+    beta          = data['beta']
+    gamma         = data['gamma']
+    return interface.utilityBatch(q, events, counts, alpha, beta, gamma, bin_options)
+
 def call_distance(x, y, counts_v, data, bin_options):
     """Call the binning library."""
     events        = len(counts_v)
@@ -321,13 +366,28 @@ def precomputeUtility(counts, data, m, hashutil):
 # main method to compute utilities
 # ------------------------------------------------------------------------------
 
+# last known utility at each position, positions are evaluated in this
+# order if the computation is bounded by a deadline
+last_utility = None
+
+def computeUtilityDeadline(counts, data):
+    global last_utility
+    bin_options = options.copy()
+    if last_utility is None:
+        last_utility = [ float('inf') for i in range(0, len(counts[0])) ]
+    result = call_utilityDeadline(options['deadline'], last_utility, counts, data, bin_options)
+    for i, complete in enumerate(result['complete']):
+        if complete:
+            last_utility[i] = result['utility'][i]
+    return result['utility']
+
 def computeUtility(counts, data):
     bin_options = options.copy()
     hashutil    = {}
-    if options['path_iteration']:
-        # print policy.optimize([1,1,1,1], counts, data, bin_options)
-        # policy.test1(counts, data, bin_options)
-        utility = policy.threaded_u_star(options['look_ahead']+1, counts, data, bin_options)
+    if options['deadline'] and options['look_ahead'] == 0 and not options['path_iteration']:
+        utility = computeUtilityDeadline(counts, data)
+    elif options['path_iteration']:
+        utility = policy.u_star(options['look_ahead']+1, counts, data, bin_options)
     else:
         precomputeUtility(counts, data, options['look_ahead'], hashutil)
         utility = recursiveUtility(counts, data, options['look_ahead'], hashutil)
@@ -360,6 +420,15 @@ def selectItem(counts, data):
         sys.stderr.write(str(utility) + '.\n')
     return selectRandom(argmax(utility)), utility
 
+def selectBatch(counts, data):
+    """Select a block of stimuli that is presented before any result
+    comes back."""
+    if options['batch'] <= 1 or options['strategy'] in ['uniform', 'uniform-random']:
+        index, utility = selectItem(counts, data)
+        return [index], utility
+    result = call_utilityBatch(options['batch'], counts, data, options)
+    return result['batch'], result['utility']
+
 # experiment
 # ------------------------------------------------------------------------------
 
@@ -439,9 +508,12 @@ def sample(result, data):
     if not result['counts']:
         result['counts'] = [ list(np.repeat(0, data['L'])),
                              list(np.repeat(0, data['L'])) ]
+    batch = []
     for i in range(0, options['samples']):
         print >> sys.stderr, "Sampling... %.1f%%" % ((float(i)+1)/float(options['samples'])*100)
-        index, utility = selectItem(result['counts'], data)
+        if not batch:
+            batch, utility = selectBatch(result['counts'], data)
+        index = batch.pop(0)
         event = experiment(index, data, result, msocket)
         # compute Kullback-Leibler distance for the new sample
         if options['distances']:
@@ -463,6 +535,28 @@ def sample(result, data):
         close_msocket(msocket)
     return bin_result
 
+# simulation
+# ------------------------------------------------------------------------------
+
+def simulate(data):
+    """Run replicates of the sampling experiment with the ground truth
+    in the library and print the metrics of each trial."""
+    strategies = { 'uniform'        : 0,
+                   'uniform-random' : 1 }
+    strategy   = strategies.get(options['strategy'], 2)
+    seed       = options['seed']
+    if seed is None:
+        seed = random.randint(0, 2**31-1)
+    result = interface.simulate(options['replicates'], options['samples'], data['gt'],
+                                options['lapsing'], strategy, seed, data['K'],
+                                data['alpha'], data['beta'], data['gamma'], options)
+    print "# seed: %d" % seed
+    print "# replicate trial stimulus event kl mean variance"
+    for r in range(0, options['replicates']):
+        for t in range(0, options['samples']):
+            print r, t, int(result['stimulus'][r][t]), int(result['event'][r][t]), \
+                result['kl'][r][t], result['mean'][r][t], result['variance'][r][t]
+
 # parse config
 # ------------------------------------------------------------------------------
 
@@ -489,6 +583,9 @@ def parseConfig(config_file):
         data['alpha'], data['beta'], data['gamma'] = \
             config.getParameters(config_parser, 'Ground Truth', os.path.dirname(config_file), data['K'], data['L'])
         config.readStrategy(config_parser, 'Ground Truth', options)
+        if options['replicates']:
+            simulate(data)
+            return
         result = loadResult()
         if not result['states']:
             result['states'] = config.readSeeds(config_parser, 'Ground Truth', 'seeds')
@@ -527,13 +624,22 @@ def parseConfig(config_file):
 options = {
     'samples'                    : 0,
     'look_ahead'                 : 0,
+    'batch'                      : 1,
+    'deadline'                   : None,
+    'replicates'                 : 0,
+    'seed'                       : None,
     'epsilon'                    : 0.00001,
     'n_moments'                  : 2,
     'mgs_samples'                : (100,2000),
     'density'                    : 0,
     'density_step'               : 0.01,
+    'density_accuracy'           : 0.0,
+    'levels'                     : [],
     'density_range'              : (0.0,1.0),
     'which'                      : 0,
+    'events'                     : [],
+    'stats'                      : False,
+    'trace'                      : None,
     'lapsing'                    : 0.0,
     'threads'                    : 1,
     'stacksize'                  : 256*1024,
@@ -559,7 +665,10 @@ options = {
     'distances'                  : False,
     'hmm'                        : False,
     'path_iteration'             : False,
-    'rho'                        : 0.4
+    'rho'                        : 0.4,
+    'prune'                      : False,
+    'prune_ties'                 : False,
+    'coverage'                   : False
     }
 
 def main():
@@ -567,10 +676,12 @@ def main():
     try:
         longopts   = ["help", "verbose", "load=", "save=", "density", "density-range=",
                       "density-step=", "which=", "epsilon=", "moments", "look-ahead=",
+                      "density-accuracy=", "levels=",
                       "savefig=", "lapsing=", "port=", "threads=", "stacksize=",
                       "strategy=", "kl-psi", "kl-multibin", "algorithm=", "samples=",
                       "mgs-samples", "no-model-posterior", "video=", "hmm", "rho=",
-                      "path-iteration", "distances" ]
+                      "path-iteration", "distances", "batch=", "prune", "prune-ties",
+                      "deadline=", "replicates=", "seed=", "trace=" ]
         opts, tail = getopt.getopt(sys.argv[1:], "mr:s:k:n:bhvt", longopts)
     except getopt.GetoptError:
         usage()
@@ -593,6 +704,10 @@ def main():
             options['density_range'] = tuple(map(float, a[1:-1].split(',')))
         if o in ("-s", "--density-step"):
             options["density_step"] = float(a)
+        if o == "--density-accuracy":
+            options["density_accuracy"] = float(a)
+        if o == "--levels":
+            options["levels"] = map(float, a.split(":"))
         if o in ("-k", "--moments"):
             if int(a) >= 2:
                 options["n_moments"] = int(a)
@@ -632,6 +747,8 @@ def main():
             else:
                 usage()
                 return 0
+        if o == "--trace":
+            options["trace"] = a
         if o == "--stacksize":
             if int(a) >= 1:
                 options["stacksize"] = int(a)
@@ -652,11 +769,39 @@ def main():
             options["rho"] = float(a)
         if o == "--path-iteration":
             options["path_iteration"] = True
+        if o == "--prune":
+            options["prune"] = True
+        if o == "--prune-ties":
+            options["prune"] = True
+            options["prune_ties"] = True
+        if o == "--deadline":
+            if float(a) > 0:
+                options["deadline"] = float(a)
+            else:
+                usage()
+                return 0
+        if o == "--replicates":
+            if int(a) >= 1:
+                options["replicates"] = int(a)
+            else:
+                usage()
+                return 0
+        if o == "--seed":
+            options["seed"] = int(a)
+        if o == "--batch":
+            if int(a) >= 1:
+                options["batch"] = int(a)
+            else:
+                usage()
+                return 0
     if (options["strategy"] == "kl-divergence" and
         options["kl_psi"]   == False           and
         options["kl_multibin"]  == False):
        # set default kl divergence
        options["kl_psi"]   = True
+    if options["path_iteration"] and options["look_ahead"] > 0 and not options["hmm"]:
+        sys.stderr.write("Path iteration requires --hmm.\n")
+        return 1
     if options["strategy"] == "effective-counts":
         options["effective_counts"] = True
     if options["strategy"] == "effective-posterior-counts":
@@ -665,7 +810,11 @@ def main():
         usage()
         return 1
     interface.init(options['epsilon'])
+    if options['trace']:
+        interface.traceStart()
     parseConfig(tail[0])
+    if options['trace']:
+        interface.traceStop(options['trace'])
     interface.free()
     return 0
 
@@ -34,6 +34,7 @@ def importMatplotlib(backend=None):
 
 import config
 import interface
+import resultfile
 import statistics
 
 # global options
@@ -56,7 +57,13 @@ def usage():
     print "   -m  --density                     - compute full density distribution"
     print "   -r  --density-range=(FROM,TO)     - limit range for the density distribution"
     print "   -s  --density-step=STEP           - step size for the density distribution"
+    print "       --density-accuracy=EPS        - evaluate the density adaptively up to"
+    print "                                       the given L1 error"
+    print "       --levels=P:P:...              - compute quantiles and highest density"
+    print "                                       intervals at the given levels"
     print "       --no-model-posterior          - do not compute the model posterior"
+    print "       --stats                       - print timers and work counters"
+    print "       --trace=FILE                  - save a Chrome trace of all threads"
     print "       --epsilon=EPSILON             - epsilon for the extended prombs"
     print "   -k  --moments=N                   - compute the first N>=2 moments"
     print "       --which=EVENT                 - for which event to compute the binning"
@@ -79,6 +86,14 @@ def usage():
 # ------------------------------------------------------------------------------
 
 def load_config():
+    if resultfile.isResultFile(options['load']):
+        arrays = resultfile.load(options['load'])
+        result = {
+            'moments'   : arrays['moments'],
+            'density'   : arrays['density'],
+            'bprob'     : arrays.get('bprob', []),
+            'mpost'     : arrays['mpost'] }
+        return result
     config_parser = ConfigParser.RawConfigParser()
     config_parser.read(options['load'])
     if not config_parser.has_section('Result'):
@@ -107,53 +122,43 @@ def call_posterior(counts, alpha, beta, gamma):
         return load_config()
     else:
         events = len(counts)
-        return interface.posterior(events, counts, alpha, beta, gamma, options)
+        result = interface.posterior(events, counts, alpha, beta, gamma, options)
+        if result['stats']:
+            printStats(result['stats'])
+        return result
+
+def printStats(stats):
+    """Print timers and work counters to stderr."""
+    for phase in interface.STATS_PHASES:
+        if stats['wall'][phase] > 0.0:
+            sys.stderr.write("%-10s: %.3fs wall, %.3fs cpu\n" % (phase, stats['wall'][phase], stats['cpu'][phase]))
+    sys.stderr.write("prombs    : %d calls, %d interval evaluations, %d lngamma calls\n" %
+                     (stats['prombs_calls'], stats['evaluations'], stats['lngamma_calls']))
+    sys.stderr.write("threads   : %.1f%% utilization\n" % (100.0*stats['thread_utilization']))
+    sys.stderr.write("scratch   : %d bytes peak\n" % stats['peak_scratch'])
 
 # save result
 # ------------------------------------------------------------------------------
 
 def saveResult(result):
-    config = ConfigParser.ConfigParser()
-    config.add_section('Result')
-    config.set('Result', 'moments', "\n"+"\n".join(map(lambda arg: " ".join(map(str, arg)), result['moments'])))
-    config.set('Result', 'density', "\n"+"\n".join(map(lambda arg: " ".join(map(str, arg)), result['density'])))
-    config.set('Result', 'bprob',   " ".join(map(str, result['bprob'])))
-    config.set('Result', 'mpost',   " ".join(map(str, result['mpost'])))
-    configfile = open(options['save'], 'wb')
-    config.write(configfile)
+    resultfile.save(options['save'],
+                    [ ('moments', result['moments']),
+                      ('density', result['density']),
+                      ('bprob',   result['bprob']),
+                      ('mpost',   result['mpost']) ])
 
 # parse config file
 # ------------------------------------------------------------------------------
 
-def computeFailures(successes, trials):
-    N        = len(successes)
-    failures = np.repeat(trials, N) - successes
-    if any([ a<0 for a in failures]):
-        raise ValueError("Number of trials is smaller than some counts.")
-    return failures
-
-def timingsToCounts(timings, binsize, srange):
-    if srange == None:
-        MIN   = min(map(min, timings))
-        MAX   = max(map(max, timings))
-    else:
-        MIN   = srange[0]
-        MAX   = srange[1]
-    N         = int(math.ceil(float(MAX-MIN)/binsize))
-    successes = list(np.repeat(0, N+1))
-    x         = range(MIN, MAX+binsize, binsize)
-    for trial in timings:
-        for t in trial:
-            n = int(math.ceil(float(t-MIN)/binsize))
-            successes[n] += 1
-    trials    = len(timings)
-    failures  = computeFailures(successes, trials)
-    counts    = [successes, failures]
-    return x, statistics.countStatistic(counts)
+def readTimings(config_file):
+    config_parser = ConfigParser.RawConfigParser()
+    config_parser.read(config_file)
+    return config.readMatrix(config_parser, 'Trials', 'timings', int)
 
 def parseConfig(config_file):
+    # counts and timings are streamed by the library
     config_parser = ConfigParser.RawConfigParser()
-    config_parser.read(config_file)
+    config.readConfig(config_parser, config_file, ['counts', 'timings'])
 
     if config_parser.sections() == []:
         raise IOError("Invalid configuration file.")
@@ -161,7 +166,7 @@ def parseConfig(config_file):
         config.readVisualization(config_parser, 'Counts', os.path.dirname(config_file), options)
         config.readAlgorithm(config_parser, 'Counts', os.path.dirname(config_file), options)
         config.readMgsSamples(config_parser, 'Counts', os.path.dirname(config_file), options)
-        counts = config.readCounts(config_parser, 'Counts')
+        counts, _ = interface.countsFromConfig(config_file, 'Counts')
         K, L   = len(counts), len(counts[0])
         alpha, beta, gamma = config.getParameters(config_parser, 'Counts', os.path.dirname(config_file), K, L)
         result = call_posterior(counts, alpha, beta, gamma)
@@ -183,11 +188,8 @@ def parseConfig(config_file):
         config.readAlgorithm(config_parser, 'Trials', os.path.dirname(config_file), options)
         config.readMgsSamples(config_parser, 'Trials', os.path.dirname(config_file), options)
         binsize   = config_parser.getint('Trials', 'binsize')
-        timings   = config.readMatrix(config_parser, 'Trials', 'timings', int)
-        srange    = None
-        if config_parser.has_option('Trials', 'range'):
-            srange = config.readVector(config_parser, 'Trials', 'range', int)
-        x, counts = timingsToCounts(timings, binsize, srange)
+        counts, srange = interface.countsFromConfig(config_file, 'Trials')
+        x         = range(int(srange[0]), int(srange[1])+binsize, binsize)
         K, L   = len(counts), len(counts[0])
         alpha, beta, gamma = config.getParameters(config_parser, 'Trials', os.path.dirname(config_file), K, L)
         result    = call_posterior(counts, alpha, beta, gamma)
@@ -197,11 +199,13 @@ def parseConfig(config_file):
             if options['savefig']:
                 importMatplotlib('Agg')
                 from matplotlib.pyplot import savefig
+                timings = readTimings(config_file)
                 vis.plotBinningSpikes(x, timings, result, options)
                 savefig(options['savefig'], bbox_inches='tight', pad_inches=0)
             else:
                 importMatplotlib()
                 from matplotlib.pyplot import show
+                timings = readTimings(config_file)
                 vis.plotBinningSpikes(x, timings, result, options)
                 show()
 
@@ -213,9 +217,14 @@ options = {
     'mgs_samples'          : (100,2000),
     'density'              : 0,
     'density_step'         : 0.01,
+    'density_accuracy'     : 0.0,
+    'levels'               : [],
     'density_range'        : (0.0,1.0),
     'n_moments'            : 2,
     'which'                : 0,
+    'events'               : [],
+    'stats'                : False,
+    'trace'                : None,
     'threads'              : 1,
     'stacksize'            : 256*1024,
     'algorithm'            : 'prombs',
@@ -234,16 +243,20 @@ options = {
     'effective_posterior_counts' : False,
     'model_posterior'      : True,
     'hmm'                  : False,
-    'rho'                  : 0.4
+    'rho'                  : 0.4,
+    'prune'                : False,
+    'prune_ties'           : False,
+    'coverage'             : False
     }
 
 def main():
     global options
     try:
-        longopts   = ["help", "verbose", "load=", "save=", "density", "density-range:"
+        longopts   = ["help", "verbose", "load=", "save=", "density", "density-range=",
                       "density-step=", "which=", "epsilon=", "moments=", "prombsTest",
+                      "density-accuracy=", "levels=",
                       "savefig=", "threads=", "stacksize=", "algorithm=",
-                      "mgs-samples=", "no-model-posterior", "hmm", "rho="]
+                      "mgs-samples=", "no-model-posterior", "hmm", "rho=", "stats", "trace="]
         opts, tail = getopt.getopt(sys.argv[1:], "mr:s:k:bhvt", longopts)
     except getopt.GetoptError:
         usage()
@@ -262,6 +275,14 @@ def main():
             options['density_range'] = tuple(map(float, a[1:-1].split(',')))
         if o in ("-s", "--density-step"):
             options["density_step"] = float(a)
+        if o == "--density-accuracy":
+            options["density_accuracy"] = float(a)
+        if o == "--levels":
+            options["levels"] = map(float, a.split(":"))
+        if o == "--stats":
+            options["stats"] = True
+        if o == "--trace":
+            options["trace"] = a
         if o in ("-k", "--moments"):
             if int(a) >= 2:
                 options["n_moments"] = int(a)
@@ -309,7 +330,11 @@ def main():
         usage()
         return 1
     interface.init(options['epsilon'])
+    if options['trace']:
+        interface.traceStart()
     parseConfig(tail[0])
+    if options['trace']:
+        interface.traceStop(options['trace'])
     interface.free()
     return 0
 
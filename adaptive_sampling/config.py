@@ -30,6 +30,35 @@ from interface import get_huge_val
 ## functions for reading config options
 ################################################################################
 
+class DataFilter(object):
+    """File object that drops the multi-line values of the given
+    options, which are streamed by the library instead of being stored
+    by ConfigParser."""
+    def __init__(self, fp, options):
+        self.fp       = fp
+        self.options  = options
+        self.skipping = False
+    def readline(self):
+        while True:
+            line = self.fp.readline()
+            if line == '' or not self.skipping or not line[0] in ' \t':
+                break
+        self.skipping = False
+        m = re.match(r'([^:=\s][^:=]*)[:=]', line)
+        if m and m.group(1).strip().lower() in self.options:
+            self.skipping = True
+            line = m.group(0) + '\n'
+        return line
+    def __iter__(self):
+        return iter(self.readline, '')
+
+def readConfig(config_parser, config_file, options):
+    """Read a configuration file without the values of options that
+    are read by the library."""
+    fp = open(config_file, 'r')
+    config_parser.readfp(DataFilter(fp, options), config_file)
+    fp.close()
+
 def readVector(config, section, option, converter):
     vector_str = config.get(section, option)
     vector_str.strip()
@@ -138,13 +167,7 @@ def generate_gamma(num_models):
     return np.triu(gamma)
 
 def generate_counts(events):
-    K = len(events)
-    L = len(events[0])
-    ones   = np.ones(L, dtype=float)
-    counts = np.zeros([K, L, L])
-    for k in range(0, K):
-        counts[k] = np.triu(np.outer(ones,events[k])).cumsum(axis=1)
-    return counts
+    return statistics.countStatistic(events)
 
 ## read additional scripts
 ################################################################################
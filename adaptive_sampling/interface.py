@@ -57,6 +57,13 @@ class MATRIX(Structure):
                  ("columns", c_int),
                  ("content", POINTER(POINTER(c_double)))]
 
+class MATRIX_VIEW(Structure):
+     _fields_ = [("rows",    c_int),
+                 ("columns", c_int),
+                 ("stride",  c_int),
+                 ("layout",  c_int),
+                 ("data",    POINTER(c_double))]
+
 class DENSITY_RANGE(Structure):
      _fields_ = [("from", c_float),
                  ("to",   c_float)]
@@ -82,7 +89,15 @@ class OPTIONS(Structure):
                  ("n_density",            c_int),
                  ("model_posterior",      c_int),
                  ("hmm",                  c_int),
-                 ("rho",                  c_float)]
+                 ("rho",                  c_float),
+                 ("prune",                c_int),
+                 ("prune_ties",           c_int),
+                 ("coverage",             c_int),
+                 ("density_accuracy",     c_float),
+                 ("n_levels",             c_int),
+                 ("levels",               POINTER(c_double)),
+                 ("event_mask",           c_int),
+                 ("stats",                c_int)]
      def __init__(self, options):
           self.which                = c_int(options["which"])
           self.threads              = c_int(options["threads"])
@@ -106,6 +121,16 @@ class OPTIONS(Structure):
           self.model_posterior      = c_int(1) if options["model_posterior"]   else c_int(0)
           self.hmm                  = c_int(1) if options["hmm"]   else c_int(0)
           self.rho                  = c_float(options["rho"])
+          self.prune                = c_int(1) if options["prune"]      else c_int(0)
+          self.prune_ties           = c_int(1) if options["prune_ties"] else c_int(0)
+          self.coverage             = c_int(1) if options["coverage"]   else c_int(0)
+          self.density_accuracy     = c_float(options["density_accuracy"])
+          # the array of levels must live as long as the structure
+          self._levels              = (c_double*len(options["levels"]))(*options["levels"])
+          self.n_levels             = c_int(len(options["levels"]))
+          self.levels               = cast(self._levels, POINTER(c_double))
+          self.event_mask           = c_int(sum([ 1 << k for k in options["events"] ]))
+          self.stats                = c_int(1) if options["stats"] else c_int(0)
           if options["algorithm"] == "prombs":
                self.algorithm = c_int(0)
           elif options["algorithm"] == "mgs":
@@ -113,16 +138,46 @@ class OPTIONS(Structure):
           else:
                raise IOError("Unknown algorithm.")
 
+# phases of a computation in the order of the library
+STATS_PHASES = ['evidence', 'coverage', 'moments', 'density', 'bprob', 'utility']
+
+class STATS(Structure):
+     _fields_ = [("wall",               len(STATS_PHASES)*c_double),
+                 ("cpu",                len(STATS_PHASES)*c_double),
+                 ("prombs_calls",       c_double),
+                 ("evaluations",        c_double),
+                 ("lngamma_calls",      c_double),
+                 ("thread_utilization", c_double),
+                 ("peak_scratch",       c_double)]
+
 class POSTERIOR(Structure):
-     _fields_ = [("moments",   POINTER(MATRIX)),
-                 ("density",   POINTER(MATRIX)),
-                 ("bprob",     POINTER(VECTOR)),
-                 ("mpost",     POINTER(VECTOR)),
-                 ("utility",   POINTER(VECTOR))]
+     pass
+
+POSTERIOR._fields_ = [("moments",   POINTER(MATRIX)),
+                      ("density",   POINTER(MATRIX)),
+                      ("bprob",     POINTER(VECTOR)),
+                      ("mpost",     POINTER(VECTOR)),
+                      ("coverage",  POINTER(MATRIX)),
+                      ("density_points", POINTER(MATRIX)),
+                      ("quantiles", POINTER(MATRIX)),
+                      ("hdi",       POINTER(MATRIX)),
+                      ("events",    c_int),
+                      ("event",     POINTER(POINTER(POSTERIOR))),
+                      ("stats",     POINTER(STATS))]
 
 class UTILITY(Structure):
      _fields_ = [("expectation", POINTER(MATRIX)),
-                 ("utility",     POINTER(VECTOR))]
+                 ("utility",     POINTER(VECTOR)),
+                 ("complete",    POINTER(VECTOR)),
+                 ("batch",       POINTER(VECTOR)),
+                 ("stats",       POINTER(STATS))]
+
+class SIMULATION(Structure):
+     _fields_ = [("stimulus", POINTER(MATRIX)),
+                 ("event",    POINTER(MATRIX)),
+                 ("kl",       POINTER(MATRIX)),
+                 ("mean",     POINTER(MATRIX)),
+                 ("variance", POINTER(MATRIX))]
 
 # function prototypes
 # ------------------------------------------------------------------------------
@@ -139,6 +194,12 @@ _lib._free_vector.argtypes   = [POINTER(VECTOR)]
 _lib._free_matrix.restype    = None
 _lib._free_matrix.argtypes   = [POINTER(MATRIX)]
 
+_lib._alloc_matrix_view.restype  = POINTER(MATRIX_VIEW)
+_lib._alloc_matrix_view.argtypes = [POINTER(c_double), c_int, c_int, c_int, c_int]
+
+_lib._free_matrix_view.restype   = None
+_lib._free_matrix_view.argtypes  = [POINTER(MATRIX_VIEW)]
+
 _lib._free.restype           = None
 _lib._free.argtypes          = [POINTER(None)]
 
@@ -157,43 +218,222 @@ _lib.gsl_sf_choose.argtype   = [c_uint, c_uint]
 _lib.gsl_sf_lnchoose.restype = c_double
 _lib.gsl_sf_lnchoose.argtype = [c_uint, c_uint]
 
+_lib.traceStart.restype      = None
+_lib.traceStart.argtypes     = [c_int]
+
+_lib.traceStop.restype       = c_int
+_lib.traceStop.argtypes      = [c_char_p]
+
+PROGRESS_HOOK = CFUNCTYPE(c_int, c_char_p, c_size_t, c_size_t)
+
+_lib.setProgressHook.restype   = None
+_lib.setProgressHook.argtypes  = [PROGRESS_HOOK]
+
+_lib.setCancelled.restype      = None
+_lib.setCancelled.argtypes     = [c_int]
+
+_lib.interruptPending.restype  = c_int
+_lib.interruptPending.argtypes = []
+
 _lib.posterior.restype       = POINTER(POSTERIOR)
 _lib.posterior.argtypes      = [c_int, POINTER(POINTER(MATRIX)), POINTER(POINTER(MATRIX)), POINTER(VECTOR), POINTER(MATRIX), POINTER(OPTIONS)]
 
+_lib.posteriorView.restype   = POINTER(POSTERIOR)
+_lib.posteriorView.argtypes  = [c_int, POINTER(POINTER(MATRIX_VIEW)), POINTER(POINTER(MATRIX_VIEW)), POINTER(VECTOR), POINTER(MATRIX_VIEW), POINTER(OPTIONS)]
+
+_lib.posteriorBatchView.restype  = POINTER(POINTER(POSTERIOR))
+_lib.posteriorBatchView.argtypes = [c_int, c_int, POINTER(POINTER(POINTER(MATRIX_VIEW))), POINTER(POINTER(POINTER(MATRIX_VIEW))), POINTER(POINTER(VECTOR)), POINTER(POINTER(MATRIX_VIEW)), POINTER(OPTIONS)]
+
 _lib.utility.restype         = POINTER(UTILITY)
 _lib.utility.argtypes        = [c_int, POINTER(POINTER(MATRIX)), POINTER(POINTER(MATRIX)), POINTER(VECTOR), POINTER(MATRIX), POINTER(OPTIONS)]
 
+_lib.utilityDeadline.restype = POINTER(UTILITY)
+_lib.utilityDeadline.argtypes = [c_double, POINTER(VECTOR), c_int, POINTER(POINTER(MATRIX)), POINTER(POINTER(MATRIX)), POINTER(VECTOR), POINTER(MATRIX), POINTER(OPTIONS)]
+
+_lib.utilityView.restype     = POINTER(UTILITY)
+_lib.utilityView.argtypes    = [c_int, POINTER(POINTER(MATRIX_VIEW)), POINTER(POINTER(MATRIX_VIEW)), POINTER(VECTOR), POINTER(MATRIX_VIEW), POINTER(OPTIONS)]
+
+_lib.utilityDeadlineView.restype  = POINTER(UTILITY)
+_lib.utilityDeadlineView.argtypes = [c_double, POINTER(VECTOR), c_int, POINTER(POINTER(MATRIX_VIEW)), POINTER(POINTER(MATRIX_VIEW)), POINTER(VECTOR), POINTER(MATRIX_VIEW), POINTER(OPTIONS)]
+
 _lib.utilityAt.restype       = POINTER(VECTOR)
 _lib.utilityAt.argtypes      = [c_int, c_int, POINTER(POINTER(MATRIX)), POINTER(POINTER(MATRIX)), POINTER(VECTOR), POINTER(MATRIX), POINTER(OPTIONS)]
 
+_lib.utilityAtView.restype   = POINTER(VECTOR)
+_lib.utilityAtView.argtypes  = [c_int, c_int, POINTER(POINTER(MATRIX_VIEW)), POINTER(POINTER(MATRIX_VIEW)), POINTER(VECTOR), POINTER(MATRIX_VIEW), POINTER(OPTIONS)]
+
+_lib.utilityBatch.restype    = POINTER(UTILITY)
+_lib.utilityBatch.argtypes   = [c_int, c_int, POINTER(POINTER(MATRIX)), POINTER(POINTER(MATRIX)), POINTER(VECTOR), POINTER(MATRIX), POINTER(OPTIONS)]
+
+_lib.utilityBatchView.restype   = POINTER(UTILITY)
+_lib.utilityBatchView.argtypes  = [c_int, c_int, POINTER(POINTER(MATRIX_VIEW)), POINTER(POINTER(MATRIX_VIEW)), POINTER(VECTOR), POINTER(MATRIX_VIEW), POINTER(OPTIONS)]
+
+_lib.utilityPath.restype     = POINTER(VECTOR)
+_lib.utilityPath.argtypes    = [c_int, c_int, POINTER(POINTER(MATRIX)), POINTER(POINTER(MATRIX)), POINTER(VECTOR), POINTER(MATRIX), POINTER(OPTIONS)]
+
+_lib.utilityPathView.restype    = POINTER(VECTOR)
+_lib.utilityPathView.argtypes   = [c_int, c_int, POINTER(POINTER(MATRIX_VIEW)), POINTER(POINTER(MATRIX_VIEW)), POINTER(VECTOR), POINTER(MATRIX_VIEW), POINTER(OPTIONS)]
+
 _lib.distance.restype        = c_double
 _lib.distance.argtypes       = [c_int, c_int, c_int, POINTER(POINTER(MATRIX)), POINTER(POINTER(MATRIX)), POINTER(VECTOR), POINTER(MATRIX), POINTER(OPTIONS)]
 
+_lib.simulate.restype        = POINTER(SIMULATION)
+_lib.simulate.argtypes       = [c_int, c_int, POINTER(VECTOR), c_double, c_int, c_ulong, c_int, POINTER(POINTER(MATRIX)), POINTER(VECTOR), POINTER(MATRIX), POINTER(OPTIONS)]
+
+_lib.simulateView.restype    = POINTER(SIMULATION)
+_lib.simulateView.argtypes   = [c_int, c_int, POINTER(VECTOR), c_double, c_int, c_ulong, c_int, POINTER(POINTER(MATRIX_VIEW)), POINTER(VECTOR), POINTER(MATRIX_VIEW), POINTER(OPTIONS)]
+
+_lib.countsFromEvents.restype   = POINTER(POINTER(MATRIX))
+_lib.countsFromEvents.argtypes  = [POINTER(MATRIX_VIEW)]
+
+_lib.countsFromTimings.restype  = POINTER(POINTER(MATRIX))
+_lib.countsFromTimings.argtypes = [c_int, POINTER(VECTOR), c_double, c_double, c_double]
+
+_lib.countsFromConfig.restype   = POINTER(POINTER(MATRIX))
+_lib.countsFromConfig.argtypes  = [c_char_p, c_char_p, POINTER(c_int), POINTER(c_double)]
+
+_lib.distanceView.restype    = c_double
+_lib.distanceView.argtypes   = [c_int, c_int, c_int, POINTER(POINTER(MATRIX_VIEW)), POINTER(POINTER(MATRIX_VIEW)), POINTER(VECTOR), POINTER(MATRIX_VIEW), POINTER(OPTIONS)]
+
 # convert datatypes
 # ------------------------------------------------------------------------------
 
 def copyVectorToC(v, c_v):
-     for i in range(0, c_v.contents.size):
-          c_v.contents.content[i] = v[i]
+     a = np.ascontiguousarray(v, dtype=np.float64)
+     memmove(c_v.contents.content, a.ctypes.data, a.nbytes)
 
 def copyMatrixToC(m, c_m):
-     for i in range(0, c_m.contents.rows):
-          for j in range(0, c_m.contents.columns):
-               c_m.contents.content[i][j] = m[i][j]
+     # rows of a matrix are stored in a single block
+     a = np.ascontiguousarray(m, dtype=np.float64)
+     memmove(c_m.contents.content[0], a.ctypes.data, a.nbytes)
 
 def getVector(c_v):
-     v = []
-     for i in range(0, c_v.contents.size):
-          v.append(c_v.contents.content[i])
-     return v
+     return wrapVector(c_v, False).tolist()
 
 def getMatrix(c_m):
-     m = []
-     for i in range(0, c_m.contents.rows):
-          m.append([])
-          for j in range(0, c_m.contents.columns):
-               m[i].append(c_m.contents.content[i][j])
-     return m
+     return wrapMatrix(c_m, False).tolist()
+
+# numpy arrays that share memory with the library
+# ------------------------------------------------------------------------------
+
+class Release(object):
+     """Free library memory when the last array that uses it is
+     garbage collected."""
+     def __init__(self, free, ptr):
+          # pointers that are fields of a structure refer to the memory
+          # of the structure, hence only the address is kept
+          self.free = free
+          self.ptr  = cast(ptr, c_void_p).value
+          self.type = type(ptr)
+     def release(self):
+          if self.ptr is not None:
+               self.free(cast(c_void_p(self.ptr), self.type))
+               self.ptr = None
+     def __del__(self):
+          self.release()
+
+def wrapBuffer(ptr, n, release):
+     if n == 0:
+          # no array keeps the memory alive
+          if release:
+               release.release()
+          return np.zeros(0)
+     buf = (c_double*n).from_address(cast(ptr, c_void_p).value)
+     if release:
+          buf._release = release
+     return np.frombuffer(buf, dtype=np.float64)
+
+def wrapVector(c_v, release=True):
+     """Numpy array that uses the memory of a library vector, which is
+     released together with the array."""
+     n = c_v.contents.size
+     return wrapBuffer(c_v.contents.content, n,
+                       Release(_lib._free_vector, c_v) if release else None)
+
+def wrapMatrix(c_m, release=True):
+     """Same as wrapVector() for matrices."""
+     rows, columns = c_m.contents.rows, c_m.contents.columns
+     return wrapBuffer(c_m.contents.content[0], rows*columns,
+                       Release(_lib._free_matrix, c_m) if release else None).reshape(rows, columns)
+
+def wrapStats(c_s):
+     """Convert a stats_t structure to a dictionary and release it."""
+     if not bool(c_s):
+          return None
+     s = c_s.contents
+     result = \
+         { 'wall'               : dict(zip(STATS_PHASES, s.wall)),
+           'cpu'                : dict(zip(STATS_PHASES, s.cpu)),
+           'prombs_calls'       : int(s.prombs_calls),
+           'evaluations'        : int(s.evaluations),
+           'lngamma_calls'      : int(s.lngamma_calls),
+           'thread_utilization' : s.thread_utilization,
+           'peak_scratch'       : int(s.peak_scratch) }
+     _lib._free(c_s)
+     return result
+
+def wrapPosterior(c_p):
+     """Convert a marginal_t structure, the results own the library
+     memory and the structure itself is released."""
+     result = \
+         { 'moments'   : wrapMatrix(c_p.contents.moments)   if bool(c_p.contents.moments)   else [],
+           'density'   : wrapMatrix(c_p.contents.density)   if bool(c_p.contents.density)   else [],
+           'bprob'     : wrapVector(c_p.contents.bprob)     if bool(c_p.contents.bprob)     else [],
+           'mpost'     : wrapVector(c_p.contents.mpost)     if bool(c_p.contents.mpost)     else [],
+           'coverage'  : wrapMatrix(c_p.contents.coverage)  if bool(c_p.contents.coverage)  else [],
+           'density_points' : wrapMatrix(c_p.contents.density_points) if bool(c_p.contents.density_points) else [],
+           'quantiles' : wrapMatrix(c_p.contents.quantiles) if bool(c_p.contents.quantiles) else [],
+           'hdi'       : wrapMatrix(c_p.contents.hdi)       if bool(c_p.contents.hdi)       else [],
+           'events'    : [ wrapPosterior(c_p.contents.event[k]) if bool(c_p.contents.event[k]) else None
+                           for k in range(0, c_p.contents.events) ],
+           'stats'     : wrapStats(c_p.contents.stats) }
+
+     if bool(c_p.contents.event):
+          _lib._free(c_p.contents.event)
+     _lib._free(c_p)
+
+     return result
+
+def vectorView(v):
+     """Pass a numpy array to the library without copying it. The array
+     is returned as well and must be kept alive while the vector is
+     used."""
+     a = np.ascontiguousarray(v, dtype=np.float64)
+     return a, pointer(VECTOR(len(a), a.ctypes.data_as(POINTER(c_double))))
+
+def matrixView(m):
+     """Same as vectorView() for matrices, which may be in row-major or
+     column-major layout with arbitrary positive strides."""
+     a = np.asarray(m, dtype=np.float64)
+     if a.ndim != 2:
+          raise ValueError("Matrix must have two dimensions.")
+     s = a.itemsize
+     if   a.flags.c_contiguous:
+          layout, stride = 0, a.shape[1]
+     elif a.flags.f_contiguous:
+          layout, stride = 1, a.shape[0]
+     elif a.strides[1] == s and a.strides[0] > 0 and a.strides[0] % s == 0:
+          layout, stride = 0, a.strides[0]/s
+     elif a.strides[0] == s and a.strides[1] > 0 and a.strides[1] % s == 0:
+          layout, stride = 1, a.strides[1]/s
+     else:
+          a = np.ascontiguousarray(a)
+          layout, stride = 0, a.shape[1]
+     c_m = _lib._alloc_matrix_view(a.ctypes.data_as(POINTER(c_double)),
+                                   a.shape[0], a.shape[1], int(stride), layout)
+     return a, c_m
+
+def matrixViews(matrices):
+     arrays  = []
+     c_views = (len(matrices)*POINTER(MATRIX_VIEW))()
+     for i in range(0, len(matrices)):
+          a, c_views[i] = matrixView(matrices[i])
+          arrays.append(a)
+     return arrays, c_views
+
+def freeMatrixViews(c_views):
+     for c_v in c_views:
+          _lib._free_matrix_view(c_v)
 
 # convert datatypes
 # ------------------------------------------------------------------------------
@@ -217,133 +457,347 @@ def init(epsilon):
 def free():
      _lib._free_()
 
+def traceStart(capacity=0):
+     """Record all tasks and phases of the following computations,
+     each thread keeps its last `capacity' events."""
+     _lib.traceStart(capacity)
+
+def traceStop(filename=None):
+     """Write the trace in Chrome trace-event format, the trace is
+     discarded if no filename is given."""
+     if filename is None:
+          _lib.traceStop(None)
+     elif _lib.traceStop(filename.encode('utf-8')) != 0:
+          raise IOError("Could not write trace to `%s'." % filename)
+
+# progress and cancellation
+# ------------------------------------------------------------------------------
+
+class Cancelled(Exception):
+     """Raised by all computations that were cancelled, partial results
+     are discarded."""
+     pass
+
+# the library only keeps a pointer to the hook
+_progress_hook = None
+
+def setProgressHook(hook):
+     """Call hook(phase, done, total) at most ten times a second while a
+     computation is running, the computation is cancelled if the hook
+     returns True. The hook is removed with None."""
+     global _progress_hook
+     if hook is None:
+          _progress_hook = None
+          _lib.setProgressHook(cast(None, PROGRESS_HOOK))
+     else:
+          def call(phase, done, total):
+               return 1 if hook(phase.decode('utf-8'), done, total) else 0
+          _progress_hook = PROGRESS_HOOK(call)
+          _lib.setProgressHook(_progress_hook)
+
+def cancel():
+     """Cancel the running computation, may be called from any thread."""
+     _lib.setCancelled(1)
+
+def checkCancelled():
+     if _lib.interruptPending():
+          _lib.setCancelled(0)
+          raise Cancelled("Computation was cancelled.")
+
 def posterior(events, counts, alpha, beta, gamma, options):
      c_events = c_int(events)
-     c_counts = (events*POINTER(MATRIX))()
-     c_alpha  = (events*POINTER(MATRIX))()
-     for i in range(0, events):
-          c_counts[i]  = _lib._alloc_matrix(len(counts[i]), len(counts[i][0]))
-          copyMatrixToC(counts[i], c_counts[i])
-          c_alpha[i]   = _lib._alloc_matrix(len(alpha[i]), len(alpha[i][0]))
-          copyMatrixToC(alpha[i],  c_alpha[i])
-     c_beta  = _lib._alloc_vector(len(beta))
-     copyVectorToC(beta,  c_beta)
-     c_gamma = _lib._alloc_matrix(len(gamma), len(gamma[0]))
-     copyMatrixToC(gamma,  c_gamma)
+     a_counts, c_counts = matrixViews(counts)
+     a_alpha,  c_alpha  = matrixViews(alpha)
+     a_beta,   c_beta   = vectorView(beta)
+     a_gamma,  c_gamma  = matrixView(gamma)
      c_options = pointer(OPTIONS(options))
 
-     tmp = _lib.posterior(c_events, c_counts, c_alpha, c_beta, c_gamma, c_options)
+     tmp = _lib.posteriorView(c_events, c_counts, c_alpha, c_beta, c_gamma, c_options)
 
-     for i in range(0, events):
-          _lib._free_matrix(c_counts[i])
-          _lib._free_matrix(c_alpha[i])
-     _lib._free_vector(c_beta)
-     _lib._free_matrix(c_gamma)
+     freeMatrixViews(c_counts)
+     freeMatrixViews(c_alpha)
+     _lib._free_matrix_view(c_gamma)
+
+     result = wrapPosterior(tmp)
+
+     checkCancelled()
+
+     return result
+
+def posteriorBatch(events, counts, alpha, beta, gamma, options):
+     """Compute the posterior of several data sets at once. The priors
+     alpha, beta and gamma are lists with one element for each data
+     set, elements that are None are replaced by the prior of the first
+     data set."""
+     n        = len(counts)
+     c_n      = c_int(n)
+     c_events = c_int(events)
+     arrays   = []
+     c_counts = (n*POINTER(POINTER(MATRIX_VIEW)))()
+     c_alpha  = (n*POINTER(POINTER(MATRIX_VIEW)))()
+     c_beta   = (n*POINTER(VECTOR))()
+     c_gamma  = (n*POINTER(MATRIX_VIEW))()
+     for i in range(0, n):
+          a, c_counts[i] = matrixViews(counts[i])
+          arrays.append(a)
+          if alpha[i] is not None:
+               a, c_alpha[i] = matrixViews(alpha[i])
+               arrays.append(a)
+          if beta[i] is not None:
+               a, c_beta[i] = vectorView(beta[i])
+               arrays.append(a)
+          if gamma[i] is not None:
+               a, c_gamma[i] = matrixView(gamma[i])
+               arrays.append(a)
+     c_options = pointer(OPTIONS(options))
+
+     tmp = _lib.posteriorBatchView(c_n, c_events, c_counts, c_alpha, c_beta, c_gamma, c_options)
+
+     for i in range(0, n):
+          freeMatrixViews(c_counts[i][0:events])
+          if bool(c_alpha[i]):
+               freeMatrixViews(c_alpha[i][0:events])
+          if bool(c_gamma[i]):
+               _lib._free_matrix_view(c_gamma[i])
+
+     result = [ wrapPosterior(tmp[i]) for i in range(0, n) ]
 
-     result = \
-         { 'moments'   : getMatrix(tmp.contents.moments)   if bool(tmp.contents.moments)   else [],
-           'density'   : getMatrix(tmp.contents.density)   if bool(tmp.contents.density)   else [],
-           'bprob'     : getVector(tmp.contents.bprob)     if bool(tmp.contents.bprob)     else [],
-           'mpost'     : getVector(tmp.contents.mpost)     if bool(tmp.contents.mpost)     else [] }
-
-     if bool(tmp.contents.moments):
-          _lib._free_matrix(tmp.contents.moments)
-     if bool(tmp.contents.density):
-          _lib._free_matrix(tmp.contents.density)
-     if bool(tmp.contents.bprob):
-          _lib._free_vector(tmp.contents.bprob)
-     if bool(tmp.contents.mpost):
-          _lib._free_vector(tmp.contents.mpost)
      _lib._free(tmp)
 
+     checkCancelled()
+
      return result
 
 def utility(events, counts, alpha, beta, gamma, options):
+     c_events = c_int(events)
+     a_counts, c_counts = matrixViews(counts)
+     a_alpha,  c_alpha  = matrixViews(alpha)
+     a_beta,   c_beta   = vectorView(beta)
+     a_gamma,  c_gamma  = matrixView(gamma)
+     c_options = pointer(OPTIONS(options))
+
+     tmp = _lib.utilityView(c_events, c_counts, c_alpha, c_beta, c_gamma, c_options)
+
+     freeMatrixViews(c_counts)
+     freeMatrixViews(c_alpha)
+     _lib._free_matrix_view(c_gamma)
+
+     # results own the library memory
+     result = \
+         { 'expectation' : wrapMatrix(tmp.contents.expectation) if bool(tmp.contents.expectation) else [],
+           'utility'     : wrapVector(tmp.contents.utility)     if bool(tmp.contents.utility)     else [],
+           'stats'       : wrapStats(tmp.contents.stats) }
+
+     _lib._free(tmp)
+
+     checkCancelled()
+
+     return result
+
+def utilityDeadline(budget, priority, events, counts, alpha, beta, gamma, options):
+     c_budget      = c_double(budget)
      c_events      = c_int(events)
-     c_counts      = (events*POINTER(MATRIX))()
-     c_alpha       = (events*POINTER(MATRIX))()
-     for i in range(0, events):
-          c_counts[i]  = _lib._alloc_matrix(len(counts[i]), len(counts[i][0]))
-          copyMatrixToC(counts[i], c_counts[i])
-          c_alpha[i]   = _lib._alloc_matrix(len(alpha[i]), len(alpha[i][0]))
-          copyMatrixToC(alpha[i],  c_alpha[i])
-     c_beta  = _lib._alloc_vector(len(beta))
-     copyVectorToC(beta,  c_beta)
-     c_gamma = _lib._alloc_matrix(len(gamma), len(gamma[0]))
-     copyMatrixToC(gamma,  c_gamma)
+     a_counts, c_counts = matrixViews(counts)
+     a_alpha,  c_alpha  = matrixViews(alpha)
+     a_beta,   c_beta   = vectorView(beta)
+     a_gamma,  c_gamma  = matrixView(gamma)
      c_options = pointer(OPTIONS(options))
+     a_priority, c_priority = None, None
+     if priority is not None and len(priority) > 0:
+          a_priority, c_priority = vectorView(priority)
 
-     tmp = _lib.utility(c_events, c_counts, c_alpha, c_beta, c_gamma, c_options)
+     tmp = _lib.utilityDeadlineView(c_budget, c_priority, c_events, c_counts, c_alpha, c_beta, c_gamma, c_options)
 
-     for i in range(0, events):
-          _lib._free_matrix(c_counts[i])
-          _lib._free_matrix(c_alpha[i])
-     _lib._free_vector(c_beta)
-     _lib._free_matrix(c_gamma)
+     freeMatrixViews(c_counts)
+     freeMatrixViews(c_alpha)
+     _lib._free_matrix_view(c_gamma)
 
      result = \
          { 'expectation' : getMatrix(tmp.contents.expectation) if bool(tmp.contents.expectation) else [],
-           'utility'     : getVector(tmp.contents.utility)     if bool(tmp.contents.utility)     else [] }
+           'utility'     : getVector(tmp.contents.utility)     if bool(tmp.contents.utility)     else [],
+           'complete'    : map(int, getVector(tmp.contents.complete)) if bool(tmp.contents.complete) else [],
+           'stats'       : wrapStats(tmp.contents.stats) }
 
      if bool(tmp.contents.expectation):
           _lib._free_matrix(tmp.contents.expectation)
      if bool(tmp.contents.utility):
           _lib._free_vector(tmp.contents.utility)
+     if bool(tmp.contents.complete):
+          _lib._free_vector(tmp.contents.complete)
      _lib._free(tmp)
 
+     checkCancelled()
+
      return result
 
 def utilityAt(i, events, counts, alpha, beta, gamma, options):
-     c_i           = c_int(i)
+     c_i      = c_int(i)
+     c_events = c_int(events)
+     a_counts, c_counts = matrixViews(counts)
+     a_alpha,  c_alpha  = matrixViews(alpha)
+     a_beta,   c_beta   = vectorView(beta)
+     a_gamma,  c_gamma  = matrixView(gamma)
+     c_options = pointer(OPTIONS(options))
+
+     c_result = _lib.utilityAtView(c_i, c_events, c_counts, c_alpha, c_beta, c_gamma, c_options)
+     result   = wrapVector(c_result)
+
+     freeMatrixViews(c_counts)
+     freeMatrixViews(c_alpha)
+     _lib._free_matrix_view(c_gamma)
+
+     checkCancelled()
+
+     return (result[0:-1], result[-1])
+
+def utilityBatch(q, events, counts, alpha, beta, gamma, options):
+     """Select q positions that are sampled next, which are returned
+     together with the expected utility."""
+     if q <= 0:
+          raise ValueError("Batch size must be positive.")
+     c_q           = c_int(q)
+     c_events      = c_int(events)
+     a_counts, c_counts = matrixViews(counts)
+     a_alpha,  c_alpha  = matrixViews(alpha)
+     a_beta,   c_beta   = vectorView(beta)
+     a_gamma,  c_gamma  = matrixView(gamma)
+     c_options = pointer(OPTIONS(options))
+
+     tmp = _lib.utilityBatchView(c_q, c_events, c_counts, c_alpha, c_beta, c_gamma, c_options)
+
+     freeMatrixViews(c_counts)
+     freeMatrixViews(c_alpha)
+     _lib._free_matrix_view(c_gamma)
+
+     # results own the library memory
+     result = \
+         { 'batch'       : list(map(int, getVector(tmp.contents.batch))),
+           'expectation' : wrapMatrix(tmp.contents.expectation),
+           'utility'     : wrapVector(tmp.contents.utility),
+           'stats'       : wrapStats(tmp.contents.stats) }
+
+     _lib._free_vector(tmp.contents.batch)
+     _lib._free(tmp)
+
+     checkCancelled()
+
+     return result
+
+def utilityPath(length, events, counts, alpha, beta, gamma, options):
+     c_length      = c_int(length)
      c_events      = c_int(events)
-     c_counts      = (events*POINTER(MATRIX))()
-     c_alpha       = (events*POINTER(MATRIX))()
-     for i in range(0, events):
-          c_counts[i]  = _lib._alloc_matrix(len(counts[i]), len(counts[i][0]))
-          copyMatrixToC(counts[i], c_counts[i])
-          c_alpha[i]   = _lib._alloc_matrix(len(alpha[i]), len(alpha[i][0]))
-          copyMatrixToC(alpha[i],  c_alpha[i])
-     c_beta  = _lib._alloc_vector(len(beta))
-     copyVectorToC(beta,  c_beta)
-     c_gamma = _lib._alloc_matrix(len(gamma), len(gamma[0]))
-     copyMatrixToC(gamma,  c_gamma)
+     a_counts, c_counts = matrixViews(counts)
+     a_alpha,  c_alpha  = matrixViews(alpha)
+     a_beta,   c_beta   = vectorView(beta)
+     a_gamma,  c_gamma  = matrixView(gamma)
      c_options = pointer(OPTIONS(options))
 
-     c_result = _lib.utilityAt(c_i, c_events, c_counts, c_alpha, c_beta, c_gamma, c_options)
+     c_result = _lib.utilityPathView(c_length, c_events, c_counts, c_alpha, c_beta, c_gamma, c_options)
      result   = getVector(c_result)
 
-     for i in range(0, events):
-          _lib._free_matrix(c_counts[i])
-          _lib._free_matrix(c_alpha[i])
-     _lib._free_vector(c_beta)
-     _lib._free_matrix(c_gamma)
+     freeMatrixViews(c_counts)
+     freeMatrixViews(c_alpha)
+     _lib._free_matrix_view(c_gamma)
      _lib._free_vector(c_result)
 
-     return (result[0:-1], result[-1])
+     checkCancelled()
+
+     return result
 
 def distance(x, y, events, counts, alpha, beta, gamma, options):
-     c_x           = c_int(x)
-     c_y           = c_int(y)
-     c_events      = c_int(events)
-     c_counts      = (events*POINTER(MATRIX))()
-     c_alpha       = (events*POINTER(MATRIX))()
-     for i in range(0, events):
-          c_counts[i]  = _lib._alloc_matrix(len(counts[i]), len(counts[i][0]))
-          copyMatrixToC(counts[i], c_counts[i])
-          c_alpha[i]   = _lib._alloc_matrix(len(alpha[i]), len(alpha[i][0]))
-          copyMatrixToC(alpha[i],  c_alpha[i])
-     c_beta  = _lib._alloc_vector(len(beta))
-     copyVectorToC(beta,  c_beta)
-     c_gamma = _lib._alloc_matrix(len(gamma), len(gamma[0]))
-     copyMatrixToC(gamma,  c_gamma)
+     c_x      = c_int(x)
+     c_y      = c_int(y)
+     c_events = c_int(events)
+     a_counts, c_counts = matrixViews(counts)
+     a_alpha,  c_alpha  = matrixViews(alpha)
+     a_beta,   c_beta   = vectorView(beta)
+     a_gamma,  c_gamma  = matrixView(gamma)
      c_options = pointer(OPTIONS(options))
 
-     c_result = _lib.distance(c_x, c_y, c_events, c_counts, c_alpha, c_beta, c_gamma, c_options)
+     c_result = _lib.distanceView(c_x, c_y, c_events, c_counts, c_alpha, c_beta, c_gamma, c_options)
 
-     for i in range(0, events):
-          _lib._free_matrix(c_counts[i])
-          _lib._free_matrix(c_alpha[i])
-     _lib._free_vector(c_beta)
-     _lib._free_matrix(c_gamma)
+     freeMatrixViews(c_counts)
+     freeMatrixViews(c_alpha)
+     _lib._free_matrix_view(c_gamma)
 
      return c_result
+
+def simulate(replicates, trials, gt, lapsing, strategy, seed, events, alpha, beta, gamma, options):
+     c_replicates  = c_int(replicates)
+     c_trials      = c_int(trials)
+     a_gt,  c_gt   = vectorView(gt)
+     c_lapsing     = c_double(lapsing)
+     c_strategy    = c_int(strategy)
+     c_seed        = c_ulong(seed)
+     c_events      = c_int(events)
+     a_alpha, c_alpha = matrixViews(alpha)
+     a_beta,  c_beta  = vectorView(beta)
+     a_gamma, c_gamma = matrixView(gamma)
+     c_options = pointer(OPTIONS(options))
+
+     tmp = _lib.simulateView(c_replicates, c_trials, c_gt, c_lapsing, c_strategy, c_seed, c_events, c_alpha, c_beta, c_gamma, c_options)
+
+     freeMatrixViews(c_alpha)
+     _lib._free_matrix_view(c_gamma)
+
+     # results own the library memory
+     result = \
+         { 'stimulus' : wrapMatrix(tmp.contents.stimulus),
+           'event'    : wrapMatrix(tmp.contents.event),
+           'kl'       : wrapMatrix(tmp.contents.kl),
+           'mean'     : wrapMatrix(tmp.contents.mean),
+           'variance' : wrapMatrix(tmp.contents.variance) }
+
+     _lib._free(tmp)
+
+     checkCancelled()
+
+     return result
+
+def countsFromEvents(events):
+     """Count statistic of a KxL matrix of events, which is a list of K
+     LxL arrays that use the memory of the library."""
+     a_events, c_events = matrixView(events)
+
+     tmp = _lib.countsFromEvents(c_events)
+
+     _lib._free_matrix_view(c_events)
+
+     result = [ wrapMatrix(tmp[k]) for k in range(0, a_events.shape[0]) ]
+
+     _lib._free(tmp)
+
+     return result
+
+def countsFromTimings(trials, timings, binsize, srange):
+     """Count statistic of successes and failures from the concatenated
+     spike timings of all trials."""
+     a_timings, c_timings = vectorView(timings)
+
+     tmp = _lib.countsFromTimings(c_int(trials), c_timings, c_double(binsize),
+                                  c_double(srange[0]), c_double(srange[1]))
+     if not bool(tmp):
+          raise ValueError("Number of trials is smaller than some counts.")
+
+     result = [ wrapMatrix(tmp[0]), wrapMatrix(tmp[1]) ]
+
+     _lib._free(tmp)
+
+     return result
+
+def countsFromConfig(filename, section):
+     """Count statistic of the [Counts] or [Trials] section of a
+     configuration file, which is streamed by the library. Returns the
+     counts and for [Trials] the range of the spike timings."""
+     c_events = c_int(0)
+     c_range  = (2*c_double)()
+
+     tmp = _lib.countsFromConfig(filename.encode('utf-8'), section.encode('utf-8'), byref(c_events), c_range)
+     if not bool(tmp):
+          raise IOError("Could not read section `%s' of `%s'." % (section, filename))
+
+     result = [ wrapMatrix(tmp[k]) for k in range(0, c_events.value) ]
+
+     _lib._free(tmp)
+
+     return result, [c_range[0], c_range[1]]
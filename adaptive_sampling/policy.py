@@ -16,13 +16,8 @@
 # along with this program; if not, write to the Free Software
 # Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
-import Queue
-import copy
 import interface
-import random
 import statistics
-import sys
-import threading
 
 # call the interface
 ################################################################################
@@ -72,103 +67,26 @@ def value(path, counts, data, bin_options, hashutil):
 
     return utility
 
-# optimize a sampling path similar to the policy iteration algorithm
+# optimize sampling paths (path iteration)
 ################################################################################
 
-def optimize_entry(i, path_value, path, counts, data, bin_options, hashutil):
-    changed = False
-    stimuli = range(len(counts[0]))
-    stimuli.remove(path[i])
-    path_prime = copy.deepcopy(path)
-    for x in stimuli:
-        path_prime[i]    = x
-        path_value_prime = value(path_prime, counts, data, bin_options, hashutil)
-        if path_value_prime > path_value:
-            changed    = True
-            path_value = path_value_prime
-            path[i]    = x
-    return (path_value, path, changed)
-
-def optimize(path, counts, data, bin_options, hashutil, full=False):
-    changed    = True
-    path_value = value(path, counts, data, bin_options, hashutil)
-    decisions  = range(len(path))
-    if not full:
-        decisions.remove(0)
-    while changed:
-        for i in decisions:
-            (path_value, path, changed) = optimize_entry(i, path_value, path, counts, data, bin_options, hashutil)
-    return (path_value, path)
-
-def u_star(length, counts, data, bin_options):
+def u_star(length, counts_v, data, bin_options):
+    """Compute for each stimulus the value of the best sampling path
+    of the given length that starts with this stimulus. The paths
+    are optimized by the binning library, which caches forward and
+    backward messages and evaluates all stimuli in parallel. Paths
+    of length one are the expected utility, which is also available
+    without the hidden Markov model."""
     if length <= 1:
-        return utility(counts, data, bin_options)[1]
-    stimuli  = range(len(counts[0]))
-    path     = [ random.choice(stimuli) for i in range(length) ]
-    utility  = [ 0.0 for i in stimuli ]
-    hashutil = {}
-    for x in stimuli:
-        path[0] = x
-        (path_value, path) = optimize(path, counts, data, bin_options, hashutil)
-        utility[x] = path_value
-    return utility
-
-# threaded optimization of sampling paths
-################################################################################
-
-class OptimizationThread(threading.Thread):
-    def __init__(self, length, counts, data, bin_options, queue_in, queue_out):
-        threading.Thread.__init__(self)
-        self.length      = length
-        self.counts      = copy.deepcopy(counts)
-        self.data        = copy.deepcopy(data)
-        self.bin_options = bin_options
-        self.queue_in    = queue_in
-        self.queue_out   = queue_out
-        self.hashutil    = {}
-    def run(self):
-        stimuli = range(len(self.counts[0]))
-        path    = [ random.choice(stimuli) for i in range(self.length) ]
-        while True:
-            # get stimulus from queue
-            x = self.queue_in.get()
-            if self.bin_options['verbose']:
-                sys.stderr.write('Processing stimulus ' + str(x) + '.\n')
-            # set first element of the path to this stimulus
-            path[0] = x
-            # optimize all other elements of the path
-            (path_value, path) = optimize(path, self.counts, self.data, self.bin_options, self.hashutil)
-            # push result
-            self.queue_out.put((x, path_value))
-            self.queue_in.task_done()
-
-def threaded_u_star(length, counts, data, bin_options):
-    if length <= 1:
-        return utility(counts, data, bin_options)[1]
-    utility_queue_in  = Queue.Queue()
-    utility_queue_out = Queue.Queue()
-    utility_threads   = []
-    stimuli = range(len(counts[0]))
-    utility_vector = [ 0.0 for i in stimuli ]
-    # launch daemon threads
-    for i in range(bin_options['threads']):
-        t = OptimizationThread(length, counts, data, bin_options,
-                               utility_queue_in, utility_queue_out)
-        t.setDaemon(True)
-        t.start()
-        utility_threads += [t]
-    # fill queue and start computation
-    stimuli = range(len(counts[0]))
-    for x in stimuli:
-        utility_queue_in.put(x)
-    # wait for threads
-    utility_queue_in.join()
-    # process results
-    while not utility_queue_out.empty():
-        x, path_value = utility_queue_out.get()
-        utility_vector[x] = path_value
-        utility_queue_out.task_done()
-    return utility_vector
+        return utility(counts_v, data, bin_options)['utility']
+    if not bin_options['hmm']:
+        raise ValueError("Path iteration requires the hidden Markov model.")
+    events        = len(counts_v)
+    counts        = statistics.countStatistic(counts_v)
+    alpha         = data['alpha']
+    beta          = data['beta']
+    gamma         = data['gamma']
+    return interface.utilityPath(length, events, counts, alpha, beta, gamma, bin_options)
 
 # test functions
 ################################################################################
@@ -0,0 +1,166 @@
+# Copyright (C) 2012 Philipp Benner
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+import sys
+import ConfigParser
+import numpy as np
+
+import config
+
+# binary result files
+# ------------------------------------------------------------------------------
+#
+# A result file starts with a header of 64 bytes, followed by a table
+# with one entry of 64 bytes for each array. Arrays are stored in
+# row-major order at offsets that are multiples of 64 bytes, so that
+# they can be mapped into memory. All numbers are little-endian. The
+# same layout is read by the C library (result-file.h), MATLAB
+# (load_result.m) and R (load.result).
+
+MAGIC   = 'ADSAMPLE'
+VERSION = 1
+ALIGN   = 64
+
+FLOAT64 = 0
+INT64   = 1
+CHAR    = 2
+
+HEADER = np.dtype([('magic',    'S8'),
+                   ('version',  '<u4'),
+                   ('n_arrays', '<u4'),
+                   ('size',     '<u8'),
+                   ('reserved', 'S40')])
+
+ENTRY  = np.dtype([('name',     'S32'),
+                   ('type',     '<u4'),
+                   ('ndim',     '<u4'),
+                   ('rows',     '<u8'),
+                   ('columns',  '<u8'),
+                   ('offset',   '<u8')])
+
+DTYPES = { FLOAT64 : np.dtype('<f8'), INT64 : np.dtype('<i8'), CHAR : np.dtype('S1') }
+
+def align(offset):
+    return (offset + ALIGN - 1)//ALIGN*ALIGN
+
+def toArray(value):
+    """Convert a value to an array and its type code."""
+    if isinstance(value, str):
+        return np.frombuffer(value, dtype='S1'), CHAR
+    a = np.asarray(value)
+    if a.dtype.kind in 'iub':
+        return np.ascontiguousarray(a, dtype='<i8'), INT64
+    else:
+        return np.ascontiguousarray(a, dtype='<f8'), FLOAT64
+
+def save(filename, arrays):
+    """Save a list of (name, value) pairs, where values are vectors,
+    matrices or strings."""
+    converted = [ (name,) + toArray(value) for name, value in arrays ]
+    header    = np.zeros(1, dtype=HEADER)
+    entries   = np.zeros(len(converted), dtype=ENTRY)
+    offset    = HEADER.itemsize + len(converted)*ENTRY.itemsize
+    for i, (name, a, t) in enumerate(converted):
+        if a.ndim > 2 or len(name) >= 32:
+            raise ValueError("Invalid array `%s'." % name)
+        entries[i]['name']    = name
+        entries[i]['type']    = t
+        entries[i]['ndim']    = max(a.ndim, 1)
+        entries[i]['rows']    = a.shape[0] if a.ndim > 0 else 1
+        entries[i]['columns'] = a.shape[1] if a.ndim > 1 else 1
+        entries[i]['offset']  = align(offset)
+        offset = entries[i]['offset'] + a.nbytes
+    header[0]['magic']    = MAGIC
+    header[0]['version']  = VERSION
+    header[0]['n_arrays'] = len(converted)
+    header[0]['size']     = offset
+    f = open(filename, 'wb')
+    f.write(header.tostring())
+    f.write(entries.tostring())
+    position = HEADER.itemsize + len(converted)*ENTRY.itemsize
+    for entry, (name, a, t) in zip(entries, converted):
+        f.write('\0'*(int(entry['offset']) - position))
+        f.write(a.tostring())
+        position = int(entry['offset']) + a.nbytes
+    f.close()
+
+def isResultFile(filename):
+    f = open(filename, 'rb')
+    magic = f.read(len(MAGIC))
+    f.close()
+    return magic == MAGIC
+
+def load(filename):
+    """Load all arrays of a result file. Numerical arrays are mapped
+    into memory (copy-on-write), strings are returned as str."""
+    header = np.fromfile(filename, dtype=HEADER, count=1)
+    if len(header) == 0 or header[0]['magic'] != MAGIC or header[0]['version'] > VERSION:
+        raise IOError("Invalid result file.")
+    entries = np.memmap(filename, dtype=ENTRY, mode='r', offset=HEADER.itemsize,
+                        shape=(int(header[0]['n_arrays']),))
+    result  = {}
+    for entry in entries:
+        t     = int(entry['type'])
+        shape = (int(entry['rows']), int(entry['columns']))
+        if int(entry['ndim']) == 1:
+            shape = (shape[0]*shape[1],)
+        if t not in DTYPES:
+            raise IOError("Invalid result file.")
+        if shape[0] == 0 or (len(shape) == 2 and shape[1] == 0):
+            a = np.zeros(shape, dtype=DTYPES[t])
+        else:
+            a = np.memmap(filename, dtype=DTYPES[t], mode='c', offset=int(entry['offset']), shape=shape)
+        if t == CHAR:
+            a = a.tostring()
+        result[entry['name']] = a
+    return result
+
+# conversion of text result files
+# ------------------------------------------------------------------------------
+
+MATRICES = { 'moments' : float, 'density' : float, 'counts' : int }
+VECTORS  = { 'bprob' : float, 'mpost' : float, 'utility' : float, 'distances' : float, 'samples' : int }
+
+def convert(text_file, binary_file):
+    """Convert a result file in the old text format."""
+    config_parser = ConfigParser.RawConfigParser()
+    config_parser.read(text_file)
+    if   config_parser.has_section('Result'):
+        section = 'Result'
+    elif config_parser.has_section('Sampling Result'):
+        section = 'Sampling Result'
+    else:
+        raise IOError("Invalid configuration file.")
+    arrays = []
+    for option in config_parser.options(section):
+        if option in MATRICES:
+            arrays.append((option, config.readMatrix(config_parser, section, option, MATRICES[option])))
+        elif option in VECTORS:
+            arrays.append((option, config.readVector(config_parser, section, option, VECTORS[option])))
+        else:
+            arrays.append((option, config_parser.get(section, option).strip()))
+    save(binary_file, arrays)
+
+def main():
+    if len(sys.argv) != 3:
+        print "Usage: %s TEXT_FILE BINARY_FILE" % sys.argv[0]
+        print "Convert a result file from the text to the binary format."
+        return 1
+    convert(sys.argv[1], sys.argv[2])
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main())
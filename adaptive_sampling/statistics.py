@@ -19,6 +19,7 @@ import numpy as np
 
 from interface import gsl_sf_choose
 from interface import gsl_sf_lnchoose
+from interface import countsFromEvents
 
 def choose(n,k):
     return gsl_sf_choose(n,k)
@@ -41,10 +42,4 @@ def standardizedMoments(moments, n):
     return [ mu / math.pow(math.sqrt(var), n) for var, mu in zip(m2, mn) ]
 
 def countStatistic(events):
-    K = len(events)
-    L = len(events[0])
-    ones   = np.ones(L, dtype=float)
-    counts = np.zeros([K, L, L])
-    for k in range(0, K):
-        counts[k] = np.triu(np.outer(ones,events[k])).cumsum(axis=1)
-    return counts
+    return countsFromEvents(events)
@@ -53,7 +53,7 @@ def plotUtility(ax, x, result):
     return p[0]
 
 def plotModelPosterior(ax, result):
-    data = result['mpost'][:]
+    data = list(result['mpost'])
     N = len(data)
     x = np.arange(0, N+1, 1)
     data.insert(0, 0)
@@ -112,11 +112,16 @@ def plotBinBoundaries(ax, x, result):
     ax.set_xlim(x[0],x[-1])
 
 def plotMoments(ax, x, result):
-    """Plot the binning result."""
+    """Plot the binning result, the band is the first highest density
+    interval if available and one standard deviation otherwise."""
     N = len(result['moments'][0])
-    stddev = map(math.sqrt, statistics.centralMoments(result['moments'], 2))
-    stddev_upper = [ a + b for a, b in zip(result['moments'][0], stddev) ]
-    stddev_lower = [ a - b for a, b in zip(result['moments'][0], stddev) ]
+    if len(result.get('hdi', [])) > 0:
+        stddev_lower = result['hdi'][0]
+        stddev_upper = result['hdi'][1]
+    else:
+        stddev = map(math.sqrt, statistics.centralMoments(result['moments'], 2))
+        stddev_upper = [ a + b for a, b in zip(result['moments'][0], stddev) ]
+        stddev_lower = [ a - b for a, b in zip(result['moments'][0], stddev) ]
     ax.plot(x, stddev_upper, 'k-')
     ax.plot(x, stddev_lower, 'k-')
     ax.fill_between(x, stddev_lower, stddev_upper, linewidth=0, facecolor='red', alpha=0.3)
@@ -165,7 +170,7 @@ def plotBinning(result, options):
             x, title = preplot(result, options)
     fig = figure()
     fig.subplots_adjust(hspace=0.35)
-    if (result['mpost'] and options['model_posterior']):
+    if len(result['mpost']) > 0 and options['model_posterior']:
         ax11 = fig.add_subplot(2,1,1)
         ax21 = fig.add_subplot(2,1,2)
         ax12 = ax11.twinx()
@@ -178,11 +183,11 @@ def plotBinning(result, options):
     p11 = plotMoments(ax11, x, result)
     p12 = None
     p22 = None
-    if result['density'] and options['density']:
+    if len(result['density']) > 0 and options['density']:
         plotDensity(ax11, x, result)
-    if result['bprob'] and options['bprob']:
+    if len(result['bprob']) > 0 and options['bprob']:
         p12 = plotBinBoundaries(ax12, x, result)
-    if result['mpost'] and options['model_posterior']:
+    if len(result['mpost']) > 0 and options['model_posterior']:
         p21 = plotModelPosterior(ax21, result)
     if options['visualization'] and not postplot is None:
         postplot([ax11, ax12, ax21, ax22], [p11, p12, p21, p22],
@@ -199,7 +204,7 @@ def plotBinningSpikes(x, timings, result, options):
             x, dt, timings, title = preplot(x, timings, result, options)
     fig = figure()
     fig.subplots_adjust(hspace=0.35)
-    if result['mpost'] and options['model_posterior']:
+    if len(result['mpost']) > 0 and options['model_posterior']:
         ax11 = fig.add_subplot(3,1,1, title=title)
         ax21 = fig.add_subplot(3,1,2)
         ax31 = fig.add_subplot(3,1,3)
@@ -219,11 +224,11 @@ def plotBinningSpikes(x, timings, result, options):
     p12 = None
     p22 = None
     p32 = None
-    if result['density'] and options['density']:
+    if len(result['density']) > 0 and options['density']:
         plotDensity(ax21, x, result)
-    if result['bprob'] and options['bprob']:
+    if len(result['bprob']) > 0 and options['bprob']:
         p12 = plotBinBoundaries(ax12, x, result)
-    if result['mpost'] and options['model_posterior']:
+    if len(result['mpost']) > 0 and options['model_posterior']:
         p31 = plotModelPosterior(ax31, result)
     if options['visualization'] and not postplot is None:
         postplot([ax11, ax12, ax21, ax22, ax31, ax32],
@@ -241,7 +246,7 @@ def plotSampling(result, options, data):
             x, title = preplot(result, options)
     fig = figure(1, (8.0, 6.0))
     fig.subplots_adjust(left=0.09, bottom=0.06, right=0.89, top=0.96, hspace=0.35)
-    if result['mpost'] and options['model_posterior']:
+    if len(result['mpost']) > 0 and options['model_posterior']:
         ax11 = fig.add_subplot(3,1,1, title=title)
         ax21 = fig.add_subplot(3,1,2)
         ax31 = fig.add_subplot(3,1,3)
@@ -261,19 +266,19 @@ def plotSampling(result, options, data):
     p12 = None
     p22 = None
     p32 = None
-    if result['density'] and options['density']:
+    if len(result['density']) > 0 and options['density']:
         plotDensity(ax11, x, result)
     if data['gt']:
         p12 = plotGroundTruth(ax12, x, data['gt'])
-    if result['bprob'] and options['bprob']:
+    if len(result['bprob']) > 0 and options['bprob']:
         p12 = plotBinBoundaries(ax12, x, result)
-    if result['utility']:
+    if len(result['utility']) > 0:
         p22 = plotUtility(ax22, x, result)
         # if options['strategy'] == 'effective-counts':
         #     p22 = plotEffectiveCounts(ax22, x, result)
         # else:
         #     p22 = plotUtility(ax22, x, result)
-    if result['mpost'] and options['model_posterior']:
+    if len(result['mpost']) > 0 and options['model_posterior']:
         p31 = plotModelPosterior(ax31, result)
     if options['visualization'] and not postplot is None:
         postplot([ax11, ax12, ax21, ax22, ax31, ax32],
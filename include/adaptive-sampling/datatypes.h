@@ -61,18 +61,106 @@ typedef struct _options_ {
         int hmm;
         /* hmm parameters */
         float rho;
+        /* evaluate the exact utility only at positions where its
+         * upper bound exceeds the best lower bound, optionally
+         * including ties */
+        int prune;
+        int prune_ties;
+        /* return the posterior probability of all bins */
+        int coverage;
+        /* evaluate the density adaptively up to this L1 error, zero
+         * evaluates the full grid */
+        float density_accuracy;
+        /* probability levels of quantiles and highest density
+         * intervals */
+        int n_levels;
+        double *levels;
+        /* bit k is set if the marginals of event k are computed in
+         * addition to the marginals of `which' */
+        int event_mask;
+        /* collect timers and work counters */
+        int stats;
 } options_t;
 
+/* phases of a computation */
+#define STATS_EVIDENCE 0
+#define STATS_COVERAGE 1
+#define STATS_MOMENTS  2
+#define STATS_DENSITY  3
+#define STATS_BPROB    4
+#define STATS_UTILITY  5
+#define STATS_PHASES   6
+
+/* timers and work counters of a computation, all counts are stored
+ * as doubles */
+typedef struct _stats_ {
+        /* wall-clock and cpu time of each phase in seconds, summed
+         * over all data sets of a batch */
+        double wall[STATS_PHASES];
+        double cpu [STATS_PHASES];
+        /* runs of the binning algorithm, evaluations of the interval
+         * function and of lngamma */
+        double prombs_calls;
+        double evaluations;
+        double lngamma_calls;
+        /* time that worker threads spent on tasks relative to the
+         * time they were running, zero if no workers were started */
+        double thread_utilization;
+        /* peak memory of the scratch buffers in bytes */
+        double peak_scratch;
+} stats_t;
+
 typedef struct _marginal_ {
         matrix_t *moments;
         matrix_t *density;
         vector_t *bprob;
         vector_t *mpost;
+        /* coverage[i][j]: probability that [i,j] is a bin */
+        matrix_t *coverage;
+        /* adaptive density, rows of position, p and density */
+        matrix_t *density_points;
+        /* quantiles[l][x]: quantile at level l, hdi[2l][x] and
+         * hdi[2l+1][x]: highest density interval at level l */
+        matrix_t *quantiles;
+        matrix_t *hdi;
+        /* event[k]: moments, density, quantiles and highest density
+         * intervals of event k, NULL if the event is not selected by
+         * the event mask */
+        int events;
+        struct _marginal_ **event;
+        /* NULL unless requested by the options */
+        stats_t *stats;
 } marginal_t;
 
 typedef struct _utility_ {
         matrix_t *expectation;
         vector_t *utility;
+        /* positions where the utility was computed, NULL if it is
+         * complete */
+        vector_t *complete;
+        /* positions selected by utilityBatch(), NULL otherwise */
+        vector_t *batch;
+        /* NULL unless requested by the options */
+        stats_t *stats;
 } utility_t;
 
+/* sampling strategies of the simulator */
+#define SIMULATION_UNIFORM        0
+#define SIMULATION_UNIFORM_RANDOM 1
+#define SIMULATION_UTILITY        2
+
+/* per-trial metrics of a simulation, each matrix has one row per
+ * replicate and one column per trial */
+typedef struct _simulation_ {
+        /* selected stimulus and observed event */
+        matrix_t *stimulus;
+        matrix_t *event;
+        /* Kullback-Leibler divergence between the ground truth and
+         * the posterior expectation summed over all stimuli */
+        matrix_t *kl;
+        /* posterior mean and variance at the selected stimulus */
+        matrix_t *mean;
+        matrix_t *variance;
+} simulation_t;
+
 #endif /* ADAPTIVE_SAMPLING_DATATYPES_H */
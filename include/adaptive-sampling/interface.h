@@ -27,6 +27,34 @@
 void __init__(double epsilon);
 void __free__();
 
+/* The hook is called periodically while threaded computations are
+ * running, a nonzero return value cancels all outstanding tasks and
+ * the results are incomplete. Setting a hook clears a pending
+ * interrupt. */
+void setInterruptHook(int (*hook)(void));
+int interruptPending(void);
+
+/* The progress hook receives the name of the running phase, the
+ * number of finished steps and their total. It is called by the
+ * thread that started the computation at most every 0.1 seconds and
+ * once a phase is finished, a nonzero return value cancels the
+ * computation like the interrupt hook. Setting a hook clears a
+ * pending interrupt. */
+void setProgressHook(int (*hook)(const char *phase, size_t done, size_t total));
+
+/* Cancel the running computation from any thread, all outstanding
+ * tasks are skipped until the flag is cleared with zero. */
+void setCancelled(int cancelled);
+
+/* Tasks and phases of all computations are recorded after
+ * traceStart(), each thread keeps its last `capacity' events (a
+ * default if zero). traceStop() writes the trace in Chrome
+ * trace-event format to filename (discarded if NULL) and returns
+ * nonzero if the file couldn't be written. Neither function may be
+ * called while a computation is running. */
+void traceStart(int capacity);
+int traceStop(const char *filename);
+
 marginal_t* posterior(
         int events,
         matrix_t **counts,
@@ -41,5 +69,160 @@ utility_t* utility(
         vector_t  *beta,
         matrix_t  *gamma,
         options_t *options);
+utility_t* utilityDeadline(
+        double budget,
+        vector_t  *priority,
+        int events,
+        matrix_t **counts,
+        matrix_t **alpha,
+        vector_t  *beta,
+        matrix_t  *gamma,
+        options_t *options);
+marginal_t** posteriorBatch(
+        int n,
+        int events,
+        matrix_t ***counts,
+        matrix_t ***alpha,
+        vector_t  **beta,
+        matrix_t  **gamma,
+        options_t *options);
+utility_t* utilityBatch(
+        int q,
+        int events,
+        matrix_t **counts,
+        matrix_t **alpha,
+        vector_t  *beta,
+        matrix_t  *gamma,
+        options_t *options);
+vector_t* utilityAt(
+        int pos,
+        int events,
+        matrix_t **counts,
+        matrix_t **alpha,
+        vector_t  *beta,
+        matrix_t  *gamma,
+        options_t *options);
+vector_t* utilityPath(
+        int length,
+        int events,
+        matrix_t **counts,
+        matrix_t **alpha,
+        vector_t  *beta,
+        matrix_t  *gamma,
+        options_t *options);
+double distance(
+        int x,
+        int y,
+        int events,
+        matrix_t **counts,
+        matrix_t **alpha,
+        vector_t  *beta,
+        matrix_t  *gamma,
+        options_t *options);
+simulation_t* simulate(
+        int replicates,
+        int trials,
+        vector_t  *gt,
+        double lapsing,
+        int strategy,
+        unsigned long seed,
+        int events,
+        matrix_t **alpha,
+        vector_t  *beta,
+        matrix_t  *gamma,
+        options_t *options);
+
+/* same as above for matrices that wrap caller-owned buffers */
+marginal_t* posteriorView(
+        int events,
+        matrix_view_t **counts,
+        matrix_view_t **alpha,
+        vector_t       *beta,
+        matrix_view_t  *gamma,
+        options_t *options);
+marginal_t** posteriorBatchView(
+        int n,
+        int events,
+        matrix_view_t ***counts,
+        matrix_view_t ***alpha,
+        vector_t       **beta,
+        matrix_view_t  **gamma,
+        options_t *options);
+utility_t* utilityView(
+        int events,
+        matrix_view_t **counts,
+        matrix_view_t **alpha,
+        vector_t       *beta,
+        matrix_view_t  *gamma,
+        options_t *options);
+utility_t* utilityDeadlineView(
+        double budget,
+        vector_t       *priority,
+        int events,
+        matrix_view_t **counts,
+        matrix_view_t **alpha,
+        vector_t       *beta,
+        matrix_view_t  *gamma,
+        options_t *options);
+utility_t* utilityBatchView(
+        int q,
+        int events,
+        matrix_view_t **counts,
+        matrix_view_t **alpha,
+        vector_t       *beta,
+        matrix_view_t  *gamma,
+        options_t *options);
+vector_t* utilityAtView(
+        int pos,
+        int events,
+        matrix_view_t **counts,
+        matrix_view_t **alpha,
+        vector_t       *beta,
+        matrix_view_t  *gamma,
+        options_t *options);
+vector_t* utilityPathView(
+        int length,
+        int events,
+        matrix_view_t **counts,
+        matrix_view_t **alpha,
+        vector_t       *beta,
+        matrix_view_t  *gamma,
+        options_t *options);
+double distanceView(
+        int x,
+        int y,
+        int events,
+        matrix_view_t **counts,
+        matrix_view_t **alpha,
+        vector_t       *beta,
+        matrix_view_t  *gamma,
+        options_t *options);
+simulation_t* simulateView(
+        int replicates,
+        int trials,
+        vector_t       *gt,
+        double lapsing,
+        int strategy,
+        unsigned long seed,
+        int events,
+        matrix_view_t **alpha,
+        vector_t       *beta,
+        matrix_view_t  *gamma,
+        options_t *options);
+
+/* count statistics of a KxL matrix of events and of spike timings */
+matrix_t** countsFromEvents(
+        matrix_view_t *events);
+matrix_t** countsFromTimings(
+        int trials,
+        vector_t *timings,
+        double binsize,
+        double from,
+        double to);
+matrix_t** countsFromConfig(
+        const char *filename,
+        const char *section,
+        int *events,
+        double *range);
 
 #endif /* ADAPTIVE_SAMPLING_INTERFACE */
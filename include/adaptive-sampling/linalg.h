@@ -43,12 +43,28 @@ typedef struct {
         double *content;
 } vector_t;
 
+/* rows are stored contiguously in a single block starting at
+ * content[0] */
 typedef struct {
         int rows;
         int columns;
         double **content;
 } matrix_t;
 
+#define MATRIX_ROW_MAJOR    0
+#define MATRIX_COLUMN_MAJOR 1
+
+/* A matrix that wraps a caller-owned buffer, element (i,j) is stored at
+ * data[i*stride + j] in row-major and at data[i + j*stride] in
+ * column-major layout. */
+typedef struct {
+        int rows;
+        int columns;
+        int stride;
+        int layout;
+        double *data;
+} matrix_view_t;
+
 static __inline__
 vector_t * alloc_vector(int size) {
         vector_t *v = (vector_t *)malloc(sizeof(vector_t));
@@ -60,12 +76,13 @@ vector_t * alloc_vector(int size) {
 static __inline__
 matrix_t * alloc_matrix(int rows, int columns) {
         matrix_t *m = (matrix_t *)malloc(sizeof(matrix_t));
-        m->content  = (double  **)calloc(rows, sizeof(double *));
+        m->content  = (double  **)calloc(rows > 0 ? rows : 1, sizeof(double *));
         m->rows     = rows;
         m->columns  = columns;
         int i;
-        for (i = 0; i < rows; i++) {
-                m->content[i] = (double *)calloc(columns, sizeof(double));
+        m->content[0] = (double *)calloc(rows*columns > 0 ? rows*columns : 1, sizeof(double));
+        for (i = 1; i < rows; i++) {
+                m->content[i] = m->content[0] + i*columns;
         }
         return m;
 }
@@ -78,14 +95,78 @@ void free_vector(vector_t *v) {
 
 static __inline__
 void free_matrix(matrix_t *m) {
-        int i;
-        for (i = 0; i < m->rows; i++) {
-                free(m->content[i]);
-        }
+        free(m->content[0]);
         free(m->content);
         free(m);
 }
 
+/******************************************************************************
+ * Matrix views
+ ******************************************************************************/
+
+static __inline__
+matrix_view_t * alloc_matrix_view(double *data, int rows, int columns, int stride, int layout) {
+        matrix_view_t *v = (matrix_view_t *)malloc(sizeof(matrix_view_t));
+        v->rows    = rows;
+        v->columns = columns;
+        v->stride  = stride;
+        v->layout  = layout;
+        v->data    = data;
+        return v;
+}
+
+/* the buffer is owned by the caller */
+static __inline__
+void free_matrix_view(matrix_view_t *v) {
+        free(v);
+}
+
+static __inline__
+double matrix_view_get(const matrix_view_t *v, int i, int j) {
+        if (v->layout == MATRIX_COLUMN_MAJOR) {
+                return v->data[i + j*v->stride];
+        }
+        return v->data[i*v->stride + j];
+}
+
+/* Row-major views are shared with the returned matrix, which only
+ * allocates the row pointers, column-major views are copied. */
+static __inline__
+matrix_t * matrix_from_view(const matrix_view_t *v) {
+        matrix_t *m;
+        int i, j;
+
+        if (v->layout == MATRIX_COLUMN_MAJOR) {
+                m = alloc_matrix(v->rows, v->columns);
+                for (j = 0; j < v->columns; j++) {
+                        for (i = 0; i < v->rows; i++) {
+                                m->content[i][j] = v->data[i + j*v->stride];
+                        }
+                }
+        }
+        else {
+                m = (matrix_t *)malloc(sizeof(matrix_t));
+                m->content = (double **)malloc((v->rows > 0 ? v->rows : 1)*sizeof(double *));
+                m->rows    = v->rows;
+                m->columns = v->columns;
+                for (i = 0; i < v->rows; i++) {
+                        m->content[i] = v->data + i*v->stride;
+                }
+        }
+        return m;
+}
+
+static __inline__
+void free_matrix_from_view(matrix_t *m, const matrix_view_t *v) {
+        if (v->layout == MATRIX_COLUMN_MAJOR) {
+                free_matrix(m);
+        }
+        else {
+                free(m->content);
+                free(m);
+        }
+}
+
 static __inline__
 gsl_vector * to_gsl_vector(const vector_t *vector)
 {
@@ -27,9 +27,11 @@
 #include <adaptive-sampling/probtype.h>
 
 void mgs(prob_t *result, prob_t *g, prob_t (*f)(int, int, void*), size_t L, void *data);
-void mgs_init(size_t R, size_t N, prob_t *g, prob_t (*f)(int, int, void*), size_t L, void *data);
+void mgs_init(size_t R, size_t N, prob_t *g, prob_t (*f)(int, int, void*), size_t L, void *data,
+              int (*progress)(size_t, size_t, void*), void *progress_data);
 void mgs_free();
 size_t * mgs_get_counts();
 void mgs_get_bprob(vector_t *bprob, size_t L);
+void mgs_get_coverage(matrix_t *coverage, size_t L);
 
 #endif /* ADAPTIVE_SAMPLING_MGS_H */
@@ -35,5 +35,58 @@ void prombsExt(
         prob_t (*f)(int, int, void*),
         prob_t (*h)(int, int, void*),
         size_t L, size_t m, void *data);
+/* packed upper triangular tables, f(i,j) is stored at
+ * PROMBS_TABLE_INDEX(i,j) for i <= j */
+#define PROMBS_TABLE_INDEX(i, j) ((j)*((j)+1)/2 + (i))
+/* number of columns generated by a single tile callback */
+#define PROMBS_TILE 64
+
+static __inline__
+size_t prombs_table_size(size_t L) {
+        return L*(L+1)/2;
+}
+
+/* fills columns [from, to) of a packed table */
+typedef void (*prombs_tile_t)(prob_t *table, size_t from, size_t to, void *data);
+
+void prombs_table(
+        prob_t *result,
+        const prob_t *table,
+        prob_t *g,
+        size_t L, size_t m);
+void prombsExt_table(
+        prob_t *result,
+        const prob_t *f,
+        const prob_t *h,
+        prob_t *g,
+        size_t L, size_t m);
+void prombs_tiled(
+        prob_t *result,
+        prob_t *g,
+        prombs_tile_t tile,
+        size_t L, size_t m, void *data);
+void prombs_dense(
+        prob_t *result,
+        prob_t *g,
+        const double *f,
+        size_t ld, size_t L, size_t m);
+void prombsExt_dense(
+        prob_t *result,
+        prob_t *g,
+        const double *f,
+        const double *h,
+        size_t ld, size_t L, size_t m);
+/* number of data sets that are computed together by prombs_lanes */
+#define PROMBS_LANES 8
+
+void prombs_lanes(
+        prob_t **result,
+        const prob_t *table,
+        prob_t *g,
+        size_t L, size_t m, size_t n);
+void prombs_forward(prob_t **forward, prob_t **ak, size_t L, size_t m);
+void prombs_backward(prob_t **backward, prob_t **ak, size_t L, size_t m);
+void prombs_coverage(prob_t **result, prob_t **ak, prob_t *g, prob_t (*f)(int, int, void*), size_t L, size_t m, void *data);
+void prombs_breaks(prob_t *result, prob_t **ak, prob_t *g, prob_t (*f)(int, int, void*), size_t L, size_t m, void *data);
 
 #endif /* _PROMBS_H_ */
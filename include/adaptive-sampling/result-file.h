@@ -0,0 +1,107 @@
+/* Copyright (C) 2012 Philipp Benner
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef ADAPTIVE_SAMPLING_RESULT_FILE_H
+#define ADAPTIVE_SAMPLING_RESULT_FILE_H
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <adaptive-sampling/datatypes.h>
+
+/******************************************************************************
+ * Binary result files
+ ******************************************************************************/
+
+/* A result file starts with a header of 64 bytes, followed by a table
+ * with one entry of 64 bytes for each array. Arrays are stored in
+ * row-major order at offsets that are multiples of 64 bytes, so that
+ * they can be used directly from a memory mapping of the file. All
+ * numbers are little-endian. */
+
+#define RESULT_FILE_MAGIC   "ADSAMPLE"
+#define RESULT_FILE_VERSION 1
+#define RESULT_FILE_ALIGN   64
+
+/* element types */
+#define RESULT_FLOAT64 0
+#define RESULT_INT64   1
+#define RESULT_CHAR    2
+
+typedef struct {
+        char     magic[8];
+        uint32_t version;
+        uint32_t n_arrays;
+        uint64_t size;
+        char     reserved[40];
+} result_header_t;
+
+typedef struct {
+        char     name[32];
+        uint32_t type;
+        uint32_t ndim;
+        uint64_t rows;
+        uint64_t columns;
+        uint64_t offset;
+} result_entry_t;
+
+/* arrays that are written to a file, vectors have ndim = 1 and
+ * columns = 1 */
+typedef struct {
+        const char *name;
+        int type;
+        int ndim;
+        size_t rows;
+        size_t columns;
+        const void *data;
+} result_array_t;
+
+typedef struct {
+        void *map;
+        size_t size;
+        int mapped;
+        const result_header_t *header;
+        const result_entry_t  *entries;
+} result_file_t;
+
+int writeResultFile(
+        const char *filename,
+        size_t n,
+        const result_array_t *arrays);
+result_file_t* openResultFile(
+        const char *filename);
+const void* getResultArray(
+        result_file_t *file,
+        const char *name,
+        int *type,
+        size_t *rows,
+        size_t *columns);
+void closeResultFile(
+        result_file_t *file);
+
+/* all results of a marginal_t */
+int saveResultFile(
+        const char *filename,
+        marginal_t *result);
+marginal_t* loadResultFile(
+        const char *filename);
+
+#endif /* ADAPTIVE_SAMPLING_RESULT_FILE_H */
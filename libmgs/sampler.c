@@ -114,13 +114,24 @@ void sample_multibin(
         }
 }
 
+static
+int cancelled(int (*progress)(size_t, size_t, void*), size_t done, size_t total, void *progress_data)
+{
+        return progress != NULL && (*progress)(done, total, progress_data);
+}
+
+/* The progress callback is called before each step of the burn in
+ * and the sampling with the number of finished steps, a nonzero
+ * return value stops the chain. */
 void mgs_init(
         size_t R,
         size_t N,
         prob_t *g,
         prob_t (*f)(int, int, void*),
         size_t L,
-        void *data)
+        void *data,
+        int (*progress)(size_t, size_t, void*),
+        void *progress_data)
 {
         __N__ = N;
         __multibins__    = (multibin_t**)malloc((N+1)*sizeof(multibin_t*));
@@ -136,33 +147,45 @@ void mgs_init(
         if (N > 0) {
                 /* burn in */
                 __multibins__[0] = new_multibin(L);
-                for (i = 0; i < R; i++) {
+                for (i = 0; i < R && !cancelled(progress, i, R+N, progress_data); i++) {
                         sample_multibin(g, f, data, __multibins__[0]);
                 }
 
                 __counts__[__multibins__[0]->n_bins-1]++;
                 /* sample */
-                for (i = 1; i < N; i++) {
-                        if ((i+1)%100 == 0) {
-                                notice(NONE, "Generating samples... %.1f%%", (float)100*(i+1)/N);
-                        }
+                for (i = 1; i < N && !cancelled(progress, R+i, R+N, progress_data); i++) {
                         __multibins__[i] = clone_multibin(__multibins__[i-1]);
                         sample_multibin(g, f, data, __multibins__[i]);
 
                         __counts__[__multibins__[i]->n_bins-1]++;
                 }
+                /* a cancelled chain has fewer samples */
+                if (i < N) {
+                        __multibins__[i] = (multibin_t*)NULL;
+                        __N__ = i;
+                }
+                else {
+                        cancelled(progress, R+N, R+N, progress_data);
+                }
         }
 }
 
+/* The chain is empty after it is released. */
 void mgs_free()
 {
         size_t i;
 
+        if (__multibins__ == NULL) {
+                return;
+        }
         for (i = 0; __multibins__[i]; i++) {
                 free_multibin(__multibins__[i]);
         }
         free(__multibins__);
         free(__counts__);
+        __multibins__ = NULL;
+        __counts__    = NULL;
+        __N__         = 0;
 }
 
 static
@@ -211,6 +234,26 @@ mgs_get_bprob(vector_t *bprob, size_t L)
         }
 }
 
+void
+mgs_get_coverage(matrix_t *coverage, size_t L)
+{
+        size_t i, j;
+
+        for (i = 0; i < L; i++) {
+                for (j = 0; j < L; j++) {
+                        coverage->content[i][j] = 0.0;
+                }
+        }
+        for (i = 0; i < __N__; i++) {
+                bin_t bins[__multibins__[i]->n_bins];
+
+                get_bins(__multibins__[i], bins);
+                for (j = 0; j < __multibins__[i]->n_bins; j++) {
+                        coverage->content[bins[j].from][bins[j].to] += 1.0/__N__;
+                }
+        }
+}
+
 void mgs(
         prob_t *result,
         prob_t *g,
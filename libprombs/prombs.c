@@ -25,6 +25,7 @@
 
 #include <adaptive-sampling/probtype.h>
 #include <adaptive-sampling/logarithmetic.h>
+#include <adaptive-sampling/prombs.h>
 
 /* Algorithm from Yi-Ching Yao 1984 */
 
@@ -74,6 +75,26 @@ void init_f(prob_t **ak, prob_t (*f)(int, int, void*), size_t L, void *data)
         }
 }
 
+static
+void save_result(prob_t *result, prob_t *pr, prob_t *g, size_t L, size_t m)
+{
+        size_t i;
+
+        for (i = 0; i < L-m-1; i++) {
+                /* models with i>m were not computed, store a zero */
+                result[L-1-i] = -HUGE_VAL;
+        }
+        for (i = L-m-1; i < L; i++) {
+                /* the actual results are saved here */
+                if (g[L-1-i] == -HUGE_VAL) {
+                        result[L-1-i] = -HUGE_VAL;
+                }
+                else {
+                        result[L-1-i] = pr[i] + g[L-1-i];
+                }
+        }
+}
+
 /* result: array where the result is saved
  * g: contains the prior P(m_B) for m_B = 1,...,L
  * L: the number of inputs (maximal number of bins)
@@ -102,18 +123,23 @@ void prombs(
         for (i = 0; i < m; i++) {
                 logproduct(pr, ak, L, i+1);
         }
-        /* save result */
-        for (i = 0; i < L-m-1; i++) {
-                /* models with i>m were not computed, store a zero */
-                result[L-1-i] = -HUGE_VAL;
-        }
-        for (i = L-m-1; i < L; i++) {
-                /* the actual results are saved here */
-                if (g[L-1-i] == -HUGE_VAL) {
-                        result[L-1-i] = -HUGE_VAL;
+        save_result(result, pr, g, L, m);
+}
+
+/* result: prombs of f + epsilon*h on entry, derivative on exit
+ * tmp: prombs of f */
+static
+void save_difference(prob_t *result, prob_t *tmp, size_t L)
+{
+        size_t i;
+
+        for (i = 0; i < L; i++) {
+                if (result[i] != tmp[i]) {
+                        result[i] = logsub(result[i], tmp[i]) - LOG(prombsExt_epsilon);
                 }
                 else {
-                        result[L-1-i] = pr[i] + g[L-1-i];
+                        /* this can happen if all counts are zero */
+                        result[i] = -HUGE_VAL;
                 }
         }
 }
@@ -134,20 +160,400 @@ void prombsExt(
         size_t m,
         void *data)
 {
-        size_t i;
         prob_t tmp[L];
         prombsExt_f = f;
         prombsExt_h = h;
         prombs(result, ak, g, &prombsExt_fprime, L, m, data);
         prombs(tmp, ak, g, f, L, m, data);
 
+        save_difference(result, tmp, L);
+}
+
+/******************************************************************************
+ * Packed tables
+ ******************************************************************************/
+
+/* The upper triangle f(i,j), i <= j, is stored column by column, so
+ * that the inner loop of the product runs over a contiguous column
+ * of the table. Elements of the last multibin with j >= L are one
+ * for k == j and zero otherwise, which is why they only copy tmp. */
+static
+void logproduct_table(prob_t *result, const prob_t *table, size_t L, size_t i)
+{
+        prob_t tmp[L], sum;
+        const prob_t *column;
+        size_t j, k;
+
+        for (j = 0; j < L; j++) {
+                tmp[j] = result[j];
+        }
+        for (j = i; j < L; j++) {
+                column = table + PROMBS_TABLE_INDEX(0, j);
+                sum    = -HUGE_VAL;
+                for (k = i; k <= j; k++) {
+                        sum = logadd(sum, tmp[k-i] + column[k]);
+                }
+                result[j-i] = sum;
+        }
+        for (j = L; j < L+i; j++) {
+                result[j-i] = tmp[j-i];
+        }
+}
+
+/* table: packed table of the bin evidences on log scale
+ * g: contains the prior P(m_B) for m_B = 1,...,L
+ * m: the maximal number of bins minus one */
+void prombs_table(
+        prob_t *result,
+        const prob_t *table,
+        prob_t *g,
+        size_t L,
+        size_t m)
+{
+        prob_t pr[L];
+        size_t i, j;
+
+        for (j = 0; j < L; j++) {
+                pr[j] = table[PROMBS_TABLE_INDEX(0, j)];
+        }
+        for (i = 0; i < m; i++) {
+                logproduct_table(pr, table, L, i+1);
+        }
+        save_result(result, pr, g, L, m);
+}
+
+void prombsExt_table(
+        prob_t *result,
+        const prob_t *f, /* on log scale */
+        const prob_t *h, /* on normal scale */
+        prob_t *g,
+        size_t L,
+        size_t m)
+{
+        size_t i, n = prombs_table_size(L);
+        prob_t *fprime = (prob_t *)malloc(n*sizeof(prob_t));
+        prob_t tmp[L];
+
+        for (i = 0; i < n; i++) {
+                fprime[i] = f[i] + prombsExt_epsilon*h[i];
+        }
+        prombs_table(result, fprime, g, L, m);
+        prombs_table(tmp, f, g, L, m);
+        save_difference(result, tmp, L);
+
+        free(fprime);
+}
+
+/* The table is generated in tiles of PROMBS_TILE columns, so that a
+ * caller pays one indirect call per tile instead of one per element. */
+void prombs_tiled(
+        prob_t *result,
+        prob_t *g,
+        prombs_tile_t tile,
+        size_t L,
+        size_t m,
+        void *data)
+{
+        prob_t *table = (prob_t *)malloc(prombs_table_size(L)*sizeof(prob_t));
+        size_t j;
+
+        for (j = 0; j < L; j += PROMBS_TILE) {
+                (*tile)(table, j, j+PROMBS_TILE < L ? j+PROMBS_TILE : L, data);
+        }
+        prombs_table(result, table, g, L, m);
+
+        free(table);
+}
+
+/* Dense tables are stored in column-major order with leading
+ * dimension ld, i.e. f(i,j) = f[i + j*ld], which is the layout of
+ * MATLAB and R matrices. */
+static
+prob_t * pack_dense(const double *f, size_t ld, size_t L)
+{
+        prob_t *table = (prob_t *)malloc(prombs_table_size(L)*sizeof(prob_t));
+        size_t i, j;
+
+        for (j = 0; j < L; j++) {
+                for (i = 0; i <= j; i++) {
+                        table[PROMBS_TABLE_INDEX(i, j)] = f[i + j*ld];
+                }
+        }
+        return table;
+}
+
+void prombs_dense(
+        prob_t *result,
+        prob_t *g,
+        const double *f, /* on log scale */
+        size_t ld,
+        size_t L,
+        size_t m)
+{
+        prob_t *table = pack_dense(f, ld, L);
+
+        prombs_table(result, table, g, L, m);
+
+        free(table);
+}
+
+void prombsExt_dense(
+        prob_t *result,
+        prob_t *g,
+        const double *f, /* on log scale */
+        const double *h, /* on normal scale */
+        size_t ld,
+        size_t L,
+        size_t m)
+{
+        prob_t *ftable = pack_dense(f, ld, L);
+        prob_t *htable = pack_dense(h, ld, L);
+
+        prombsExt_table(result, ftable, htable, g, L, m);
+
+        free(ftable);
+        free(htable);
+}
+
+/******************************************************************************
+ * Several data sets at once
+ ******************************************************************************/
+
+/* The packed tables of n data sets are interleaved, i.e. f_l(i,j) is
+ * stored at table[PROMBS_TABLE_INDEX(i,j)*n + l]. All lanes follow
+ * the same recursion, so that the innermost loop runs over the lanes
+ * without any data dependent control flow. */
+static
+void logproduct_lanes(prob_t *result, prob_t *tmp, const prob_t *table, size_t L, size_t i, size_t n)
+{
+        prob_t sum[n];
+        const prob_t *column, *t;
+        size_t j, k, l;
+
+        for (j = 0; j < L*n; j++) {
+                tmp[j] = result[j];
+        }
+        for (j = i; j < L; j++) {
+                for (l = 0; l < n; l++) {
+                        sum[l] = -HUGE_VAL;
+                }
+                for (k = i; k <= j; k++) {
+                        column = table + PROMBS_TABLE_INDEX(k, j)*n;
+                        t      = tmp + (k-i)*n;
+                        for (l = 0; l < n; l++) {
+                                sum[l] = logadd(sum[l], t[l] + column[l]);
+                        }
+                }
+                for (l = 0; l < n; l++) {
+                        result[(j-i)*n + l] = sum[l];
+                }
+        }
+        for (j = L; j < L+i; j++) {
+                for (l = 0; l < n; l++) {
+                        result[(j-i)*n + l] = tmp[(j-i)*n + l];
+                }
+        }
+}
+
+/* result: array of n results, one for each data set
+ * table: interleaved packed tables of n data sets that share the
+ *        prior g and the maximal number of bins */
+void prombs_lanes(
+        prob_t **result,
+        const prob_t *table,
+        prob_t *g,
+        size_t L,
+        size_t m,
+        size_t n)
+{
+        /* the interleaved arrays are too large for the stack of a
+         * worker thread */
+        prob_t *pr  = (prob_t *)malloc(L*n*sizeof(prob_t));
+        prob_t *tmp = (prob_t *)malloc(L*n*sizeof(prob_t));
+        prob_t lane[L];
+        size_t i, j, l;
+
+        for (j = 0; j < L; j++) {
+                for (l = 0; l < n; l++) {
+                        pr[j*n + l] = table[PROMBS_TABLE_INDEX(0, j)*n + l];
+                }
+        }
+        for (i = 0; i < m; i++) {
+                logproduct_lanes(pr, tmp, table, L, i+1, n);
+        }
+        for (l = 0; l < n; l++) {
+                for (j = 0; j < L; j++) {
+                        lane[j] = pr[j*n + l];
+                }
+                save_result(result[l], lane, g, L, m);
+        }
+        free(pr);
+        free(tmp);
+}
+
+/******************************************************************************
+ * Forward and backward sums
+ ******************************************************************************/
+
+/* forward[k][j]: sum over all multibins of [0,j] with k+1 bins
+ * ak: contains the bin evidences f(i,j) on log scale
+ * m: the maximal number of bins minus one */
+void prombs_forward(
+        prob_t **forward,
+        prob_t **ak,
+        size_t L,
+        size_t m)
+{
+        size_t j, k, t;
+
+        for (j = 0; j < L; j++) {
+                forward[0][j] = ak[0][j];
+        }
+        for (k = 1; k <= m; k++) {
+                for (j = 0; j < L; j++) {
+                        forward[k][j] = -HUGE_VAL;
+                        /* the last bin is [t,j] */
+                        for (t = k; t <= j; t++) {
+                                forward[k][j] = logadd(forward[k][j], forward[k-1][t-1] + ak[t][j]);
+                        }
+                }
+        }
+}
+
+/* backward[k][i]: sum over all multibins of [i,L-1] with k+1 bins */
+void prombs_backward(
+        prob_t **backward,
+        prob_t **ak,
+        size_t L,
+        size_t m)
+{
+        size_t i, k, t;
+
         for (i = 0; i < L; i++) {
-                if (result[i] != tmp[i]) {
-                        result[i] = logsub(result[i], tmp[i]) - LOG(prombsExt_epsilon);
+                backward[0][i] = ak[i][L-1];
+        }
+        for (k = 1; k <= m; k++) {
+                for (i = 0; i < L; i++) {
+                        backward[k][i] = -HUGE_VAL;
+                        /* the first bin is [i,t] */
+                        for (t = i; t+k < L; t++) {
+                                backward[k][i] = logadd(backward[k][i], ak[i][t] + backward[k-1][t+1]);
+                        }
                 }
-                else {
-                        /* this can happen if all counts are zero */
-                        result[i] = -HUGE_VAL;
+        }
+}
+
+/* result[i][j]: sum over all multibins that contain [i,j] as a bin,
+ * weighted by the prior g, which is P([i,j] is a bin, D) if f(i,j)
+ * is the evidence of bin [i,j]
+ * g: contains the prior P(m_B) for m_B = 1,...,L
+ * m: the maximal number of bins minus one */
+void prombs_coverage(
+        prob_t **result,
+        prob_t **ak,
+        prob_t *g,
+        prob_t (*f)(int, int, void*),
+        size_t L,
+        size_t m,
+        void *data)
+{
+        prob_t **forward  = (prob_t **)malloc((m+1)*sizeof(prob_t *));
+        prob_t **backward = (prob_t **)malloc((m+1)*sizeof(prob_t *));
+        prob_t h[m+1], tmp;
+        size_t i, j, n1, n2;
+
+        for (i = 0; i <= m; i++) {
+                forward [i] = (prob_t *)malloc(L*sizeof(prob_t));
+                backward[i] = (prob_t *)malloc(L*sizeof(prob_t));
+        }
+        /* init */
+        if (f != NULL) {
+                init_f(ak, f, L, data);
+        }
+        prombs_forward (forward,  ak, L, m);
+        prombs_backward(backward, ak, L, m);
+
+        for (i = 0; i < L; i++) {
+                /* h[n2]: multibins of [0,i-1] with n1 bins weighted
+                 * by the prior for n1+n2+1 bins */
+                for (n2 = 0; n2 <= m; n2++) {
+                        if (i == 0) {
+                                h[n2] = g[n2];
+                                continue;
+                        }
+                        h[n2] = -HUGE_VAL;
+                        for (n1 = 1; n1+n2 <= m; n1++) {
+                                h[n2] = logadd(h[n2], forward[n1-1][i-1] + g[n1+n2]);
+                        }
+                }
+                for (j = i; j < L; j++) {
+                        if (j == L-1) {
+                                tmp = h[0];
+                        }
+                        else {
+                                tmp = -HUGE_VAL;
+                                for (n2 = 1; n2 <= m; n2++) {
+                                        tmp = logadd(tmp, h[n2] + backward[n2-1][j+1]);
+                                }
+                        }
+                        result[i][j] = ak[i][j] + tmp;
                 }
         }
+        for (i = 0; i <= m; i++) {
+                free(forward [i]);
+                free(backward[i]);
+        }
+        free(forward);
+        free(backward);
+}
+
+/* result[i]: sum over all multibins with a break between positions
+ * i-1 and i, weighted by the prior g, which is P(break at i, D) if
+ * f(i,j) is the evidence of bin [i,j], every multibin has a break at
+ * position 0
+ * g: contains the prior P(m_B) for m_B = 1,...,L
+ * m: the maximal number of bins minus one */
+void prombs_breaks(
+        prob_t *result,
+        prob_t **ak,
+        prob_t *g,
+        prob_t (*f)(int, int, void*),
+        size_t L,
+        size_t m,
+        void *data)
+{
+        prob_t **forward  = (prob_t **)malloc((m+1)*sizeof(prob_t *));
+        prob_t **backward = (prob_t **)malloc((m+1)*sizeof(prob_t *));
+        size_t i, n1, n2;
+
+        for (i = 0; i <= m; i++) {
+                forward [i] = (prob_t *)malloc(L*sizeof(prob_t));
+                backward[i] = (prob_t *)malloc(L*sizeof(prob_t));
+        }
+        /* init */
+        if (f != NULL) {
+                init_f(ak, f, L, data);
+        }
+        prombs_forward (forward,  ak, L, m);
+        prombs_backward(backward, ak, L, m);
+
+        result[0] = -HUGE_VAL;
+        for (n1 = 0; n1 <= m; n1++) {
+                result[0] = logadd(result[0], forward[n1][L-1] + g[n1]);
+        }
+        for (i = 1; i < L; i++) {
+                /* n1 bins in [0,i-1] and n2 bins in [i,L-1] */
+                result[i] = -HUGE_VAL;
+                for (n1 = 1; n1 <= m; n1++) {
+                        for (n2 = 1; n1+n2 <= m+1; n2++) {
+                                result[i] = logadd(result[i], forward[n1-1][i-1] + backward[n2-1][i] + g[n1+n2-1]);
+                        }
+                }
+        }
+        for (i = 0; i <= m; i++) {
+                free(forward [i]);
+                free(backward[i]);
+        }
+        free(forward);
+        free(backward);
 }
@@ -31,6 +31,13 @@ function result = adsamp(counts, varargin)
 %  'which', 0: for which event to compute the binning
 %  'hmm', 0: use hidden Markov model
 %  'rho', 0.4: cohesion parameter for the hidden Markov model
+%  'prune', 0: evaluate the exact utility only where it might be maximal
+%  'prune_ties', 0: keep exact ties when pruning
+%  'coverage', 0: return the probability that an interval is a bin
+%  'density_accuracy', 0: evaluate the density adaptively up to this L1 error
+%  'levels', []: compute quantiles and highest density intervals at these levels
+%  'events', []: further events for which all marginals are computed
+%  'stats', 0: collect phase timers and work counters
 %  'samples', [100 2000]
 %
 %
@@ -82,6 +89,13 @@ p.addParamValue('algorithm', 'prombs', @ischar);
 p.addParamValue('which', 0, @isscalar);
 p.addParamValue('hmm', 0, @isscalar);
 p.addParamValue('rho', 0.4, @isscalar);
+p.addParamValue('prune', 0, @isscalar);
+p.addParamValue('prune_ties', 0, @isscalar);
+p.addParamValue('coverage', 0, @isscalar);
+p.addParamValue('density_accuracy', 0, @isscalar);
+p.addParamValue('levels', [], @isnumeric);
+p.addParamValue('events', [], @isnumeric);
+p.addParamValue('stats', 0, @isscalar);
 p.addParamValue('samples', [100 2000], ispair);
 p.KeepUnmatched = true;
 p.parse(varargin{:});
@@ -30,25 +30,25 @@ marginal_t * callBinning(const mxArray *prhs[]) {
         size_t K = mxGetDimensions(prhs[0])[0];
         size_t L = mxGetDimensions(prhs[0])[1];
 
-        matrix_t** counts;
-        matrix_t** alpha;
+        matrix_view_t** counts;
+        matrix_view_t** alpha;
         vector_t* beta;
-        matrix_t* gamma;
+        matrix_view_t* gamma;
         options_t* options;
         marginal_t * result;
 
-        counts  = getCounts(prhs[0], K, L);
-        alpha   = getAlpha(prhs[1], K, L);
+        counts  = getCountsView(prhs[0], K, L);
+        alpha   = getAlphaView(prhs[1], K, L);
         beta    = getBeta(prhs[2], L);
-        gamma   = getGamma(prhs[3], L);
+        gamma   = getGammaView(prhs[3], L);
         options = getOptions(prhs[4]);
 
-        result  = posterior(K, counts, alpha, beta, gamma, options);
+        result  = posteriorView(K, counts, alpha, beta, gamma, options);
 
-        freeCounts(counts);
-        freeAlpha(alpha);
+        free3DView(counts);
+        free3DView(alpha);
         free_vector(beta);
-        free_matrix(gamma);
+        free_matrix_view(gamma);
         free(options);
 
         return result;
@@ -57,7 +57,10 @@ marginal_t * callBinning(const mxArray *prhs[]) {
 static
 void copyResult(marginal_t* result, mxArray *plhs[]) {
         const char **fnames;
-        const int nfields = 4;
+        const int nfields = 10;
+        mxArray *events;
+        mxArray *tmp;
+        int k;
 
         /* allocate memory  for storing pointers */
         fnames = mxCalloc(nfields, sizeof(*fnames));
@@ -65,6 +68,12 @@ void copyResult(marginal_t* result, mxArray *plhs[]) {
         fnames[1] = "density";
         fnames[2] = "bprob";
         fnames[3] = "mpost";
+        fnames[4] = "coverage";
+        fnames[5] = "density_points";
+        fnames[6] = "quantiles";
+        fnames[7] = "hdi";
+        fnames[8] = "events";
+        fnames[9] = "stats";
 
         plhs[0] = mxCreateStructMatrix(1, 1, nfields, fnames);
         mxFree((void *)fnames);
@@ -81,10 +90,37 @@ void copyResult(marginal_t* result, mxArray *plhs[]) {
         if (result->mpost) {
                 mxSetField(plhs[0], 0, "mpost", copyVectorToMatlab(result->mpost));
         }
+        if (result->coverage) {
+                mxSetField(plhs[0], 0, "coverage", copyMatrixToMatlab(result->coverage));
+        }
+        if (result->density_points) {
+                mxSetField(plhs[0], 0, "density_points", copyMatrixToMatlab(result->density_points));
+        }
+        if (result->quantiles) {
+                mxSetField(plhs[0], 0, "quantiles", copyMatrixToMatlab(result->quantiles));
+        }
+        if (result->hdi) {
+                mxSetField(plhs[0], 0, "hdi", copyMatrixToMatlab(result->hdi));
+        }
+        if (result->event) {
+                events = mxCreateCellMatrix(1, result->events);
+                for (k = 0; k < result->events; k++) {
+                        if (result->event[k]) {
+                                copyResult(result->event[k], &tmp);
+                                mxSetCell(events, k, tmp);
+                        }
+                }
+                mxSetField(plhs[0], 0, "events", events);
+        }
+        if (result->stats) {
+                mxSetField(plhs[0], 0, "stats", copyStatsToMatlab(result->stats));
+        }
 }
 
 static
 void freeResult(marginal_t * result) {
+        int k;
+
         if (result->moments) {
                 free_matrix(result->moments);
         }
@@ -97,6 +133,27 @@ void freeResult(marginal_t * result) {
         if (result->mpost) {
                 free_vector(result->mpost);
         }
+        if (result->coverage) {
+                free_matrix(result->coverage);
+        }
+        if (result->density_points) {
+                free_matrix(result->density_points);
+        }
+        if (result->quantiles) {
+                free_matrix(result->quantiles);
+        }
+        if (result->hdi) {
+                free_matrix(result->hdi);
+        }
+        if (result->event) {
+                for (k = 0; k < result->events; k++) {
+                        if (result->event[k]) {
+                                freeResult(result->event[k]);
+                        }
+                }
+                free(result->event);
+        }
+        free(result->stats);
         free(result);
 }
 
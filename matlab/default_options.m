@@ -28,5 +28,13 @@ options.samples(1) = 0;       % mgs burn in
 options.samples(2) = 0;       % mgs samples
 options.hmm        = 0;       % do not use the hidden Markov model
 options.rho        = 0.4;     % cohesion for the hidden Markov model
+options.prune      = 0;       % evaluate the exact utility only where
+                              % it might be maximal
+options.prune_ties = 0;       % keep exact ties when pruning
+options.coverage   = 0;       % do not return the posterior of all bins
+options.density_accuracy = 0; % evaluate the density on the full grid
+options.levels     = [];      % no quantiles or highest density intervals
+options.events     = [];      % no marginals of further events
+options.stats      = 0;       % do not collect timers and counters
 
 end % default_options
@@ -34,59 +34,62 @@ double getScalar(const mxArray* array, const char* name) {
         return *mxGetPr(tmp);
 }
 
+/* MATLAB arrays are stored in column-major order, element (i,j) of
+ * an MxN matrix is at position i + j*M of the buffer */
 mxArray* copyMatrixToMatlab(matrix_t* in) {
-        mxArray *out  = mxCreateDoubleMatrix(in->rows, in->columns, mxREAL);
-        mwSize  nsubs = mxGetNumberOfDimensions(out);
-        mwIndex* subs = mxCalloc(nsubs,sizeof(mwIndex));
+        mxArray *out = mxCreateDoubleMatrix(in->rows, in->columns, mxREAL);
         double* m = mxGetPr(out);
-        mwIndex index;
         size_t i, j;
 
         for (i = 0; i < in->rows; i++) {
                 for (j = 0; j < in->columns; j++) {
-                        subs[0] = i;
-                        subs[1] = j;
-                        index = mxCalcSingleSubscript(out, nsubs, subs);
-                        m[index] = in->content[i][j];
+                        m[i + j*in->rows] = in->content[i][j];
                 }
         }
-        mxFree(subs);
 
         return out;
 }
 
 mxArray* copyVectorToMatlab(vector_t* in) {
-        mxArray *out  = mxCreateDoubleMatrix(1, in->size, mxREAL);
-        mwSize  nsubs = mxGetNumberOfDimensions(out);
-        mwIndex* subs = mxCalloc(nsubs,sizeof(mwIndex));
-        double* m = mxGetPr(out);
-        mwIndex index;
-        size_t i;
+        mxArray *out = mxCreateDoubleMatrix(1, in->size, mxREAL);
 
-        for (i = 0; i < in->size; i++) {
-                subs[1] = i;
-                index = mxCalcSingleSubscript(out, nsubs, subs);
-                m[index] = in->content[i];
-        }
-        mxFree(subs);
+        memcpy(mxGetPr(out), in->content, in->size*sizeof(double));
 
         return out;
 }
 
 mxArray* copyArrayToMatlab(prob_t* in, size_t size) {
-        mxArray *out  = mxCreateDoubleMatrix(1, size, mxREAL);
-        mwSize  nsubs = mxGetNumberOfDimensions(out);
-        mwIndex* subs = mxCalloc(nsubs,sizeof(mwIndex));
+        mxArray *out = mxCreateDoubleMatrix(1, size, mxREAL);
         double* m = mxGetPr(out);
-        mwIndex index;
         size_t i;
 
         for (i = 0; i < size; i++) {
-                subs[1] = i;
-                index = mxCalcSingleSubscript(out, nsubs, subs);
-                m[index] = in[i];
+                m[i] = in[i];
         }
-        mxFree(subs);
+
+        return out;
+}
+
+mxArray* copyStatsToMatlab(stats_t* in) {
+        const char *fnames[] = {
+                "wall", "cpu", "prombs_calls", "evaluations",
+                "lngamma_calls", "thread_utilization", "peak_scratch" };
+        mxArray *out  = mxCreateStructMatrix(1, 1, 7, fnames);
+        mxArray *wall = mxCreateDoubleMatrix(1, STATS_PHASES, mxREAL);
+        mxArray *cpu  = mxCreateDoubleMatrix(1, STATS_PHASES, mxREAL);
+        size_t i;
+
+        for (i = 0; i < STATS_PHASES; i++) {
+                mxGetPr(wall)[i] = in->wall[i];
+                mxGetPr(cpu) [i] = in->cpu[i];
+        }
+        mxSetField(out, 0, "wall", wall);
+        mxSetField(out, 0, "cpu",  cpu);
+        mxSetField(out, 0, "prombs_calls",       mxCreateDoubleScalar(in->prombs_calls));
+        mxSetField(out, 0, "evaluations",        mxCreateDoubleScalar(in->evaluations));
+        mxSetField(out, 0, "lngamma_calls",      mxCreateDoubleScalar(in->lngamma_calls));
+        mxSetField(out, 0, "thread_utilization", mxCreateDoubleScalar(in->thread_utilization));
+        mxSetField(out, 0, "peak_scratch",       mxCreateDoubleScalar(in->peak_scratch));
 
         return out;
 }
@@ -96,6 +99,7 @@ options_t* getOptions(const mxArray *array)
         options_t* options = (options_t*)malloc(sizeof(options_t));
         mxArray* tmp;
         double*  ptr;
+        size_t   i;
 
         options->model_posterior = getScalar(array, "model_posterior");
         options->kl_psi = getScalar(array, "kl_psi");
@@ -124,6 +128,24 @@ options_t* getOptions(const mxArray *array)
         options->which = getScalar(array, "which");
         options->hmm = getScalar(array, "hmm");
         options->rho = getScalar(array, "rho");
+        options->prune = getScalar(array, "prune");
+        options->prune_ties = getScalar(array, "prune_ties");
+        options->coverage = getScalar(array, "coverage");
+        options->density_accuracy = getScalar(array, "density_accuracy");
+        options->stats = getScalar(array, "stats");
+
+        tmp = mxGetField(array, 0, "levels");
+        if (tmp == 0) invalidOptions("levels");
+        options->n_levels = mxGetNumberOfElements(tmp);
+        options->levels   = mxGetPr(tmp);
+
+        tmp = mxGetField(array, 0, "events");
+        if (tmp == 0) invalidOptions("events");
+        ptr = mxGetPr(tmp);
+        options->event_mask = 0;
+        for (i = 0; i < mxGetNumberOfElements(tmp); i++) {
+                options->event_mask |= 1 << (int)ptr[i];
+        }
 
         tmp = mxGetField(array, 0, "samples");
         if (tmp == 0) invalidOptions("samples");
@@ -137,72 +159,45 @@ options_t* getOptions(const mxArray *array)
 void copyMatrix(matrix_t* to, const mxArray* from) {
         const size_t R = to->rows;
         const size_t C = to->columns;
+        const size_t M = mxGetM(from);
         double* m = mxGetPr(from);
         size_t i, j;
-        mwSize  nsubs = mxGetNumberOfDimensions(from);
-        mwIndex* subs = mxCalloc(nsubs,sizeof(mwIndex));
-        mwIndex index;
 
         for (i = 0; i < R; i++) {
                 for (j = 0; j < C; j++) {
-                        subs[0] = i;
-                        subs[1] = j;
-                        index = mxCalcSingleSubscript(from, nsubs, subs);
-                        to->content[i][j] = m[index];
+                        to->content[i][j] = m[i + j*M];
                 }
         }
-        mxFree(subs);
 }
 
+/* element (which,i,j) of a KxLxL array is at which + i*K + j*K*L */
 void copy3DMatrix(matrix_t* to, const mxArray* from, size_t which) {
         const size_t R = to->rows;
         const size_t C = to->columns;
-        double* m = mxGetPr(from);
+        const size_t K = mxGetDimensions(from)[0];
+        const size_t L = mxGetDimensions(from)[1];
+        double* m = mxGetPr(from) + which;
         size_t i, j;
-        mwSize  nsubs = mxGetNumberOfDimensions(from);
-        mwIndex* subs = mxCalloc(nsubs,sizeof(mwIndex));
-        mwIndex index;
 
         for (i = 0; i < R; i++) {
                 for (j = 0; j < C; j++) {
-                        subs[0] = which;
-                        subs[1] = i;
-                        subs[2] = j;
-                        index = mxCalcSingleSubscript(from, nsubs, subs);
-                        to->content[i][j] = m[index];
+                        to->content[i][j] = m[i*K + j*K*L];
                 }
         }
-        mxFree(subs);
 }
 
+/* vectors are contiguous irrespective of their orientation */
 void copyVector(vector_t* to, const mxArray* from) {
-        double* v = mxGetPr(from);
-        size_t i;
-        mwSize  nsubs = mxGetNumberOfDimensions(from);
-        mwIndex* subs = mxCalloc(nsubs,sizeof(mwIndex));
-        mwIndex index;
-
-        for (i = 0; i < to->size; i++) {
-                subs[0] = i;
-                index = mxCalcSingleSubscript(from, nsubs, subs);
-                to->content[i] = v[index];
-        }
-        mxFree(subs);
+        memcpy(to->content, mxGetPr(from), to->size*sizeof(double));
 }
 
 void copyArray(prob_t* to, const mxArray* from, size_t size) {
         double* v = mxGetPr(from);
         size_t i;
-        mwSize  nsubs = mxGetNumberOfDimensions(from);
-        mwIndex* subs = mxCalloc(nsubs,sizeof(mwIndex));
-        mwIndex index;
 
         for (i = 0; i < size; i++) {
-                subs[0] = i;
-                index = mxCalcSingleSubscript(from, nsubs, subs);
-                to[i] = v[index];
+                to[i] = v[i];
         }
-        mxFree(subs);
 }
 
 matrix_t** getCounts(const mxArray* array, size_t K, size_t L) {
@@ -286,3 +281,62 @@ matrix_t* getGamma(const mxArray* array, size_t L) {
 
         return gamma;
 }
+
+/* A KxLxL array is split into K row-major LxL blocks in a single
+ * sweep over the MATLAB buffer, which is then passed to the library
+ * without any further copy. */
+static
+matrix_view_t** get3DView(const mxArray* array, size_t K, size_t L, const char* msg) {
+        if (mxGetNumberOfDimensions(array) != 3) {
+                mexErrMsgTxt(msg);
+        }
+        if (mxGetDimensions(array)[0] != K ||
+            mxGetDimensions(array)[1] != L ||
+            mxGetDimensions(array)[2] != L) {
+                mexErrMsgTxt(msg);
+        }
+        matrix_view_t** view = (matrix_view_t**)malloc((K+1)*sizeof(matrix_view_t*));
+        double* buffer = (double*)malloc(K*L*L*sizeof(double));
+        double* m = mxGetPr(array);
+        size_t i, j, k;
+
+        for (j = 0; j < L; j++) {
+                for (i = 0; i < L; i++) {
+                        for (k = 0; k < K; k++) {
+                                buffer[k*L*L + i*L + j] = *m++;
+                        }
+                }
+        }
+        for (k = 0; k < K; k++) {
+                view[k] = alloc_matrix_view(buffer + k*L*L, L, L, L, MATRIX_ROW_MAJOR);
+        }
+        view[k] = NULL;
+
+        return view;
+}
+
+matrix_view_t** getCountsView(const mxArray* array, size_t K, size_t L) {
+        return get3DView(array, K, L, "Invalid dimension of counts matrix.");
+}
+
+matrix_view_t** getAlphaView(const mxArray* array, size_t K, size_t L) {
+        return get3DView(array, K, L, "Invalid dimension of alpha matrix.");
+}
+
+void free3DView(matrix_view_t** view) {
+        size_t i;
+
+        free(view[0]->data);
+        for (i = 0; view[i]; i++) {
+                free_matrix_view(view[i]);
+        }
+        free(view);
+}
+
+/* the view shares the MATLAB buffer */
+matrix_view_t* getGammaView(const mxArray* array, size_t L) {
+        if (mxGetN(array) != L || mxGetM(array) != L) {
+                mexErrMsgTxt("Invalid dimension of gamma matrix.");
+        }
+        return alloc_matrix_view(mxGetPr(array), L, L, L, MATRIX_COLUMN_MAJOR);
+}
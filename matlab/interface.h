@@ -38,6 +38,7 @@ double getScalar(const mxArray* array, const char* name);
 mxArray* copyMatrixToMatlab(matrix_t* in);
 mxArray* copyVectorToMatlab(vector_t* in);
 mxArray* copyArrayToMatlab(prob_t* in, size_t size);
+mxArray* copyStatsToMatlab(stats_t* in);
 options_t* getOptions(const mxArray *array);
 void copyMatrix(matrix_t* to, const mxArray* from);
 void copy3DMatrix(matrix_t* to, const mxArray* from, size_t which);
@@ -49,3 +50,7 @@ matrix_t** getAlpha(const mxArray* array, size_t K, size_t L);
 void freeAlpha(matrix_t** alpha);
 vector_t* getBeta(const mxArray* array, size_t L);
 matrix_t* getGamma(const mxArray* array, size_t L);
+matrix_view_t** getCountsView(const mxArray* array, size_t K, size_t L);
+matrix_view_t** getAlphaView(const mxArray* array, size_t K, size_t L);
+void free3DView(matrix_view_t** view);
+matrix_view_t* getGammaView(const mxArray* array, size_t L);
@@ -0,0 +1,45 @@
+function result = load_result(filename)
+% LOAD_RESULT
+%   Load a binary result file. The file starts with a header of 64
+%   bytes followed by a table with one entry of 64 bytes for each
+%   array, arrays are stored in row-major order.
+%
+  fid = fopen(filename, 'r', 'ieee-le');
+  if fid == -1
+    error('Could not open result file.');
+  end
+  magic = fread(fid, [1 8], 'uint8=>char');
+  if ~strcmp(magic, 'ADSAMPLE')
+    fclose(fid);
+    error('Invalid result file.');
+  end
+  version  = fread(fid, 1, 'uint32');
+  n_arrays = fread(fid, 1, 'uint32');
+
+  result = struct();
+  for i = 1:n_arrays
+    fseek(fid, 64*i, 'bof');
+    name    = deblank(fread(fid, [1 32], 'uint8=>char'));
+    name    = name(name ~= 0);
+    type    = fread(fid, 1, 'uint32');
+    ndim    = fread(fid, 1, 'uint32');
+    rows    = fread(fid, 1, 'uint64');
+    columns = fread(fid, 1, 'uint64');
+    offset  = fread(fid, 1, 'uint64');
+    fseek(fid, offset, 'bof');
+    switch type
+      case 0
+        data = fread(fid, [columns rows], 'double')';
+      case 1
+        data = fread(fid, [columns rows], 'int64=>double')';
+      otherwise
+        data = fread(fid, [1 rows*columns], 'uint8=>char');
+    end
+    if ndim == 1 && type ~= 2
+      data = reshape(data', 1, rows*columns);
+    end
+    result.(name) = data;
+  end
+  fclose(fid);
+
+end % load_result
@@ -23,64 +23,16 @@
 
 #include <adaptive-sampling/prombs.h>
 
-static __inline__
-prob_t** alloc_prombs_matrix(size_t L) {
-        size_t i;
-        prob_t** m = (prob_t **)malloc(L*sizeof(prob_t*));
-        for (i = 0; i < L; i++) {
-                m[i] = (prob_t *)malloc(L*sizeof(prob_t));
-        }
-        return m;
-}
-
-static __inline__
-void free_prombs_matrix(prob_t** m, size_t L) {
-        size_t i;
-        for (i = 0; i < L; i++) {
-                free(m[i]);
-        }
-        free(m);
-}
-
-typedef struct _data_t_ {
-        const mxArray* f;
-        const mxArray* h;
-        mwSize  nsubs;
-        mwIndex* subs;
-} data_t;
-
-prob_t prombs_f(int i, int j, void* _data)
-{
-        data_t* data = (data_t *)_data;
-
-        data->subs[0] = i;
-        data->subs[1] = j;
-        return mxGetPr(data->f)[mxCalcSingleSubscript(data->f, data->nsubs, data->subs)];
-}
-
-prob_t prombs_h(int i, int j, void* _data)
-{
-        data_t* data = (data_t *)_data;
-
-        data->subs[0] = i;
-        data->subs[1] = j;
-        return mxGetPr(data->h)[mxCalcSingleSubscript(data->h, data->nsubs, data->subs)];
-}
-
 static
 mxArray* callPrombs(const mxArray *prhs[], size_t L, size_t m)
 {
-        prob_t** ak = alloc_prombs_matrix(L);
         prob_t g[L];
         prob_t result[L];
-        mwSize nsubs = mxGetNumberOfDimensions(prhs[1]);
-        data_t data  = { prhs[1], prhs[2], nsubs, mxCalloc(nsubs, sizeof(mwIndex)) };
-
-        copyArray (g, prhs[0], L);
 
-        prombsExt(result, ak, g, prombs_f, prombs_h, L, m, &data);
+        copyArray(g, prhs[0], L);
 
-        free_prombs_matrix(ak, L);
+        /* f and h are read directly from the column-major buffers */
+        prombsExt_dense(result, g, mxGetPr(prhs[1]), mxGetPr(prhs[2]), L, L, m);
 
         return copyArrayToMatlab(result, L);
 }
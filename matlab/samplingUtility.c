@@ -29,25 +29,25 @@ utility_t * callUtility(const mxArray *prhs[]) {
 
         size_t K = mxGetDimensions(prhs[0])[0];
         size_t L = mxGetDimensions(prhs[0])[1];
-        matrix_t** counts;
-        matrix_t** alpha;
+        matrix_view_t** counts;
+        matrix_view_t** alpha;
         vector_t* beta;
-        matrix_t* gamma;
+        matrix_view_t* gamma;
         options_t* options;
         utility_t * result;
 
-        counts  = getCounts(prhs[0], K, L);
-        alpha   = getAlpha(prhs[1], K, L);
+        counts  = getCountsView(prhs[0], K, L);
+        alpha   = getAlphaView(prhs[1], K, L);
         beta    = getBeta(prhs[2], L);
-        gamma   = getGamma(prhs[3], L);
+        gamma   = getGammaView(prhs[3], L);
         options = getOptions(prhs[4]);
 
-        result  = utility(K, counts, alpha, beta, gamma, options);
+        result  = utilityView(K, counts, alpha, beta, gamma, options);
 
-        freeCounts(counts);
-        freeAlpha(alpha);
+        free3DView(counts);
+        free3DView(alpha);
         free_vector(beta);
-        free_matrix(gamma);
+        free_matrix_view(gamma);
         free(options);
 
         return result;
@@ -56,12 +56,13 @@ utility_t * callUtility(const mxArray *prhs[]) {
 static
 void copyResult(utility_t* result, mxArray *plhs[]) {
         const char **fnames;
-        const int nfields = 2;
+        const int nfields = 3;
 
         /* allocate memory  for storing pointers */
         fnames = mxCalloc(nfields, sizeof(*fnames));
         fnames[0] = "expectation";
         fnames[1] = "utility";
+        fnames[2] = "stats";
 
         plhs[0] = mxCreateStructMatrix(1, 1, nfields, fnames);
         mxFree((void *)fnames);
@@ -72,6 +73,9 @@ void copyResult(utility_t* result, mxArray *plhs[]) {
         if (result->utility) {
                 mxSetField(plhs[0], 0, "utility", copyVectorToMatlab(result->utility));
         }
+        if (result->stats) {
+                mxSetField(plhs[0], 0, "stats", copyStatsToMatlab(result->stats));
+        }
 }
 
 static
@@ -82,6 +86,7 @@ void freeResult(utility_t * result) {
         if (result->utility) {
                 free_vector(result->utility);
         }
+        free(result->stats);
         free(result);
 }
 
@@ -0,0 +1,81 @@
+/* Copyright (C) 2012 Philipp Benner
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <adaptive-sampling/linalg.h>
+
+#include <batch.h>
+
+/******************************************************************************
+ * Batch selection
+ ******************************************************************************/
+
+/* Greedy diversity-penalized selection of a batch of positions. The
+ * utility of each candidate x is rescaled to [0,1] and discounted by
+ * the probability that x falls into the same bin as one of the
+ * positions s that were already selected, i.e.
+ *
+ *   score(x) = u(x) prod_s (1 - P(x and s are in the same bin|D)),
+ *
+ * so that a batch spreads over regions with distinct parameters. Ties
+ * are broken by the undiscounted utility. */
+void computeBatch(
+        vector_t *selection,
+        vector_t *utility,
+        matrix_t *samebin)
+{
+        size_t L = utility->size;
+        double score[L];
+        double min = HUGE_VAL, max = -HUGE_VAL;
+        int selected[L];
+        double tmp;
+        size_t i, k, best;
+
+        for (i = 0; i < L; i++) {
+                if (utility->content[i] < min) min = utility->content[i];
+                if (utility->content[i] > max) max = utility->content[i];
+        }
+        for (i = 0; i < L; i++) {
+                score[i]    = max > min ? (utility->content[i] - min)/(max - min) : 1.0;
+                selected[i] = 0;
+        }
+        for (k = 0; k < selection->size; k++) {
+                best = L;
+                for (i = 0; i < L; i++) {
+                        if (selected[i]) {
+                                continue;
+                        }
+                        if (best == L || score[i] > score[best] ||
+                           (score[i] == score[best] && utility->content[i] > utility->content[best])) {
+                                best = i;
+                        }
+                }
+                selected[best]        = 1;
+                selection->content[k] = best;
+                for (i = 0; i < L; i++) {
+                        tmp       = 1.0 - samebin->content[i][best];
+                        score[i] *= tmp > 0.0 ? tmp : 0.0;
+                }
+        }
+}
@@ -0,0 +1,842 @@
+/* Copyright (C) 2012 Philipp Benner
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include <adaptive-sampling/exception.h>
+#include <adaptive-sampling/interface.h>
+#include <adaptive-sampling/linalg.h>
+#include <adaptive-sampling/probtype.h>
+#include <adaptive-sampling/prombs.h>
+
+/******************************************************************************
+ * Benchmark cases
+ ******************************************************************************/
+
+#define BENCH_POSTERIOR  0
+#define BENCH_UTILITY    1
+#define BENCH_PROMBS     2
+#define BENCH_PROMBS_EXT 3
+
+typedef struct {
+        const char *engine;
+        const char *variant;
+        int kind;
+        /* prombs and prombsExt are not threaded */
+        int threaded;
+        void (*setup)(options_t *options);
+} bench_case_t;
+
+static void setup_evidence(options_t *options) { }
+static void setup_bprob   (options_t *options) { options->bprob = 1; }
+static void setup_moments (options_t *options) { options->n_moments = 2; }
+static void setup_density (options_t *options) { options->density = 1; }
+static void setup_kl_psi  (options_t *options) { options->kl_psi = 1; }
+static void setup_kl_multibin(options_t *options) { options->kl_multibin = 1; }
+static void setup_effective_counts(options_t *options) { options->effective_counts = 1; }
+static void setup_effective_posterior_counts(options_t *options) { options->effective_posterior_counts = 1; }
+static void setup_prune(options_t *options) {
+        options->kl_psi = 1;
+        options->prune  = 1;
+}
+static void setup_hmm_posterior(options_t *options) {
+        options->hmm       = 1;
+        options->bprob     = 1;
+        options->n_moments = 2;
+}
+static void setup_hmm_utility(options_t *options) {
+        options->hmm    = 1;
+        options->kl_psi = 1;
+}
+static void setup_mgs_posterior(options_t *options) {
+        options->algorithm = 1;
+        options->bprob     = 1;
+        options->n_moments = 2;
+}
+
+static
+bench_case_t bench_cases[] = {
+        { "posterior", "evidence",  BENCH_POSTERIOR, 1, &setup_evidence },
+        { "posterior", "bprob",     BENCH_POSTERIOR, 1, &setup_bprob    },
+        { "posterior", "moments",   BENCH_POSTERIOR, 1, &setup_moments  },
+        { "posterior", "density",   BENCH_POSTERIOR, 1, &setup_density  },
+        { "utility",   "kl_psi",    BENCH_UTILITY,   1, &setup_kl_psi   },
+        { "utility",   "kl_multibin", BENCH_UTILITY, 1, &setup_kl_multibin },
+        { "utility",   "effective_counts", BENCH_UTILITY, 1, &setup_effective_counts },
+        { "utility",   "effective_posterior_counts", BENCH_UTILITY, 1, &setup_effective_posterior_counts },
+        { "utility",   "prune",     BENCH_UTILITY,   1, &setup_prune    },
+        { "hmm",       "posterior", BENCH_POSTERIOR, 1, &setup_hmm_posterior },
+        { "hmm",       "utility",   BENCH_UTILITY,   1, &setup_hmm_utility   },
+        { "mgs",       "posterior", BENCH_POSTERIOR, 1, &setup_mgs_posterior },
+        { "prombs",    "prombs",    BENCH_PROMBS,    0, NULL },
+        { "prombs",    "prombsExt", BENCH_PROMBS_EXT, 0, NULL }
+};
+
+#define BENCH_CASES (sizeof(bench_cases)/sizeof(bench_case_t))
+
+static const char *workloads[] = { "step", "smooth", "spike" };
+
+#define BENCH_WORKLOADS 3
+
+static const char *phases[STATS_PHASES] = {
+        "evidence", "coverage", "moments", "density", "bprob", "utility"
+};
+
+/******************************************************************************
+ * Options
+ ******************************************************************************/
+
+#define BENCH_MAX_LIST 32
+
+typedef struct {
+        size_t n;
+        long   value[BENCH_MAX_LIST];
+} bench_list_t;
+
+static struct {
+        bench_list_t sizes;
+        bench_list_t events;
+        bench_list_t threads;
+        int workload[BENCH_WORKLOADS];
+        int engine[BENCH_CASES];
+        int repeat;
+        int bins;
+        int trials;
+        double budget;
+        double memory;
+        unsigned long seed;
+        int csv;
+        FILE *output;
+} bench;
+
+static
+void parseList(bench_list_t *list, const char *arg, long min, const char *name)
+{
+        char *end;
+
+        for (list->n = 0; *arg; list->n++) {
+                if (list->n == BENCH_MAX_LIST) {
+                        std_err(NONE, "Too many values for `%s'.", name);
+                }
+                list->value[list->n] = strtol(arg, &end, 10);
+                if (end == arg || (*end != ',' && *end != '\0') || list->value[list->n] < min) {
+                        std_err(NONE, "Invalid value for `%s': %s", name, arg);
+                }
+                arg = *end == ',' ? end+1 : end;
+        }
+        if (list->n == 0) {
+                std_err(NONE, "Empty list for `%s'.", name);
+        }
+}
+
+/* select names from a comma separated list, engines are matched by
+ * the engine name or by `engine/variant' */
+static
+void parseNames(int *selected, const char *arg, const char *name, int engines)
+{
+        char buf[strlen(arg)+1], *token, *save;
+        char full[256];
+        size_t i, n = engines ? BENCH_CASES : BENCH_WORKLOADS;
+        int found;
+
+        strcpy(buf, arg);
+        for (i = 0; i < n; i++) {
+                selected[i] = 0;
+        }
+        for (token = strtok_r(buf, ",", &save); token; token = strtok_r(NULL, ",", &save)) {
+                found = 0;
+                for (i = 0; i < n; i++) {
+                        if (engines) {
+                                snprintf(full, sizeof(full), "%s/%s",
+                                         bench_cases[i].engine, bench_cases[i].variant);
+                                if (strcmp(token, bench_cases[i].engine) == 0 ||
+                                    strcmp(token, full) == 0) {
+                                        selected[i] = found = 1;
+                                }
+                        }
+                        else if (strcmp(token, workloads[i]) == 0) {
+                                selected[i] = found = 1;
+                        }
+                }
+                if (!found) {
+                        std_err(NONE, "Unknown value for `%s': %s", name, token);
+                }
+        }
+}
+
+static
+void printUsage(const char *pname, FILE *fp)
+{
+        size_t i;
+
+        fprintf(fp,
+                "\nUsage: %s [OPTION]...\n\n"
+                "Time the library on synthetic count data and write the results\n"
+                "as JSON (default) or CSV.\n\n"
+                "Options:\n"
+                "      --sizes=LIST     - number of positions L [default: 50,200,1000]\n"
+                "      --events=LIST    - number of events K [default: 2,3,4]\n"
+                "      --threads=LIST   - number of threads [default: 1,<cores>]\n"
+                "      --workloads=LIST - step, smooth, spike [default: all]\n"
+                "      --engines=LIST   - engines or engine/variant [default: all]\n"
+                "      --repeat=N       - timed runs of each case [default: 3]\n"
+                "      --bins=M         - maximal number of bins [default: 50]\n"
+                "      --trials=N       - trials at each position [default: 10]\n"
+                "      --budget=SEC     - skip larger sizes of a case if the\n"
+                "                         predicted time exceeds SEC [default: 60]\n"
+                "      --memory=MB      - skip sizes that need more memory [default: 2048]\n"
+                "      --seed=N         - seed of the synthetic data [default: 1]\n"
+                "      --csv            - write CSV instead of JSON\n"
+                "      --output=FILE    - write to FILE instead of stdout\n"
+                "      --help           - print help and exit\n\n"
+                "Engines:\n",
+                pname);
+        for (i = 0; i < BENCH_CASES; i++) {
+                fprintf(fp, "      %s/%s\n", bench_cases[i].engine, bench_cases[i].variant);
+        }
+        fprintf(fp, "\n");
+}
+
+static
+void parseOptions(int argc, char *argv[])
+{
+        static struct option long_options[] = {
+                { "sizes",     1, 0, 's' },
+                { "events",    1, 0, 'k' },
+                { "threads",   1, 0, 't' },
+                { "workloads", 1, 0, 'w' },
+                { "engines",   1, 0, 'e' },
+                { "repeat",    1, 0, 'r' },
+                { "bins",      1, 0, 'm' },
+                { "trials",    1, 0, 'n' },
+                { "budget",    1, 0, 'b' },
+                { "memory",    1, 0, 'M' },
+                { "seed",      1, 0, 'S' },
+                { "csv",       0, 0, 'c' },
+                { "output",    1, 0, 'o' },
+                { "help",      0, 0, 'h' },
+                { 0, 0, 0, 0 }
+        };
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        size_t i;
+        int c;
+
+        parseList(&bench.sizes,  "50,200,1000", 2, "sizes");
+        parseList(&bench.events, "2,3,4", 2, "events");
+        bench.threads.n        = cores > 1 ? 2 : 1;
+        bench.threads.value[0] = 1;
+        bench.threads.value[1] = cores;
+        for (i = 0; i < BENCH_WORKLOADS; i++) {
+                bench.workload[i] = 1;
+        }
+        for (i = 0; i < BENCH_CASES; i++) {
+                bench.engine[i] = 1;
+        }
+        bench.repeat = 3;
+        bench.bins   = 50;
+        bench.trials = 10;
+        bench.budget = 60.0;
+        bench.memory = 2048.0;
+        bench.seed   = 1;
+        bench.csv    = 0;
+        bench.output = stdout;
+
+        while ((c = getopt_long(argc, argv, "", long_options, NULL)) != -1) {
+                switch (c) {
+                case 's': parseList(&bench.sizes,   optarg, 2, "sizes");   break;
+                case 'k': parseList(&bench.events,  optarg, 2, "events");  break;
+                case 't': parseList(&bench.threads, optarg, 1, "threads"); break;
+                case 'w': parseNames(bench.workload, optarg, "workloads", 0); break;
+                case 'e': parseNames(bench.engine,   optarg, "engines",   1); break;
+                case 'r': bench.repeat = atoi(optarg);   break;
+                case 'm': bench.bins   = atoi(optarg);   break;
+                case 'n': bench.trials = atoi(optarg);   break;
+                case 'b': bench.budget = atof(optarg);   break;
+                case 'M': bench.memory = atof(optarg);   break;
+                case 'S': bench.seed   = strtoul(optarg, NULL, 10); break;
+                case 'c': bench.csv    = 1; break;
+                case 'o':
+                        if ((bench.output = fopen(optarg, "w")) == NULL) {
+                                std_err(NONE, "Couldn't open `%s' for writing.", optarg);
+                        }
+                        break;
+                case 'h':
+                        printUsage(argv[0], stdout);
+                        exit(EXIT_SUCCESS);
+                default:
+                        printUsage(argv[0], stderr);
+                        exit(EXIT_FAILURE);
+                }
+        }
+        if (optind < argc || bench.repeat < 1 || bench.bins < 1 || bench.trials < 1) {
+                printUsage(argv[0], stderr);
+                exit(EXIT_FAILURE);
+        }
+}
+
+/******************************************************************************
+ * Synthetic data
+ ******************************************************************************/
+
+/* The data is generated by a small linear congruential generator
+ * such that it is identical on all platforms and builds. */
+static unsigned long long rng_state;
+
+static
+double rng_uniform(void)
+{
+        rng_state = rng_state*6364136223846793005ULL + 1442695040888963407ULL;
+
+        return (rng_state >> 11)*(1.0/9007199254740992.0);
+}
+
+/* probability of event k at position x for a workload with K
+ * events, the first event follows the workload and the remaining
+ * probability is shared equally by the other events */
+static
+double rate(int workload, size_t x, size_t L, size_t k, size_t K)
+{
+        double p;
+
+        switch (workload) {
+        default:
+        case 0:
+                /* step function with five segments */
+                p = 0.15 + 0.7*((5*x/L) % 2);
+                break;
+        case 1:
+                /* smooth rate */
+                p = 0.5 + 0.4*sin(2.0*M_PI*x/L);
+                break;
+        case 2:
+                /* spike train, short bursts on a low baseline */
+                p = x % 25 < 2 ? 0.9 : 0.05;
+                break;
+        }
+        return k == 0 ? p : (1.0-p)/(K-1);
+}
+
+typedef struct {
+        size_t L;
+        size_t K;
+        matrix_t **counts;
+        matrix_t **alpha;
+        vector_t  *beta;
+        matrix_t  *gamma;
+        /* prefix sums of the first event and of all events for the
+         * interval function of the prombs benchmark */
+        double *successes;
+        double *total;
+} bench_data_t;
+
+static
+void allocData(bench_data_t *data, int workload, size_t L, size_t K)
+{
+        double events[K*L];
+        matrix_view_t *view;
+        double u, c;
+        size_t i, j, k, n;
+
+        rng_state = bench.seed*(workload+1)*(2*L+1)*(2*K+1);
+        for (i = 0; i < K*L; i++) {
+                events[i] = 0.0;
+        }
+        for (i = 0; i < L; i++) {
+                for (n = 0; n < (size_t)bench.trials; n++) {
+                        u = rng_uniform();
+                        c = 0.0;
+                        for (k = 0; k < K-1; k++) {
+                                c += rate(workload, i, L, k, K);
+                                if (u < c) {
+                                        break;
+                                }
+                        }
+                        events[k*L+i]++;
+                }
+        }
+        view = alloc_matrix_view(events, K, L, L, 0);
+        data->L      = L;
+        data->K      = K;
+        data->counts = countsFromEvents(view);
+        free_matrix_view(view);
+
+        /* default parameters: uniform pseudo counts, uniform prior
+         * on the number of bins up to the limit, and uniform prior
+         * on the bins of each model */
+        data->alpha = (matrix_t **)malloc(K*sizeof(matrix_t *));
+        for (k = 0; k < K; k++) {
+                data->alpha[k] = alloc_matrix(L, L);
+                for (i = 0; i < L; i++) {
+                        for (j = 0; j < L; j++) {
+                                data->alpha[k]->content[i][j] = j < i ? 0.0 : 1.0;
+                        }
+                }
+        }
+        data->beta = alloc_vector(L);
+        for (i = 0; i < L; i++) {
+                data->beta->content[i] = i < (size_t)bench.bins ? -log(bench.bins) : -HUGE_VAL;
+        }
+        data->gamma = alloc_matrix(L, L);
+        for (i = 0; i < L; i++) {
+                for (j = 0; j < L; j++) {
+                        data->gamma->content[i][j] = j < i ? 0.0 : 1.0;
+                }
+        }
+        data->successes = (double *)malloc((L+1)*sizeof(double));
+        data->total     = (double *)malloc((L+1)*sizeof(double));
+        data->successes[0] = 0.0;
+        data->total    [0] = 0.0;
+        for (i = 0; i < L; i++) {
+                data->successes[i+1] = data->successes[i] + events[i];
+                data->total    [i+1] = data->total[i];
+                for (k = 0; k < K; k++) {
+                        data->total[i+1] += events[k*L+i];
+                }
+        }
+}
+
+static
+void freeData(bench_data_t *data)
+{
+        size_t k;
+
+        for (k = 0; k < data->K; k++) {
+                free_matrix(data->counts[k]);
+                free_matrix(data->alpha[k]);
+        }
+        free(data->counts);
+        free(data->alpha);
+        free_vector(data->beta);
+        free_matrix(data->gamma);
+        free(data->successes);
+        free(data->total);
+}
+
+/* memory of the data and of the largest temporary matrices of a
+ * computation with the given number of threads in bytes */
+static
+double requiredMemory(size_t L, size_t K, size_t threads)
+{
+        return (double)L*L*((2*K+2)*sizeof(double) + threads*sizeof(prob_t));
+}
+
+/******************************************************************************
+ * Timing
+ ******************************************************************************/
+
+static
+double clockTime(clockid_t clock)
+{
+        struct timespec ts;
+
+        clock_gettime(clock, &ts);
+
+        return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+typedef struct {
+        int status;
+        double wall_min;
+        double wall_median;
+        double cpu;
+        /* stats of the fastest run, if available */
+        int has_stats;
+        stats_t stats;
+} bench_result_t;
+
+#define BENCH_OK             0
+#define BENCH_SKIPPED_MEMORY 1
+#define BENCH_SKIPPED_BUDGET 2
+
+static const char *status_names[] = { "ok", "skipped-memory", "skipped-budget" };
+
+/* interval function of the prombs benchmark, the marginal likelihood
+ * of a binomial model with uniform prior */
+static
+prob_t bench_f(int i, int j, void *data_)
+{
+        bench_data_t *data = (bench_data_t *)data_;
+        double s = data->successes[j+1] - data->successes[i];
+        double n = data->total    [j+1] - data->total    [i];
+
+        return lgamma(s+1.0) + lgamma(n-s+1.0) - lgamma(n+2.0);
+}
+
+static
+prob_t bench_h(int i, int j, void *data)
+{
+        return -bench_f(i, j, data);
+}
+
+static
+void freeMarginal(marginal_t *result)
+{
+        int k;
+
+        if (result == NULL) {
+                return;
+        }
+        if (result->moments)        free_matrix(result->moments);
+        if (result->density)        free_matrix(result->density);
+        if (result->bprob)          free_vector(result->bprob);
+        if (result->mpost)          free_vector(result->mpost);
+        if (result->coverage)       free_matrix(result->coverage);
+        if (result->density_points) free_matrix(result->density_points);
+        if (result->quantiles)      free_matrix(result->quantiles);
+        if (result->hdi)            free_matrix(result->hdi);
+        if (result->event) {
+                for (k = 0; k < result->events; k++) {
+                        freeMarginal(result->event[k]);
+                }
+                free(result->event);
+        }
+        free(result->stats);
+        free(result);
+}
+
+static
+void freeUtility(utility_t *result)
+{
+        if (result->expectation) free_matrix(result->expectation);
+        if (result->utility)     free_vector(result->utility);
+        if (result->complete)    free_vector(result->complete);
+        free(result->stats);
+        free(result);
+}
+
+/* run a case once and return its wall-clock time, stats are copied
+ * if the engine returns them */
+static
+double runCase(
+        bench_case_t *bc,
+        bench_data_t *data,
+        options_t *options,
+        double *cpu,
+        stats_t *stats,
+        int *has_stats)
+{
+        marginal_t *marginal;
+        utility_t  *utility_result;
+        prob_t **ak, g[data->L], result[data->L];
+        double wall;
+        size_t i, m;
+
+        *has_stats = 0;
+        wall = clockTime(CLOCK_MONOTONIC);
+        *cpu = clockTime(CLOCK_PROCESS_CPUTIME_ID);
+
+        switch (bc->kind) {
+        case BENCH_POSTERIOR:
+                marginal = posterior(data->K, data->counts, data->alpha,
+                                     data->beta, data->gamma, options);
+                wall = clockTime(CLOCK_MONOTONIC) - wall;
+                *cpu = clockTime(CLOCK_PROCESS_CPUTIME_ID) - *cpu;
+                if (marginal->stats) {
+                        *stats = *marginal->stats;
+                        *has_stats = 1;
+                }
+                freeMarginal(marginal);
+                break;
+        case BENCH_UTILITY:
+                utility_result = utility(data->K, data->counts, data->alpha,
+                                         data->beta, data->gamma, options);
+                wall = clockTime(CLOCK_MONOTONIC) - wall;
+                *cpu = clockTime(CLOCK_PROCESS_CPUTIME_ID) - *cpu;
+                if (utility_result->stats) {
+                        *stats = *utility_result->stats;
+                        *has_stats = 1;
+                }
+                freeUtility(utility_result);
+                break;
+        default:
+                m  = (size_t)bench.bins < data->L ? (size_t)bench.bins : data->L;
+                ak = (prob_t **)malloc(data->L*sizeof(prob_t *));
+                for (i = 0; i < data->L; i++) {
+                        ak[i] = (prob_t *)malloc(data->L*sizeof(prob_t));
+                        g [i] = data->beta->content[i];
+                }
+                if (bc->kind == BENCH_PROMBS) {
+                        prombs(result, ak, g, &bench_f, data->L, m-1, (void *)data);
+                }
+                else {
+                        prombsExt(result, ak, g, &bench_f, &bench_h, data->L, m-1, (void *)data);
+                }
+                wall = clockTime(CLOCK_MONOTONIC) - wall;
+                *cpu = clockTime(CLOCK_PROCESS_CPUTIME_ID) - *cpu;
+                for (i = 0; i < data->L; i++) {
+                        free(ak[i]);
+                }
+                free(ak);
+                break;
+        }
+        return wall;
+}
+
+static
+int compareDouble(const void *a, const void *b)
+{
+        double x = *(const double *)a;
+        double y = *(const double *)b;
+
+        return (x > y) - (x < y);
+}
+
+static
+void timeCase(
+        bench_result_t *br,
+        bench_case_t *bc,
+        bench_data_t *data,
+        size_t threads)
+{
+        options_t options;
+        double wall[bench.repeat], cpu;
+        stats_t stats;
+        int r, has_stats;
+
+        memset(&options, 0, sizeof(options_t));
+        options.epsilon      = 0.00001;
+        options.threads      = threads;
+        options.stacksize    = 256*1024;
+        options.density_step = 0.01;
+        options.n_density    = 101;
+        options.density_range.from = 0.0;
+        options.density_range.to   = 1.0;
+        options.rho          = 0.4;
+        options.samples[0]   = 100;
+        options.samples[1]   = 1000;
+        options.stats        = 1;
+        if (bc->setup) {
+                bc->setup(&options);
+        }
+        br->status    = BENCH_OK;
+        br->has_stats = 0;
+        for (r = 0; r < bench.repeat; r++) {
+                wall[r] = runCase(bc, data, &options, &cpu, &stats, &has_stats);
+                if (r == 0 || wall[r] < br->wall_min) {
+                        br->wall_min  = wall[r];
+                        br->cpu       = cpu;
+                        br->stats     = stats;
+                        br->has_stats = has_stats;
+                }
+        }
+        qsort(wall, bench.repeat, sizeof(double), &compareDouble);
+        br->wall_median = bench.repeat % 2 ? wall[bench.repeat/2]
+                : 0.5*(wall[bench.repeat/2-1] + wall[bench.repeat/2]);
+}
+
+/******************************************************************************
+ * Output
+ ******************************************************************************/
+
+static const char *precision_name =
+        sizeof(prob_t) == sizeof(double) ? "double" : "long double";
+
+static size_t rows;
+
+static
+void writeHeader(void)
+{
+        size_t i;
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+
+        if (bench.csv) {
+                fprintf(bench.output, "precision,engine,variant,workload,L,K,threads,status,"
+                        "wall_min,wall_median,cpu");
+                for (i = 0; i < STATS_PHASES; i++) {
+                        fprintf(bench.output, ",wall_%s", phases[i]);
+                }
+                fprintf(bench.output, ",prombs_calls,evaluations,lngamma_calls,"
+                        "thread_utilization,peak_scratch\n");
+        }
+        else {
+                fprintf(bench.output, "{\n");
+#ifdef PACKAGE_VERSION
+                fprintf(bench.output, "  \"version\": \"%s\",\n", PACKAGE_VERSION);
+#endif
+                fprintf(bench.output, "  \"precision\": \"%s\",\n", precision_name);
+                fprintf(bench.output, "  \"prob_size\": %lu,\n", (unsigned long)sizeof(prob_t));
+                fprintf(bench.output, "  \"cores\": %ld,\n", cores);
+                fprintf(bench.output, "  \"bins\": %d,\n", bench.bins);
+                fprintf(bench.output, "  \"trials\": %d,\n", bench.trials);
+                fprintf(bench.output, "  \"repeat\": %d,\n", bench.repeat);
+                fprintf(bench.output, "  \"seed\": %lu,\n", bench.seed);
+                fprintf(bench.output, "  \"results\": [");
+        }
+}
+
+static
+void writeRow(
+        bench_result_t *br,
+        bench_case_t *bc,
+        int workload,
+        size_t L,
+        size_t K,
+        size_t threads)
+{
+        FILE *fp = bench.output;
+        int ok = br->status == BENCH_OK;
+        int st = ok && br->has_stats;
+        size_t i;
+
+        if (bench.csv) {
+                fprintf(fp, "%s,%s,%s,%s,%lu,%lu,%lu,%s", precision_name,
+                        bc->engine, bc->variant, workloads[workload],
+                        (unsigned long)L, (unsigned long)K, (unsigned long)threads,
+                        status_names[br->status]);
+                if (ok) {
+                        fprintf(fp, ",%.6e,%.6e,%.6e", br->wall_min, br->wall_median, br->cpu);
+                }
+                else {
+                        fprintf(fp, ",,,");
+                }
+                for (i = 0; i < STATS_PHASES; i++) {
+                        if (st) fprintf(fp, ",%.6e", br->stats.wall[i]);
+                        else    fprintf(fp, ",");
+                }
+                if (st) {
+                        fprintf(fp, ",%.0f,%.0f,%.0f,%.4f,%.0f\n",
+                                br->stats.prombs_calls, br->stats.evaluations,
+                                br->stats.lngamma_calls, br->stats.thread_utilization,
+                                br->stats.peak_scratch);
+                }
+                else {
+                        fprintf(fp, ",,,,,\n");
+                }
+        }
+        else {
+                fprintf(fp, "%s\n    { \"engine\": \"%s\", \"variant\": \"%s\", \"workload\": \"%s\", "
+                        "\"L\": %lu, \"K\": %lu, \"threads\": %lu, \"status\": \"%s\"",
+                        rows ? "," : "", bc->engine, bc->variant, workloads[workload],
+                        (unsigned long)L, (unsigned long)K, (unsigned long)threads,
+                        status_names[br->status]);
+                if (ok) {
+                        fprintf(fp, ",\n      \"wall_min\": %.6e, \"wall_median\": %.6e, \"cpu\": %.6e",
+                                br->wall_min, br->wall_median, br->cpu);
+                }
+                if (st) {
+                        fprintf(fp, ",\n      \"phases\": {");
+                        for (i = 0; i < STATS_PHASES; i++) {
+                                fprintf(fp, "%s\"%s\": %.6e", i ? ", " : " ", phases[i], br->stats.wall[i]);
+                        }
+                        fprintf(fp, " },\n      \"prombs_calls\": %.0f, \"evaluations\": %.0f, "
+                                "\"lngamma_calls\": %.0f, \"thread_utilization\": %.4f, "
+                                "\"peak_scratch\": %.0f",
+                                br->stats.prombs_calls, br->stats.evaluations,
+                                br->stats.lngamma_calls, br->stats.thread_utilization,
+                                br->stats.peak_scratch);
+                }
+                fprintf(fp, " }");
+        }
+        fflush(fp);
+        rows++;
+}
+
+static
+void writeFooter(void)
+{
+        if (!bench.csv) {
+                fprintf(bench.output, "\n  ]\n}\n");
+        }
+}
+
+/******************************************************************************
+ * Main
+ ******************************************************************************/
+
+int main(int argc, char *argv[])
+{
+        bench_data_t data;
+        bench_result_t br;
+        size_t w, k, l, t, c, L, K, threads;
+        /* wall-clock time of the previous size of each case and
+         * thread count, negative if larger sizes are skipped */
+        double last_wall[BENCH_MAX_LIST][BENCH_CASES];
+        size_t last_L[BENCH_MAX_LIST][BENCH_CASES];
+        int skip;
+
+        memset(&br, 0, sizeof(bench_result_t));
+        parseOptions(argc, argv);
+        __init__(0.00001);
+        writeHeader();
+
+        for (w = 0; w < BENCH_WORKLOADS; w++) {
+                if (!bench.workload[w]) {
+                        continue;
+                }
+                for (k = 0; k < bench.events.n; k++) {
+                        K = bench.events.value[k];
+                        memset(last_L, 0, sizeof(last_L));
+                        for (l = 0; l < bench.sizes.n; l++) {
+                                L = bench.sizes.value[l];
+                                /* the data alone may exceed the limit */
+                                skip = requiredMemory(L, K, 1) > bench.memory*1024*1024;
+                                if (!skip) {
+                                        allocData(&data, w, L, K);
+                                }
+                                for (t = 0; t < bench.threads.n; t++) {
+                                        threads = bench.threads.value[t];
+                                        for (c = 0; c < BENCH_CASES; c++) {
+                                                if (!bench.engine[c] || (!bench_cases[c].threaded && t > 0)) {
+                                                        continue;
+                                                }
+                                                if (!bench_cases[c].threaded) {
+                                                        threads = 1;
+                                                }
+                                                if (skip || requiredMemory(L, K, threads) > bench.memory*1024*1024) {
+                                                        br.status = BENCH_SKIPPED_MEMORY;
+                                                }
+                                                /* predict the time from the previous size
+                                                 * assuming cubic growth */
+                                                else if (last_L[t][c] > 0 &&
+                                                         (last_wall[t][c] < 0.0 ||
+                                                          last_wall[t][c]*pow((double)L/last_L[t][c], 3) > bench.budget)) {
+                                                        br.status = BENCH_SKIPPED_BUDGET;
+                                                        last_wall[t][c] = -1.0;
+                                                }
+                                                else {
+                                                        timeCase(&br, &bench_cases[c], &data, threads);
+                                                        last_wall[t][c] = br.wall_min;
+                                                        last_L   [t][c] = L;
+                                                }
+                                                writeRow(&br, &bench_cases[c], w, L, K, threads);
+                                                threads = bench.threads.value[t];
+                                        }
+                                }
+                                if (!skip) {
+                                        freeData(&data);
+                                }
+                        }
+                }
+        }
+        writeFooter();
+        __free__();
+
+        if (bench.output != stdout) {
+                fclose(bench.output);
+        }
+        return EXIT_SUCCESS;
+}
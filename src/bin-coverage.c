@@ -0,0 +1,274 @@
+/* Copyright (C) 2012 Philipp Benner
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <gsl/gsl_sf_gamma.h>
+
+#include <adaptive-sampling/exception.h>
+#include <adaptive-sampling/logarithmetic.h>
+#include <adaptive-sampling/mgs.h>
+#include <adaptive-sampling/prombs.h>
+#include <adaptive-sampling/datatypes.h>
+
+#include <bin-coverage.h>
+#include <datatypes.h>
+#include <model.h>
+#include <tools.h>
+
+/******************************************************************************
+ * Bin coverage P([i,j] is a bin|D)
+ ******************************************************************************/
+
+/* The posterior of all multibins is summarized by the probability
+ * that an interval [i,j] is a bin, which is computed from a single
+ * forward and backward sweep. */
+void computeBinCoverage(
+        matrix_t *coverage,
+        prob_t evidence_ref,
+        binData *bd)
+{
+        binProblem bp;
+        prob_t **result;
+        double scratch;
+        size_t i, j;
+
+        if (bd->options->algorithm == 1) {
+                mgs_get_coverage(coverage, bd->L);
+                return;
+        }
+        binProblemInit(&bp, bd);
+        result = alloc_prombs_matrix(bd->L);
+        /* result and the forward and backward sums */
+        scratch = bd->L*(bd->L + 2*(minM(&bp)+1))*sizeof(prob_t);
+        statsScratch(bd, scratch);
+        prombs_coverage(result, bp.ak, bd->prior_log, &execPrombs_f, bd->L, minM(&bp), (void *)&bp);
+        bp.counter.prombs_calls++;
+
+        for (i = 0; i < bd->L; i++) {
+                for (j = 0; j < bd->L; j++) {
+                        if (j < i) {
+                                coverage->content[i][j] = 0.0;
+                        }
+                        else {
+                                coverage->content[i][j] = EXP(result[i][j] - evidence_ref);
+                        }
+                }
+        }
+        free_prombs_matrix(result, bd->L);
+        statsScratch(bd, -scratch);
+        binProblemFree(&bp);
+}
+
+/* Same as above for the hidden Markov model, where [i,j] is a
+ * segment if there is a transition before i and after j. */
+void hmm_computeBinCoverage(
+        matrix_t *coverage,
+        prob_t *forward,
+        prob_t *backward,
+        binProblem *bp)
+{
+        prob_t rho = bp->bd->options->rho;
+        prob_t tmp;
+        size_t i, j, L = bp->bd->L;
+
+        for (i = 0; i < L; i++) {
+                for (j = 0; j < L; j++) {
+                        if (j < i) {
+                                coverage->content[i][j] = 0.0;
+                                continue;
+                        }
+                        tmp = (j-i)*LOG(rho) + hmm_hp(i, j, bp) - forward[L-1];
+                        if (i > 0) {
+                                tmp += LOG(1.0-rho) + forward[i-1];
+                        }
+                        if (j < L-1) {
+                                tmp += LOG(1.0-rho) + backward[j+1];
+                        }
+                        coverage->content[i][j] = EXP(tmp);
+                }
+        }
+}
+
+/* Parameters of the Beta distribution of the success probability of
+ * event `which' within bin [i,j], which is the marginal of the
+ * Dirichlet posterior. The hmm uses the pseudo counts of the first
+ * position. */
+void binParameters(
+        prob_t *a,
+        prob_t *b,
+        size_t i,
+        size_t j,
+        binProblem *bp)
+{
+        size_t k, which = bp->bd->options->which;
+        prob_t c;
+
+        *a = 0.0;
+        *b = 0.0;
+        for (k = 0; k < bp->bd->events; k++) {
+                c  = bp->bd->options->hmm ? countAlpha(k, i, i, bp) : countAlpha(k, i, j, bp);
+                c += countStatistic(k, i, j, bp);
+                if (k == which) {
+                        *a += c;
+                }
+                else {
+                        *b += c;
+                }
+        }
+}
+
+/* The first n moments of the success probability of event `which' at
+ * position x are mixtures over all bins [i,j] that cover x,
+ *
+ *   E[p^n] = sum_{[i,j] covers x} P([i,j]|D) prod_{m=0}^{n-1} (a+m)/(a+b+m),
+ *
+ * where a and b are the parameters of the bin. For each start
+ * i the mixture is computed from a running sum over the end of the
+ * interval. */
+void computeCoverageMoments(
+        matrix_t *moments,
+        matrix_t *coverage,
+        binProblem *bp)
+{
+        size_t L = bp->bd->L, N = moments->rows;
+        size_t i, x, n;
+        prob_t a, b, P, p, s[N];
+
+        for (n = 0; n < N; n++) {
+                for (x = 0; x < L; x++) {
+                        moments->content[n][x] = 0.0;
+                }
+        }
+        for (i = 0; i < L; i++) {
+                for (n = 0; n < N; n++) {
+                        s[n] = 0.0;
+                }
+                for (x = L; x-- > i;) {
+                        P = coverage->content[i][x];
+                        if (P > 0.0) {
+                                binParameters(&a, &b, i, x, bp);
+                                p = P;
+                                for (n = 0; n < N; n++) {
+                                        p    *= (a+n)/(a+b+n);
+                                        s[n] += p;
+                                }
+                        }
+                        for (n = 0; n < N; n++) {
+                                moments->content[n][x] += s[n];
+                        }
+                }
+        }
+}
+
+/* The density of the success probability of event `which' at
+ * position x is the same mixture over the marginals of the Dirichlet
+ * posteriors of all bins that cover x. The density is evaluated on
+ * the grid given by the options and is zero outside of the density
+ * range. */
+void computeCoverageDensity(
+        matrix_t *density,
+        matrix_t *coverage,
+        binProblem *bp)
+{
+        options_t *options = bp->bd->options;
+        size_t L = bp->bd->L, G = density->columns;
+        size_t i, x, g;
+        prob_t a, b, P, p, lnP;
+        prob_t s[G], log_p[G], log_q[G];
+        int grid[G];
+
+        for (g = 0; g < G; g++) {
+                p       = g*options->density_step;
+                grid[g] = options->density_range.from <= p &&
+                          options->density_range.to   >= p &&
+                          p != 0.0 && p != 1.0;
+                if (grid[g]) {
+                        log_p[g] = LOG(p);
+                        log_q[g] = LOG(1.0-p);
+                }
+        }
+        for (x = 0; x < L; x++) {
+                for (g = 0; g < G; g++) {
+                        density->content[x][g] = 0.0;
+                }
+        }
+        for (i = 0; i < L; i++) {
+                for (g = 0; g < G; g++) {
+                        s[g] = 0.0;
+                }
+                for (x = L; x-- > i;) {
+                        P = coverage->content[i][x];
+                        if (P > 0.0) {
+                                binParameters(&a, &b, i, x, bp);
+                                lnP = LOG(P) + gsl_sf_lngamma(a+b) - gsl_sf_lngamma(a) - gsl_sf_lngamma(b);
+                                bp->counter.lngamma_calls += 3;
+                                for (g = 0; g < G; g++) {
+                                        if (grid[g]) {
+                                                s[g] += EXP(lnP + (a-1)*log_p[g] + (b-1)*log_q[g]);
+                                        }
+                                }
+                        }
+                        for (g = 0; g < G; g++) {
+                                density->content[x][g] += s[g];
+                        }
+                }
+        }
+}
+
+/* result[a][b]: probability that positions a and b are in the same
+ * bin, which is the coverage summed over all intervals [i,j] with
+ * i <= min(a,b) and max(a,b) <= j */
+void computeSameBin(
+        matrix_t *result,
+        matrix_t *coverage)
+{
+        size_t a, b, L = coverage->rows;
+
+        /* suffix sums over the end of the interval */
+        for (a = 0; a < L; a++) {
+                for (b = L; b-- > 0;) {
+                        if (b < a) {
+                                result->content[a][b] = 0.0;
+                        }
+                        else if (b == L-1) {
+                                result->content[a][b] = coverage->content[a][b];
+                        }
+                        else {
+                                result->content[a][b] = coverage->content[a][b] + result->content[a][b+1];
+                        }
+                }
+        }
+        /* prefix sums over the start of the interval */
+        for (a = 1; a < L; a++) {
+                for (b = a; b < L; b++) {
+                        result->content[a][b] += result->content[a-1][b];
+                }
+        }
+        /* symmetry */
+        for (a = 0; a < L; a++) {
+                for (b = 0; b < a; b++) {
+                        result->content[a][b] = result->content[b][a];
+                }
+        }
+}
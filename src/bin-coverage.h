@@ -0,0 +1,34 @@
+/* Copyright (C) 2012 Philipp Benner
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef BIN_COVERAGE_H
+#define BIN_COVERAGE_H
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <datatypes.h>
+
+void computeBinCoverage(matrix_t *coverage, prob_t evidence_ref, binData *bd);
+void hmm_computeBinCoverage(matrix_t *coverage, prob_t *forward, prob_t *backward, binProblem *bp);
+void binParameters(prob_t *a, prob_t *b, size_t i, size_t j, binProblem *bp);
+void computeCoverageMoments(matrix_t *moments, matrix_t *coverage, binProblem *bp);
+void computeCoverageDensity(matrix_t *density, matrix_t *coverage, binProblem *bp);
+void computeSameBin(matrix_t *result, matrix_t *coverage);
+
+#endif /* BIN_COVERAGE_H */
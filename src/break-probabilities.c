@@ -35,64 +35,57 @@
 
 #include <datatypes.h>
 #include <model.h>
-#include <threading.h>
 #include <tools.h>
 
 /******************************************************************************
- * Prombs entropy functions
+ * Break probabilities
  ******************************************************************************/
 
-static
-prob_t breakProb_f(int i, int j, void *data)
+/* The break probability at position i is the probability that a bin
+ * starts at i. All break probabilities are computed from a single
+ * forward and backward sweep of the binning algorithm, the multibin
+ * sampler counts the breaks of its samples. */
+void computeBreakProbabilities(
+        vector_t *bprob,
+        prob_t evidence_ref,
+        binData *bd)
 {
-        binProblem *bp = (binProblem *)data;
+        binProblem bp;
+        prob_t result[bd->L];
+        double scratch;
+        size_t i;
 
-        /* include only those bins that don't cover
-         * position pos, which means, that only multi-bins
-         * are included, that have a break at position
-         * pos */
-        if (i < bp->bprob_pos && bp->bprob_pos <= j) {
-                return -HUGE_VAL;
+        if (bd->options->algorithm == 1) {
+                mgs_get_bprob(bprob, bd->L);
+                return;
         }
-        return iec_log(i, j, bp);
-}
-static
-prob_t breakProb(size_t pos, prob_t evidence_ref, binProblem *bp)
-{
-        prob_t ev_log[bp->bd->L];
-
-        bp->bprob_pos = pos;
-        callBinningAlgorithm(&breakProb_f, ev_log, bp);
+        binProblemInit(&bp, bd);
+        /* forward and backward sums */
+        scratch = 2*bd->L*(minM(&bp)+1)*sizeof(prob_t);
+        statsScratch(bd, scratch);
+        prombs_breaks(result, bp.ak, bd->prior_log, &execPrombs_f, bd->L, minM(&bp), (void *)&bp);
+        statsScratch(bd, -scratch);
+        bp.counter.prombs_calls++;
 
-        return EXP(sumModels(ev_log, bp) - evidence_ref);
-}
-
-static
-void * computeBreakProbabilities_thread(void* data_)
-{
-        pthread_data_t *data  = (pthread_data_t *)data_;
-        binProblem *bp = data->bp;
-        int i = data->i;
-        vector_t *bprob = (vector_t *)data->result;
-        prob_t evidence_ref = data->evidence_ref;
-
-        bprob->content[i] = breakProb(i, evidence_ref, bp);
-        return NULL;
+        for (i = 0; i < bd->L; i++) {
+                bprob->content[i] = EXP(result[i] - evidence_ref);
+        }
+        binProblemFree(&bp);
 }
 
-/******************************************************************************
- * Main
- ******************************************************************************/
-
-void computeBreakProbabilities(
+/* Same as above for the hidden Markov model, where a break at
+ * position i is a transition between positions i-1 and i. */
+void hmm_computeBreakProbabilities(
         vector_t *bprob,
-        prob_t evidence_ref,
-        binData *bd)
+        prob_t *forward,
+        prob_t *backward,
+        binProblem *bp)
 {
-        if (bd->options->algorithm == 2) {
-                mgs_get_bprob(bprob, bd->L);
-                return;
+        size_t i, L = bp->bd->L;
+
+        bprob->content[0] = 1.0;
+        for (i = 1; i < L; i++) {
+                bprob->content[i] = EXP(forward[i-1] + LOG(1.0-bp->bd->options->rho)
+                                        + backward[i] - forward[L-1]);
         }
-        threaded_computation((void *)bprob, evidence_ref, bd, computeBreakProbabilities_thread,
-                             "Computing break probabilities: %.1f%%");
 }
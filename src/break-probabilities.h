@@ -25,5 +25,10 @@
 #include <datatypes.h>
 
 void computeBreakProbabilities(vector_t *bprob, prob_t evidence_ref, binData *bd);
+void hmm_computeBreakProbabilities(
+        vector_t *bprob,
+        prob_t *forward,
+        prob_t *backward,
+        binProblem *bp);
 
 #endif /* BREAK_PROBABILITIES_H */
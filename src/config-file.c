@@ -0,0 +1,436 @@
+/* Copyright (C) 2012 Philipp Benner
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+#ifdef HAVE_SYS_MMAN_H
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif /* HAVE_SYS_MMAN_H */
+
+#include <adaptive-sampling/exception.h>
+#include <adaptive-sampling/datatypes.h>
+#include <adaptive-sampling/linalg.h>
+
+#include <config-file.h>
+#include <count-statistic.h>
+
+/******************************************************************************
+ * Input stream
+ ******************************************************************************/
+
+/* Configuration files are read character by character, either from
+ * a memory map or through the buffer of stdio. Both need constant
+ * memory and can be rewound for another pass. */
+typedef struct {
+        FILE *fp;
+        const char *map;
+        size_t size;
+        size_t pos;
+} stream_t;
+
+static
+int stream_open(stream_t *s, const char *filename)
+{
+        s->fp   = NULL;
+        s->map  = NULL;
+        s->size = 0;
+        s->pos  = 0;
+#ifdef HAVE_SYS_MMAN_H
+        struct stat st;
+        int fd;
+
+        if ((fd = open(filename, O_RDONLY)) != -1 && fstat(fd, &st) != -1 && st.st_size > 0) {
+                s->map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (s->map == MAP_FAILED) {
+                        s->map = NULL;
+                }
+                else {
+                        s->size = st.st_size;
+#ifdef MADV_SEQUENTIAL
+                        madvise((void *)s->map, s->size, MADV_SEQUENTIAL);
+#endif /* MADV_SEQUENTIAL */
+                }
+        }
+        if (fd != -1) {
+                close(fd);
+        }
+        if (s->map != NULL) {
+                return 0;
+        }
+#endif /* HAVE_SYS_MMAN_H */
+        if ((s->fp = fopen(filename, "r")) == NULL) {
+                warn(NONE, "Could not open `%s'.", filename);
+                return -1;
+        }
+        return 0;
+}
+
+static
+void stream_close(stream_t *s)
+{
+#ifdef HAVE_SYS_MMAN_H
+        if (s->map) {
+                munmap((void *)s->map, s->size);
+        }
+#endif /* HAVE_SYS_MMAN_H */
+        if (s->fp) {
+                fclose(s->fp);
+        }
+}
+
+static
+void stream_rewind(stream_t *s)
+{
+        if (s->fp) {
+                rewind(s->fp);
+        }
+        s->pos = 0;
+}
+
+static __inline__
+int stream_getc(stream_t *s)
+{
+        if (s->fp) {
+                return getc(s->fp);
+        }
+        return s->pos < s->size ? (unsigned char)s->map[s->pos++] : EOF;
+}
+
+static
+int skip_line(stream_t *s, int c)
+{
+        while (c != '\n' && c != EOF) {
+                c = stream_getc(s);
+        }
+        return c;
+}
+
+/******************************************************************************
+ * Options
+ ******************************************************************************/
+
+/* maximal length of section names, option names and numbers */
+#define CONFIG_TOKEN 256
+
+typedef void (*config_f)(size_t row, size_t column, double x, void *data);
+
+/* Calls f for all numbers on the rest of the current line, returns
+ * the number of values or -1 if a token is not a number. */
+static
+long scan_values(stream_t *s, size_t row, config_f f, void *data, int *c)
+{
+        char token[CONFIG_TOKEN], *end;
+        size_t n = 0, column = 0;
+        double x;
+
+        for (*c = stream_getc(s);; *c = stream_getc(s)) {
+                if (*c == EOF || isspace(*c)) {
+                        if (n > 0) {
+                                token[n] = '\0';
+                                x = strtod(token, &end);
+                                if (*end != '\0') {
+                                        warn(NONE, "Invalid number `%s'.", token);
+                                        return -1;
+                                }
+                                (*f)(row, column++, x, data);
+                                n = 0;
+                        }
+                        if (*c == EOF || *c == '\n') {
+                                return column;
+                        }
+                }
+                else if (n < CONFIG_TOKEN-1) {
+                        token[n++] = *c;
+                }
+        }
+}
+
+/* read a name up to one of the delimiters, which is stripped and
+ * optionally converted to lower case like option names of
+ * ConfigParser */
+static
+int scan_name(stream_t *s, int c, char *name, const char *delimiters, int lower)
+{
+        size_t n = 0;
+
+        while (c != EOF && c != '\n' && strchr(delimiters, c) == NULL) {
+                if (n < CONFIG_TOKEN-1) {
+                        name[n++] = lower ? tolower(c) : c;
+                }
+                c = stream_getc(s);
+        }
+        while (n > 0 && isspace((unsigned char)name[n-1])) {
+                n--;
+        }
+        name[n] = '\0';
+        return c;
+}
+
+/* Calls f for all numbers of an option in a section of a
+ * configuration file, where each line of the value is a row. Returns
+ * the number of rows, -1 if the option does not exist and -2 if the
+ * value contains something else than numbers. */
+static
+long scan_option(
+        stream_t *s,
+        const char *section,
+        const char *option,
+        config_f f,
+        void *data)
+{
+        char name[CONFIG_TOKEN];
+        int c, in_section = 0, in_option = 0, found = 0;
+        long rows = 0, n;
+
+        stream_rewind(s);
+
+        for (c = stream_getc(s); c != EOF; c = stream_getc(s)) {
+                if (c == '[') {
+                        c = scan_name(s, stream_getc(s), name, "]", 0);
+                        in_section = strcmp(name, section) == 0;
+                        in_option  = 0;
+                        c = skip_line(s, c);
+                }
+                else if (c == ' ' || c == '\t') {
+                        /* continuation of a multi-line value */
+                        if (in_option) {
+                                if ((n = scan_values(s, rows, f, data, &c)) < 0) {
+                                        return -2;
+                                }
+                                rows += n > 0;
+                        }
+                        else {
+                                c = skip_line(s, c);
+                        }
+                }
+                else if (c == '#' || c == ';' || isspace(c)) {
+                        c = skip_line(s, c);
+                }
+                else {
+                        c = scan_name(s, c, name, ":=", 1);
+                        in_option = in_section && strcmp(name, option) == 0;
+                        if (in_option) {
+                                found = 1;
+                                if ((n = scan_values(s, rows, f, data, &c)) < 0) {
+                                        return -2;
+                                }
+                                rows += n > 0;
+                        }
+                        else {
+                                c = skip_line(s, c);
+                        }
+                }
+                if (c == EOF) {
+                        break;
+                }
+        }
+        return found ? rows : -1;
+}
+
+static
+void scan_scalar(size_t row, size_t column, double x, void *data)
+{
+        double *v = (double *)data;
+
+        v[column < 2 ? column : 1] = x;
+}
+
+/******************************************************************************
+ * Counts
+ ******************************************************************************/
+
+typedef struct {
+        size_t n;
+        size_t columns;
+        matrix_t **counts;
+        /* range of spike timings */
+        double min;
+        double max;
+        double binsize;
+        double from;
+        double to;
+        int skipped;
+} config_counts_t;
+
+static
+void scan_shape(size_t row, size_t column, double x, void *data)
+{
+        config_counts_t *cc = (config_counts_t *)data;
+
+        if (column >= cc->columns) {
+                cc->columns = column+1;
+        }
+        if (cc->n == 0 || x < cc->min) {
+                cc->min = x;
+        }
+        if (cc->n == 0 || x > cc->max) {
+                cc->max = x;
+        }
+        cc->n++;
+}
+
+/* events are stored on the diagonal of the count statistic */
+static
+void scan_events(size_t row, size_t column, double x, void *data)
+{
+        config_counts_t *cc = (config_counts_t *)data;
+
+        cc->counts[row]->content[column][column] = x;
+}
+
+static
+void scan_timings(size_t row, size_t column, double x, void *data)
+{
+        config_counts_t *cc = (config_counts_t *)data;
+        size_t L = cc->counts[0]->rows;
+        long i = timingPosition(x, cc->binsize, cc->from, cc->to, L);
+
+        if (i < 0) {
+                cc->skipped++;
+        }
+        else {
+                cc->counts[0]->content[i][i] += 1.0;
+        }
+}
+
+static
+matrix_t** alloc_counts(size_t K, size_t L)
+{
+        matrix_t **counts = (matrix_t **)malloc(K*sizeof(matrix_t *));
+        size_t k;
+
+        for (k = 0; k < K; k++) {
+                counts[k] = alloc_matrix(L, L);
+        }
+        return counts;
+}
+
+static
+void free_counts(matrix_t **counts, size_t K)
+{
+        size_t k;
+
+        for (k = 0; k < K; k++) {
+                free_matrix(counts[k]);
+        }
+        free(counts);
+}
+
+/* The `counts' option of a [Counts] section contains one line of
+ * events per row. The first pass determines the dimension, the
+ * second one stores the events. */
+matrix_t** readConfigCounts(const char *filename, int *events)
+{
+        config_counts_t cc;
+        stream_t s;
+        long rows;
+        size_t k;
+
+        if (stream_open(&s, filename) != 0) {
+                return NULL;
+        }
+        cc.n       = 0;
+        cc.columns = 0;
+        rows       = scan_option(&s, "Counts", "counts", scan_shape, &cc);
+        if (rows <= 0 || cc.n != rows*cc.columns) {
+                warn(NONE, "Invalid counts in `%s'.", filename);
+                stream_close(&s);
+                return NULL;
+        }
+        cc.counts = alloc_counts(rows, cc.columns);
+        scan_option(&s, "Counts", "counts", scan_events, &cc);
+        stream_close(&s);
+
+        for (k = 0; k < rows; k++) {
+                cumulateCountStatistic(cc.counts[k]);
+        }
+        *events = rows;
+
+        return cc.counts;
+}
+
+/* The `timings' option of a [Trials] section contains one line of
+ * spike timings per trial, the range is either given by the `range'
+ * option or by the smallest and largest spike timing. */
+matrix_t** readConfigTimings(const char *filename, double *range)
+{
+        config_counts_t cc;
+        stream_t s;
+        double v[2];
+        long trials;
+        size_t i, L;
+
+        if (stream_open(&s, filename) != 0) {
+                return NULL;
+        }
+        if (scan_option(&s, "Trials", "binsize", scan_scalar, v) != 1 || v[0] <= 0) {
+                warn(NONE, "Invalid binsize in `%s'.", filename);
+                stream_close(&s);
+                return NULL;
+        }
+        cc.binsize = v[0];
+        cc.n       = 0;
+        cc.columns = 0;
+        cc.skipped = 0;
+        if ((trials = scan_option(&s, "Trials", "timings", scan_shape, &cc)) <= 0) {
+                warn(NONE, "Invalid timings in `%s'.", filename);
+                stream_close(&s);
+                return NULL;
+        }
+        if (scan_option(&s, "Trials", "range", scan_scalar, v) == 1) {
+                cc.from = v[0];
+                cc.to   = v[1];
+        }
+        else {
+                cc.from = floor(cc.min);
+                cc.to   = floor(cc.max);
+        }
+        L         = timingsPositions(cc.binsize, cc.from, cc.to);
+        cc.counts = alloc_counts(2, L);
+        scan_option(&s, "Trials", "timings", scan_timings, &cc);
+        stream_close(&s);
+
+        for (i = 0; i < L; i++) {
+                if (cc.counts[0]->content[i][i] > trials) {
+                        warn(NONE, "Number of trials is smaller than some counts.");
+                        free_counts(cc.counts, 2);
+                        return NULL;
+                }
+                cc.counts[1]->content[i][i] = trials - cc.counts[0]->content[i][i];
+        }
+        if (cc.skipped > 0) {
+                warn(NONE, "Skipped %d spikes outside of the range.", cc.skipped);
+        }
+        cumulateCountStatistic(cc.counts[0]);
+        cumulateCountStatistic(cc.counts[1]);
+        if (range) {
+                range[0] = cc.from;
+                range[1] = cc.to;
+        }
+        return cc.counts;
+}
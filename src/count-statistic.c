@@ -0,0 +1,155 @@
+/* Copyright (C) 2012 Philipp Benner
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <adaptive-sampling/exception.h>
+#include <adaptive-sampling/datatypes.h>
+#include <adaptive-sampling/linalg.h>
+
+#include <count-statistic.h>
+
+/******************************************************************************
+ * Count statistic
+ ******************************************************************************/
+
+/* counts[i][j]: number of events at positions i,...,j, which is a
+ * running sum over each row of the upper triangle */
+static
+void fillCountStatistic(matrix_t *counts, const double *x, size_t L)
+{
+        size_t i, j;
+        double sum;
+
+        for (i = 0; i < L; i++) {
+                for (j = 0; j < i; j++) {
+                        counts->content[i][j] = 0.0;
+                }
+                sum = 0.0;
+                for (j = i; j < L; j++) {
+                        sum += x[j];
+                        counts->content[i][j] = sum;
+                }
+        }
+}
+
+/* Same as above for events that are stored on the diagonal of the
+ * count statistic, which is filled in place. */
+void cumulateCountStatistic(matrix_t *counts)
+{
+        size_t i, j, L = counts->rows;
+
+        for (i = 0; i < L; i++) {
+                for (j = 0; j < i; j++) {
+                        counts->content[i][j] = 0.0;
+                }
+                for (j = i+1; j < L; j++) {
+                        counts->content[i][j] = counts->content[i][j-1] + counts->content[j][j];
+                }
+        }
+}
+
+/* events: KxL matrix with the number of events of type k at each
+ * position */
+void computeCountStatistic(
+        matrix_t **counts,
+        const matrix_view_t *events)
+{
+        size_t L = events->columns;
+        size_t i, k;
+        double x[L];
+
+        for (k = 0; k < events->rows; k++) {
+                for (i = 0; i < L; i++) {
+                        x[i] = matrix_view_get(events, k, i);
+                }
+                fillCountStatistic(counts[k], x, L);
+        }
+}
+
+/******************************************************************************
+ * Spike timings
+ ******************************************************************************/
+
+size_t timingsPositions(double binsize, double from, double to)
+{
+        return (size_t)ceil((to-from)/binsize) + 1;
+}
+
+/* A spike at time t is a success at position ceil((t-from)/binsize),
+ * returns -1 for spikes outside of [from, to]. */
+long timingPosition(double t, double binsize, double from, double to, size_t L)
+{
+        size_t n;
+
+        if (!(from <= t && t <= to)) {
+                return -1;
+        }
+        n = (size_t)ceil((t-from)/binsize);
+
+        return n < L ? (long)n : -1;
+}
+
+/* The spike timings of all trials are concatenated. All trials
+ * without a spike at a position are failures. Spikes are counted in a
+ * single pass, those outside [from, to] are skipped. Returns the
+ * number of skipped spikes or -1 if a position has more spikes than
+ * trials. */
+int computeTimingCounts(
+        matrix_t **counts,
+        size_t trials,
+        const vector_t *timings,
+        double binsize,
+        double from,
+        double to)
+{
+        size_t L = counts[0]->columns;
+        size_t i;
+        long n;
+        double successes[L], failures[L], t;
+        int skipped = 0;
+
+        for (i = 0; i < L; i++) {
+                successes[i] = 0.0;
+        }
+        for (i = 0; i < timings->size; i++) {
+                t = timings->content[i];
+                if (!(from <= t && t <= to)) {
+                        skipped++;
+                        continue;
+                }
+                if ((n = timingPosition(t, binsize, from, to, L)) >= 0) {
+                        successes[n] += 1.0;
+                }
+        }
+        for (i = 0; i < L; i++) {
+                if (successes[i] > trials) {
+                        return -1;
+                }
+                failures[i] = trials - successes[i];
+        }
+        fillCountStatistic(counts[0], successes, L);
+        fillCountStatistic(counts[1], failures,  L);
+
+        return skipped;
+}
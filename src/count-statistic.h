@@ -0,0 +1,50 @@
+/* Copyright (C) 2012 Philipp Benner
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef COUNT_STATISTIC_H
+#define COUNT_STATISTIC_H
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <adaptive-sampling/datatypes.h>
+
+void cumulateCountStatistic(
+        matrix_t *counts);
+void computeCountStatistic(
+        matrix_t **counts,
+        const matrix_view_t *events);
+size_t timingsPositions(
+        double binsize,
+        double from,
+        double to);
+long timingPosition(
+        double t,
+        double binsize,
+        double from,
+        double to,
+        size_t L);
+int computeTimingCounts(
+        matrix_t **counts,
+        size_t trials,
+        const vector_t *timings,
+        double binsize,
+        double from,
+        double to);
+
+#endif /* COUNT_STATISTIC_H */
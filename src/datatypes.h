@@ -30,6 +30,31 @@
  * Data structures
  ******************************************************************************/
 
+/* order and deadline of threaded computations over all positions */
+typedef struct {
+        /* positions in the order in which they are processed, NULL
+         * for 0, ..., L-1 */
+        size_t *order;
+        /* absolute wall-clock time in seconds, zero for none */
+        double deadline;
+        /* set for all positions that were completed, may be NULL */
+        int *complete;
+        /* set if outstanding tasks were cancelled */
+        volatile int cancel;
+} schedule_t;
+
+/* timers and counters of a computation, shared by all threads */
+typedef struct {
+        stats_t *result;
+        /* scratch memory in use */
+        double scratch;
+        /* cpu time of all workers that finished */
+        double worker_cpu;
+        /* time that workers spent on tasks and time they were running */
+        double busy;
+        double running;
+} stats_collector_t;
+
 /* data that has to be immutable */
 typedef struct {
         options_t *options;
@@ -42,6 +67,10 @@ typedef struct {
         matrix_t **alpha;
         vector_t  *beta;       /* P(m_B) */
         matrix_t  *gamma;
+        /* optional schedule, NULL if positions are processed in order */
+        schedule_t *schedule;
+        /* optional statistics, NULL if not requested */
+        stats_collector_t *stats;
 } binData;
 
 /* mutable data, local to each thread */
@@ -49,8 +78,13 @@ typedef struct {
         binData* bd;
         /* temporary memory for prombs */
         prob_t** ak;
-        /* break probability */
-        int bprob_pos;
+        /* work counters, which are added to the statistics when the
+         * problem is freed */
+        struct {
+                unsigned long prombs_calls;
+                unsigned long evaluations;
+                unsigned long lngamma_calls;
+        } counter;
         /* effective counts */
         int counts_pos;
         /* moments */
@@ -59,6 +93,12 @@ typedef struct {
                 int n;
                 int which;
         } add_event;
+        /* events added along a sampling path */
+        struct {
+                int n;
+                int *pos;
+                int *which;
+        } add_path;
         /* marginals */
         struct {
                 int pos;
@@ -67,4 +107,18 @@ typedef struct {
         } fix_prob;
 } binProblem;
 
+/******************************************************************************
+ * Initialization
+ ******************************************************************************/
+
+void bin_init(
+        size_t events,
+        matrix_t **counts,
+        matrix_t **alpha,
+        vector_t  *beta,
+        matrix_t  *gamma,
+        options_t* options,
+        binData* bd);
+void bin_free(binData* bd);
+
 #endif /* DATATYPES_H */
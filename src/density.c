@@ -46,25 +46,17 @@ static
 prob_t hmm_hd(int from, int to, binProblem* bp)
 {
         size_t i;
-        prob_t counts;
+        prob_t counts[bp->bd->events];
         prob_t alpha [bp->bd->events];
-        prob_t result = 0;
 
+        bp->counter.evaluations++;
         for (i = 0; i < bp->bd->events; i++) {
-                alpha[i] = countAlpha(i, from, from, bp); 
-        }
-        result -= mbeta_log(alpha, bp);
-        for (i = 0; i < bp->bd->events; i++) {
-                counts = countAlpha(i, from, from, bp) + countStatistic(i, from, to, bp);
-                if (i == bp->fix_prob.which) {
-                        result += (counts-1)*LOG(bp->fix_prob.val);
-                }
-                else {
-                        result += (counts-1)*LOG(1-bp->fix_prob.val);
-                }
+                alpha [i] = countAlpha(i, from, from, bp);
+                counts[i] = alpha[i] + countStatistic(i, from, to, bp);
         }
 
-        return result;
+        return mbeta_marginal_log(counts, bp->fix_prob.val, bp->fix_prob.which, bp)
+                - mbeta_log(alpha, bp);
 }
 
 void hmm_computeDensity(
@@ -133,7 +125,6 @@ prob_t density(
  * Loop through all X
  ******************************************************************************/
 
-static
 void * computeDensity_thread(void* data_)
 {
         pthread_data_t *data  = (pthread_data_t *)data_;
@@ -163,5 +154,5 @@ void computeDensity(
         binData *bd)
 {
         threaded_computation((void *)result, evidence_ref, bd, computeDensity_thread,
-                             "Computing density: %.1f%%");
+                             "density", "Computing density: %.1f%%");
 }
@@ -25,6 +25,7 @@
 #include <adaptive-sampling/datatypes.h>
 
 void computeDensity(matrix_t *result, prob_t evidence_ref, binData *bd);
+void * computeDensity_thread(void* data);
 void hmm_computeDensity(
        matrix_t *result,
        prob_t *forward,
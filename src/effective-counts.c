@@ -35,6 +35,7 @@
 
 #include <datatypes.h>
 #include <model.h>
+#include <threading.h>
 #include <tools.h>
 
 /******************************************************************************
@@ -138,34 +139,58 @@ void computeExpectation(utility_t* result, size_t i, prob_t evidence_ref, binPro
 {
         size_t j;
 
-        for (j = 0; j < bp->bd->events; j++) {
+        for (j = 0; j < bp->bd->events && !cancelled(bp); j++) {
                 result->expectation->content[j][i] = expectation(j, i, evidence_ref, bp);
         }
 }
 
 /******************************************************************************
- * Main
+ * Threading
  ******************************************************************************/
 
-void computeEffectiveCountsUtility(
-        utility_t *result,
-        prob_t evidence_ref,
-        binData* bd)
+static
+void * computeEffectiveCountsUtility_thread(void* data_)
 {
-        binProblem bp; binProblemInit(&bp, bd);
-        size_t i;
+        pthread_data_t *data = (pthread_data_t *)data_;
+        utility_t *result    = (utility_t *)data->result;
+
+        /* for each event compute its expectation */
+        computeExpectation(result, data->i, data->evidence_ref, data->bp);
 
-        for (i = 0; i < bd->L; i++) {
-                notice(NONE, "Computing effective counts... %.1f%%", (float)100*(i+1)/bd->L);
+        /* compute utilities */
+        if (!cancelled(data->bp)) {
+                result->utility->content[data->i] = -effectiveCounts(data->i, data->evidence_ref, data->bp);
+        }
+        return NULL;
+}
 
-                /* for each event compute its expectation */
-                computeExpectation(result, i, evidence_ref, &bp);
+static
+void * computeEffectivePosteriorCountsUtility_thread(void* data_)
+{
+        pthread_data_t *data = (pthread_data_t *)data_;
+        utility_t *result    = (utility_t *)data->result;
 
-                /* compute utilities */
-                result->utility->content[i] = -effectiveCounts(i, evidence_ref, &bp);
+        /* for each event compute its expectation */
+        computeExpectation(result, data->i, data->evidence_ref, data->bp);
+
+        /* compute utilities */
+        if (!cancelled(data->bp)) {
+                result->utility->content[data->i] = -effectivePosteriorCounts(data->i, data->evidence_ref, data->bp);
         }
+        return NULL;
+}
 
-        binProblemFree(&bp);
+/******************************************************************************
+ * Main
+ ******************************************************************************/
+
+void computeEffectiveCountsUtility(
+        utility_t *result,
+        prob_t evidence_ref,
+        binData* bd)
+{
+        threaded_computation((void *)result, evidence_ref, bd, computeEffectiveCountsUtility_thread,
+                             "effective-counts", "Computing effective counts... %.1f%%");
 }
 
 void computeEffectivePosteriorCountsUtility(
@@ -173,18 +198,6 @@ void computeEffectivePosteriorCountsUtility(
         prob_t evidence_ref,
         binData* bd)
 {
-        binProblem bp; binProblemInit(&bp, bd);
-        size_t i;
-
-        for (i = 0; i < bd->L; i++) {
-                notice(NONE, "Computing posterior effective counts... %.1f%%", (float)100*(i+1)/bd->L);
-
-                /* for each event compute its expectation */
-                computeExpectation(result, i, evidence_ref, &bp);
-
-                /* compute utilities */
-                result->utility->content[i] = -effectivePosteriorCounts(i, evidence_ref, &bp);
-        }
-
-        binProblemFree(&bp);
+        threaded_computation((void *)result, evidence_ref, bd, computeEffectivePosteriorCountsUtility_thread,
+                             "effective-posterior-counts", "Computing posterior effective counts... %.1f%%");
 }
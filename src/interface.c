@@ -34,6 +34,9 @@ vector_t * _alloc_vector(int size)              { return alloc_vector(size); }
 void       _free_vector(vector_t *v)            { free_vector(v); }
 matrix_t * _alloc_matrix(int rows, int columns) { return alloc_matrix(rows, columns); }
 void       _free_matrix(matrix_t *m)            { free_matrix(m); }
+matrix_view_t * _alloc_matrix_view(double *data, int rows, int columns, int stride, int layout)
+                                                { return alloc_matrix_view(data, rows, columns, stride, layout); }
+void       _free_matrix_view(matrix_view_t *v)  { free_matrix_view(v); }
 void       _free(void *ptr)                     { free(ptr); }
 
 double get_huge_val(void)
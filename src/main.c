@@ -21,6 +21,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <strings.h>
 #include <assert.h>
 #include <math.h>
@@ -32,17 +33,27 @@
 #include <adaptive-sampling/mgs.h>
 #include <adaptive-sampling/prombs.h>
 #include <adaptive-sampling/datatypes.h>
+#include <adaptive-sampling/interface.h>
 
 #include <gsl/gsl_sf_gamma.h>
 
+#include <batch.h>
+#include <bin-coverage.h>
 #include <break-probabilities.h>
+#include <config-file.h>
+#include <count-statistic.h>
 #include <datatypes.h>
 #include <density.h>
-#include <effective-counts.h>
 #include <main-test.h>
+#include <mixture.h>
 #include <model.h>
 #include <model-posterior.h>
 #include <moment.h>
+#include <policy.h>
+#include <simulation.h>
+#include <stats.h>
+#include <threading.h>
+#include <trace.h>
 #include <utility.h>
 #include <tools.h>
 
@@ -64,21 +75,105 @@ void copyModelPrior(binData* bd)
         }
 }
 
+/* The marginals of further events are computed from a shallow copy
+ * of the binProblem that differs only in the selected event, all
+ * data and temporary memory are shared. */
+typedef struct {
+        options_t options;
+        binData bd;
+        binProblem bp;
+} event_problem_t;
+
+static
+binProblem * eventProblem(event_problem_t *ep, int which, binProblem *bp)
+{
+        ep->options            = *bp->bd->options;
+        ep->options.which      = which;
+        ep->bd                 = *bp->bd;
+        ep->bd.options         = &ep->options;
+        ep->bp                 = *bp;
+        ep->bp.bd              = &ep->bd;
+        ep->bp.add_event.which = which;
+        ep->bp.fix_prob.which  = which;
+
+        return &ep->bp;
+}
+
 static
-void computeUtility(utility_t *result, prob_t evidence_ref, binData* bd)
+void computeMarginals(
+        marginal_t *result,
+        matrix_t *coverage,
+        binProblem *bp)
 {
-        /* compute kl-divergence */
-        if (bd->options->kl_psi || bd->options->kl_multibin) {
-                computeKLUtility(result, evidence_ref, bd);
+        options_t *options = bp->bd->options;
+        stats_timer_t timer;
+
+        if (options->density || options->n_levels > 0) {
+                statsStart(&timer, bp->bd);
+                if (options->density && options->density_accuracy > 0.0) {
+                        computeAdaptiveDensity(result, coverage, bp);
+                }
+                else if (options->density) {
+                        computeCoverageDensity(result->density, coverage, bp);
+                }
+                if (options->n_levels > 0) {
+                        computeQuantiles(result, coverage, bp);
+                }
+                statsStop(&timer, STATS_DENSITY, bp->bd);
         }
-        /* compute effective counts */
-        else if (bd->options->effective_counts) {
-                computeEffectiveCountsUtility(result, evidence_ref, bd);
+
+        if (options->n_moments > 0) {
+                statsStart(&timer, bp->bd);
+                computeCoverageMoments(result->moments, coverage, bp);
+                statsStop(&timer, STATS_MOMENTS, bp->bd);
         }
-        /* compute effective posterior counts */
-        else if (bd->options->effective_posterior_counts) {
-                computeEffectivePosteriorCountsUtility(result, evidence_ref, bd);
+}
+
+/* The posterior at each position is a mixture over all bins that
+ * cover it. Densities and moments are derived from the bin coverage
+ * P([i,j] is a bin|D), which is computed only once for all events. */
+static
+void computeMixture(
+        marginal_t *result,
+        prob_t evidence_ref,
+        binProblem *bp)
+{
+        options_t *options = bp->bd->options;
+        matrix_t *coverage = result->coverage;
+        event_problem_t ep;
+        stats_timer_t timer;
+        int k;
+
+        if (!options->density && options->n_moments <= 0 && !options->coverage &&
+            options->n_levels <= 0) {
+                return;
+        }
+        if (coverage == NULL) {
+                coverage = alloc_matrix(bp->bd->L, bp->bd->L);
+                statsScratch(bp->bd, bp->bd->L*bp->bd->L*sizeof(double));
+        }
+        statsStart(&timer, bp->bd);
+        computeBinCoverage(coverage, evidence_ref, bp->bd);
+        statsStop(&timer, STATS_COVERAGE, bp->bd);
+
+        computeMarginals(result, coverage, bp);
+        for (k = 0; k < result->events; k++) {
+                if (result->event[k]) {
+                        computeMarginals(result->event[k], coverage, eventProblem(&ep, k, bp));
+                        /* keep the work counters of the copy */
+                        bp->counter = ep.bp.counter;
+                }
         }
+        if (coverage != result->coverage) {
+                free_matrix(coverage);
+                statsScratch(bp->bd, -(double)bp->bd->L*bp->bd->L*sizeof(double));
+        }
+}
+
+static
+int mgsProgress(size_t done, size_t total, void *data)
+{
+        return progressUpdate((progress_t *)data, done);
 }
 
 static
@@ -89,11 +184,20 @@ void computeBinning(
         binProblem bp; binProblemInit(&bp, bd);
         prob_t evidence_ref;
         prob_t evidence_log_tmp[bd->L];
+        stats_timer_t timer;
+        progress_t progress;
+        double trace;
 
-        /* init sampler */
+        statsStart(&timer, bd);
+        /* init sampler, the chain is recorded as a single event */
         if (bd->options->algorithm == 1) {
+                progressStart(&progress, "mgs-samples", "Generating samples... %.1f%%",
+                              bd->options->samples[0] + bd->options->samples[1]);
+                trace = traceBegin();
                 mgs_init(bd->options->samples[0], bd->options->samples[1],
-                         bd->prior_log, &execPrombs_f, bd->L, (void *)&bp);
+                         bd->prior_log, &execPrombs_f, bd->L, (void *)&bp,
+                         &mgsProgress, (void *)&progress);
+                traceEnd("mgs-chain", "task", -1, trace);
         }
         /* compute evidence P(D) */
         evidence_ref = evidence(evidence_log_tmp, &bp);
@@ -101,17 +205,14 @@ void computeBinning(
         if (bd->options->model_posterior) {
                 computeModelPosteriors(evidence_log_tmp, result->mpost, evidence_ref, bd);
         }
-        /* compute density */
-        if (bd->options->density) {
-                computeDensity(result->density, evidence_ref, bd);
-        }
+        statsStop(&timer, STATS_EVIDENCE, bd);
+        /* compute density and the first n moments */
+        computeMixture(result, evidence_ref, &bp);
         /* compute break probability */
         if (bd->options->bprob) {
+                statsStart(&timer, bd);
                 computeBreakProbabilities(result->bprob, evidence_ref, bd);
-        }
-        /* compute the first n moments */
-        if (bd->options->n_moments > 0) {
-                computeMoments(result->moments, evidence_ref, bd);
+                statsStop(&timer, STATS_BPROB, bd);
         }
 
         if (bd->options->algorithm == 1) {
@@ -120,31 +221,134 @@ void computeBinning(
         binProblemFree(&bp);
 }
 
+static
+void hmm_computeMarginals(
+        marginal_t *result,
+        prob_t *forward,
+        prob_t *backward,
+        matrix_t *coverage,
+        binProblem *bp)
+{
+        options_t *options = bp->bd->options;
+        stats_timer_t timer;
+
+        /* compute the first n moments */
+        if (options->n_moments > 0) {
+                statsStart(&timer, bp->bd);
+                hmm_computeMoments(result->moments, forward, backward, bp);
+                statsStop(&timer, STATS_MOMENTS, bp->bd);
+        }
+        if (options->density || options->n_levels > 0) {
+                statsStart(&timer, bp->bd);
+                /* compute density */
+                if (options->density && options->density_accuracy > 0.0) {
+                        computeAdaptiveDensity(result, coverage, bp);
+                }
+                else if (options->density) {
+                        computeCoverageDensity(result->density, coverage, bp);
+                }
+                /* compute quantiles and highest density intervals */
+                if (options->n_levels > 0) {
+                        computeQuantiles(result, coverage, bp);
+                }
+                statsStop(&timer, STATS_DENSITY, bp->bd);
+        }
+}
+
+/* forward and backward messages and the bin coverage are shared by
+ * all events */
 static
 void computeHMM(
         marginal_t* result,
         binData *bd)
 {
         binProblem bp; binProblemInit(&bp, bd);
+        matrix_t *coverage = result->coverage;
+        event_problem_t ep;
+        stats_timer_t timer;
+        int k;
 
         prob_t forward [bd->L];
         prob_t backward[bd->L];
 
+        statsStart(&timer, bd);
         hmm_forward (forward,  &bp);
         hmm_backward(backward, &bp);
+        statsStop(&timer, STATS_EVIDENCE, bd);
 
-        /* compute the first n moments */
-        if (bd->options->n_moments > 0) {
-                hmm_computeMoments(result->moments, forward, backward, &bp);
+        /* compute bin coverage, which is also needed by the densities
+         * and the quantiles, all events share the same mixture over
+         * segments */
+        if ((bd->options->density || bd->options->n_levels > 0) && coverage == NULL) {
+                coverage = alloc_matrix(bd->L, bd->L);
+                statsScratch(bd, bd->L*bd->L*sizeof(double));
+        }
+        if (coverage) {
+                statsStart(&timer, bd);
+                hmm_computeBinCoverage(coverage, forward, backward, &bp);
+                statsStop(&timer, STATS_COVERAGE, bd);
         }
-        /* compute density */
-        if (bd->options->density) {
-                hmm_computeDensity(result->density, forward, backward, &bp);
+        hmm_computeMarginals(result, forward, backward, coverage, &bp);
+        if (bd->options->bprob) {
+                statsStart(&timer, bd);
+                hmm_computeBreakProbabilities(result->bprob, forward, backward, &bp);
+                statsStop(&timer, STATS_BPROB, bd);
+        }
+        for (k = 0; k < result->events; k++) {
+                if (result->event[k]) {
+                        hmm_computeMarginals(result->event[k], forward, backward, coverage,
+                                             eventProblem(&ep, k, &bp));
+                        /* keep the work counters of the copy */
+                        bp.counter = ep.bp.counter;
+                }
+        }
+        if (coverage != result->coverage) {
+                free_matrix(coverage);
+                statsScratch(bd, -(double)bd->L*bd->L*sizeof(double));
         }
 
         binProblemFree(&bp);
 }
 
+typedef struct {
+        double priority;
+        size_t pos;
+} priority_t;
+
+static
+int priority_cmp(const void *a, const void *b)
+{
+        const priority_t *pa = (const priority_t *)a;
+        const priority_t *pb = (const priority_t *)b;
+
+        if (pa->priority != pb->priority) {
+                return pa->priority < pb->priority ? 1 : -1;
+        }
+        return pa->pos < pb->pos ? -1 : (pa->pos > pb->pos);
+}
+
+/* positions sorted by decreasing priority, the natural order is used
+ * if no priority is given */
+static
+void computeOrder(size_t *order, vector_t *priority, size_t L)
+{
+        priority_t tmp[L];
+        size_t i;
+
+        if (priority && priority->size != L) {
+                warn(NONE, "Priority vector has wrong size, ignoring it.");
+                priority = NULL;
+        }
+        for (i = 0; i < L; i++) {
+                tmp[i].priority = priority ? priority->content[i] : 0.0;
+                tmp[i].pos      = i;
+        }
+        qsort(tmp, L, sizeof(priority_t), priority_cmp);
+        for (i = 0; i < L; i++) {
+                order[i] = tmp[i].pos;
+        }
+}
+
 /******************************************************************************
  * Initialization of common data structures
  ******************************************************************************/
@@ -193,6 +397,8 @@ void bin_init(
         bd->alpha       = alpha;
         bd->beta        = beta;
         bd->gamma       = gamma;
+        bd->schedule    = NULL;
+        bd->stats       = NULL;
         bd->prior_log   = (prob_t *)malloc(L*sizeof(prob_t));
 
         /* compute the model prior once for all computations */
@@ -208,6 +414,57 @@ void bin_free(binData* bd)
  * Library entry point
  ******************************************************************************/
 
+/* The marginals of all events selected by the event mask are
+ * allocated as well, their results that do not depend on the event
+ * are omitted. */
+static
+marginal_t * allocMarginal(size_t L, int events, options_t *options)
+{
+        marginal_t *result = (marginal_t *)malloc(sizeof(marginal_t));
+        options_t tmp;
+        int k;
+
+        result->moments    = (options->n_moments       ? alloc_matrix(options->n_moments, L)   : NULL);
+        result->density    = (options->density         ? alloc_matrix(L, options->n_density)   : NULL);
+        result->bprob      = (options->bprob           ? alloc_vector(L)                       : NULL);
+        result->mpost      = (options->model_posterior ? alloc_vector(L)                       : NULL);
+        result->coverage   = (options->coverage        ? alloc_matrix(L, L)                    : NULL);
+        result->density_points = NULL;
+        result->quantiles  = (options->n_levels > 0    ? alloc_matrix(options->n_levels, L)    : NULL);
+        result->hdi        = (options->n_levels > 0    ? alloc_matrix(2*options->n_levels, L)  : NULL);
+        result->events     = 0;
+        result->event      = NULL;
+        result->stats      = NULL;
+
+        if (options->event_mask) {
+                tmp                 = *options;
+                tmp.bprob           = 0;
+                tmp.model_posterior = 0;
+                tmp.coverage        = 0;
+                tmp.event_mask      = 0;
+                result->events      = events;
+                result->event       = (marginal_t **)malloc(events*sizeof(marginal_t *));
+                for (k = 0; k < events; k++) {
+                        result->event[k] = (options->event_mask & (1 << k) ? allocMarginal(L, 0, &tmp) : NULL);
+                }
+        }
+        return result;
+}
+
+/* Statistics are collected by sc if requested by the options. */
+static
+stats_t * allocStats(stats_collector_t *sc, binData *bd)
+{
+        stats_t *result = NULL;
+
+        if (bd->options->stats) {
+                result    = (stats_t *)malloc(sizeof(stats_t));
+                bd->stats = sc;
+                statsInit(sc, result);
+        }
+        return result;
+}
+
 marginal_t *
 posterior(
         int events,
@@ -218,15 +475,11 @@ posterior(
         options_t *options)
 {
         binData bd;
-        size_t L = counts[0]->columns;
-
-        marginal_t *result = (marginal_t *)malloc(sizeof(marginal_t));
-        result->moments    = (options->n_moments       ? alloc_matrix(options->n_moments, L)   : NULL);
-        result->density    = (options->density         ? alloc_matrix(L, options->n_density)   : NULL);
-        result->bprob      = (options->bprob           ? alloc_vector(L)                       : NULL);
-        result->mpost      = (options->model_posterior ? alloc_vector(L)                       : NULL);
+        stats_collector_t stats;
+        marginal_t *result = allocMarginal(counts[0]->columns, events, options);
 
         bin_init(events, counts, alpha, beta, gamma, options, &bd);
+        result->stats = allocStats(&stats, &bd);
 
         if (options->prombsTest) {
                 prombsTest(&bd);
@@ -237,11 +490,247 @@ posterior(
         else {
                 computeBinning(result, &bd);
         }
+        statsFinish(bd.stats);
         bin_free(&bd);
 
         return result;
 }
 
+/*
+ * Compute the posterior of several data sets, all tasks are
+ * distributed to a single pool of threads
+ */
+typedef struct {
+        marginal_t *result;
+        prob_t evidence_ref;
+        binData bd;
+        /* number of consecutive data sets with the same length and
+         * prior whose evidences are computed by this entry */
+        size_t lanes;
+} batch_t;
+
+/* The evidences of all lanes are computed by a single call to
+ * prombs_lanes(). The thread-local binProblem is shared by all
+ * lanes, only its data set is replaced. */
+static
+void batchEvidenceLanes(batch_t *batch, binProblem *bp)
+{
+        binData *bd = bp->bd;
+        size_t i, j, l, L = bd->L, n = batch->lanes;
+        prob_t *table = (prob_t *)malloc(prombs_table_size(L)*n*sizeof(prob_t));
+        prob_t *ev_log[n];
+        stats_timer_t timer;
+
+        statsStart(&timer, bd);
+        statsScratch(bd, prombs_table_size(L)*n*sizeof(prob_t));
+        for (l = 0; l < n; l++) {
+                bp->bd    = &batch[l].bd;
+                ev_log[l] = (prob_t *)malloc(L*sizeof(prob_t));
+                for (j = 0; j < L; j++) {
+                        for (i = 0; i <= j; i++) {
+                                table[PROMBS_TABLE_INDEX(i, j)*n + l] = iec_log(i, j, bp);
+                        }
+                }
+        }
+        bp->bd = bd;
+        prombs_lanes(ev_log, table, bd->prior_log, L, minM(bp), n);
+        bp->counter.prombs_calls++;
+
+        for (l = 0; l < n; l++) {
+                bp->bd = &batch[l].bd;
+                batch[l].evidence_ref = sumModels(ev_log[l], bp);
+                if (bd->options->model_posterior) {
+                        computeModelPosteriors(ev_log[l], batch[l].result->mpost, batch[l].evidence_ref, bp->bd);
+                }
+                free(ev_log[l]);
+        }
+        bp->bd = bd;
+        free(table);
+        statsScratch(bd, -(double)prombs_table_size(L)*n*sizeof(prob_t));
+        statsStop(&timer, STATS_EVIDENCE, bd);
+}
+
+static
+void * batchEvidence_thread(void* data_)
+{
+        pthread_data_t *data = (pthread_data_t *)data_;
+        batch_t *batch = (batch_t *)data->result;
+        binData *bd    = data->bp->bd;
+
+        if (bd->options->hmm) {
+                computeHMM(batch->result, bd);
+        }
+        else {
+                batchEvidenceLanes(batch, data->bp);
+        }
+        return NULL;
+}
+
+static
+void * batchMixture_thread(void* data_)
+{
+        pthread_data_t *data = (pthread_data_t *)data_;
+        batch_t *batch = (batch_t *)data->result;
+
+        computeMixture(batch->result, batch->evidence_ref, data->bp);
+
+        return NULL;
+}
+
+static
+void * batchBreakProbabilities_thread(void* data_)
+{
+        pthread_data_t *data = (pthread_data_t *)data_;
+        batch_t *batch = (batch_t *)data->result;
+        stats_timer_t timer;
+
+        statsStart(&timer, &batch->bd);
+        computeBreakProbabilities(batch->result->bprob, batch->evidence_ref, &batch->bd);
+        statsStop(&timer, STATS_BPROB, &batch->bd);
+
+        return NULL;
+}
+
+/* Group consecutive data sets that share the length and the prior. */
+static
+void batchLanes(batch_t *batch, int n)
+{
+        int i, j;
+
+        for (i = 0; i < n; i = j) {
+                for (j = i+1; j < n && j-i < PROMBS_LANES && !batch[i].bd.options->hmm; j++) {
+                        if (batch[j].bd.L != batch[i].bd.L || batch[j].bd.beta != batch[i].bd.beta) {
+                                break;
+                        }
+                        batch[j].lanes = 0;
+                }
+                batch[i].lanes = j-i;
+        }
+}
+
+static
+size_t batchJob(job_t *job, void *result, batch_t *batch, size_t tasks, void *(*f_thread)(void*),
+                const char *name)
+{
+        job->result       = result;
+        job->evidence_ref = batch->evidence_ref;
+        job->bd           = &batch->bd;
+        job->tasks        = tasks;
+        job->f_thread     = f_thread;
+        job->name         = name;
+
+        return 1;
+}
+
+/* Entries of alpha, beta and gamma that are NULL are replaced by the
+ * prior of the first data set. Consecutive data sets with the same
+ * length and beta share a single run of the binning algorithm. */
+marginal_t **
+posteriorBatch(
+        int n,
+        int events,
+        matrix_t ***counts,
+        matrix_t ***alpha,
+        vector_t  **beta,
+        matrix_t  **gamma,
+        options_t *options)
+{
+        marginal_t **result = (marginal_t **)malloc(n*sizeof(marginal_t *));
+        batch_t *batch;
+        job_t *jobs;
+        stats_collector_t stats;
+        stats_t *total;
+        size_t L;
+        int i, k, m;
+
+#define PRIOR(x, i) ((x)[i] != NULL ? (x)[i] : (x)[0])
+        /* priors of other data sets must have the same length */
+        for (i = 0; i < n; i++) {
+                L = counts[i][0]->columns;
+                if (PRIOR(beta, i)->size != L ||
+                    PRIOR(gamma, i)->rows != L || PRIOR(gamma, i)->columns != L) {
+                        std_err(NONE, "Prior of data set %d has wrong dimension.", i);
+                }
+                for (k = 0; k < events; k++) {
+                        if (PRIOR(alpha, i)[k]->rows != L || PRIOR(alpha, i)[k]->columns != L) {
+                                std_err(NONE, "Prior of data set %d has wrong dimension.", i);
+                        }
+                }
+        }
+        /* the multibin sampler has a global state */
+        if (options->algorithm != 0) {
+                for (i = 0; i < n; i++) {
+                        result[i] = posterior(events, counts[i], PRIOR(alpha, i), PRIOR(beta, i),
+                                              PRIOR(gamma, i), options);
+                }
+                return result;
+        }
+        batch = (batch_t *)malloc(n*sizeof(batch_t));
+        jobs  = (job_t   *)malloc(2*n*sizeof(job_t));
+
+        for (i = 0; i < n; i++) {
+                L = counts[i][0]->columns;
+                batch[i].result = allocMarginal(L, events, options);
+                bin_init(events, counts[i], PRIOR(alpha, i), PRIOR(beta, i), PRIOR(gamma, i),
+                         options, &batch[i].bd);
+        }
+#undef PRIOR
+        /* all data sets share a single collector */
+        total = n > 0 ? allocStats(&stats, &batch[0].bd) : NULL;
+        for (i = 1; i < n; i++) {
+                batch[i].bd.stats = batch[0].bd.stats;
+        }
+        /* compute evidences and model posteriors */
+        batchLanes(batch, n);
+        for (i = 0, m = 0; i < n; i++) {
+                if (batch[i].lanes == 0) {
+                        continue;
+                }
+                jobs[m].result   = (void *)&batch[i];
+                jobs[m].bd       = &batch[i].bd;
+                jobs[m].tasks    = 1;
+                jobs[m].f_thread = batchEvidence_thread;
+                jobs[m].name     = "evidence";
+                m++;
+        }
+        threaded_jobs(jobs, m, options, "evidence", "Computing evidences: %.1f%%");
+
+        /* compute densities, moments and break probabilities of all
+         * data sets at once, the mixture and the break probabilities of
+         * a data set are each computed by a single task */
+        for (i = 0, m = 0; i < n; i++) {
+                if (options->hmm) {
+                        continue;
+                }
+                if (options->density || options->n_moments > 0 || options->coverage ||
+                    options->n_levels > 0) {
+                        m += batchJob(&jobs[m], &batch[i], &batch[i], 1, batchMixture_thread, "mixture");
+                }
+                if (options->bprob) {
+                        m += batchJob(&jobs[m], &batch[i], &batch[i], 1, batchBreakProbabilities_thread, "bprob");
+                }
+        }
+        threaded_jobs(jobs, m, options, "posterior", "Computing posteriors: %.1f%%");
+
+        for (i = 0; i < n; i++) {
+                result[i] = batch[i].result;
+                bin_free(&batch[i].bd);
+        }
+        /* every data set reports the statistics of the whole batch */
+        if (total) {
+                statsFinish(&stats);
+                for (i = 0; i < n; i++) {
+                        result[i]->stats  = (stats_t *)malloc(sizeof(stats_t));
+                        *result[i]->stats = *total;
+                }
+                free(total);
+        }
+        free(batch);
+        free(jobs);
+
+        return result;
+}
+
 /*
  * Compute the expected utility N steps ahead
  */
@@ -254,28 +743,228 @@ utility(
         matrix_t  *gamma,
         options_t *options)
 {
+        /* the utility is only implemented for prombs */
+        options_t exact = *options;
+        exact.algorithm = 0;
+
         binData bd;
-        bin_init(events, counts, alpha, beta, gamma, options, &bd);
+        stats_collector_t stats;
+        stats_timer_t timer;
+        bin_init(events, counts, alpha, beta, gamma, &exact, &bd);
+
+        utility_t *result   = (utility_t *)malloc(sizeof(utility_t));
+        result->expectation = alloc_matrix(events, bd.L);
+        result->utility     = alloc_vector(bd.L);
+        result->complete    = NULL;
+        result->batch       = NULL;
+        result->stats       = allocStats(&stats, &bd);
+
         binProblem bp; binProblemInit(&bp, &bd);
 
+        if (options->hmm) {
+                prob_t forward [bd.L];
+                prob_t backward[bd.L];
+
+                statsStart(&timer, &bd);
+                hmm_forward (forward,  &bp);
+                hmm_backward(backward, &bp);
+                statsStop(&timer, STATS_EVIDENCE, &bd);
+                statsStart(&timer, &bd);
+                hmm_computeUtility(result, forward, backward, &bp);
+                statsStop(&timer, STATS_UTILITY, &bd);
+        }
+        else {
+                prob_t evidence_log_tmp[bd.L];
+                statsStart(&timer, &bd);
+                prob_t evidence_ref = evidence(evidence_log_tmp, &bp);
+                statsStop(&timer, STATS_EVIDENCE, &bd);
+
+                statsStart(&timer, &bd);
+                computeUtility(result, evidence_ref, &bd);
+                statsStop(&timer, STATS_UTILITY, &bd);
+        }
+        binProblemFree(&bp);
+        statsFinish(bd.stats);
+        bin_free(&bd);
+
+        return result;
+}
+
+/*
+ * Compute the expected utility within a wall-clock budget given in
+ * seconds, positions are evaluated in the order of decreasing priority
+ * (e.g. the utility of the previous trial). Positions that were not
+ * evaluated before the deadline have zero in the completeness mask and
+ * utility -inf.
+ */
+utility_t*
+utilityDeadline(
+        double budget,
+        vector_t  *priority,
+        int events,
+        matrix_t **counts,
+        matrix_t **alpha,
+        vector_t  *beta,
+        matrix_t  *gamma,
+        options_t *options)
+{
+        schedule_t schedule;
+        schedule.deadline = walltime() + budget;
+        schedule.cancel   = 0;
+
+        /* the utility is only implemented for prombs */
+        options_t exact = *options;
+        exact.algorithm = 0;
+
+        binData bd;
+        stats_collector_t stats;
+        stats_timer_t timer;
+        bin_init(events, counts, alpha, beta, gamma, &exact, &bd);
+
         utility_t *result   = (utility_t *)malloc(sizeof(utility_t));
-        result->expectation = alloc_matrix(events, bp.bd->L);
-        result->utility     = alloc_vector(bp.bd->L);
+        result->expectation = alloc_matrix(events, bd.L);
+        result->utility     = alloc_vector(bd.L);
+        result->complete    = alloc_vector(bd.L);
+        result->batch       = NULL;
+        result->stats       = allocStats(&stats, &bd);
+
+        binProblem bp; binProblemInit(&bp, &bd);
+
+        size_t order[bd.L];
+        int complete[bd.L];
+        size_t i, j;
 
         if (options->hmm) {
+                /* a single forward-backward sweep per event gives the
+                 * utility at all positions */
                 prob_t forward [bd.L];
                 prob_t backward[bd.L];
 
+                statsStart(&timer, &bd);
                 hmm_forward (forward,  &bp);
                 hmm_backward(backward, &bp);
+                statsStop(&timer, STATS_EVIDENCE, &bd);
+                statsStart(&timer, &bd);
                 hmm_computeUtility(result, forward, backward, &bp);
+                statsStop(&timer, STATS_UTILITY, &bd);
+                for (i = 0; i < bd.L; i++) {
+                        complete[i] = 1;
+                }
         }
         else {
                 prob_t evidence_log_tmp[bd.L];
+                statsStart(&timer, &bd);
                 prob_t evidence_ref = evidence(evidence_log_tmp, &bp);
+                statsStop(&timer, STATS_EVIDENCE, &bd);
 
+                computeOrder(order, priority, bd.L);
+                for (i = 0; i < bd.L; i++) {
+                        complete[i] = 0;
+                }
+                schedule.order    = order;
+                schedule.complete = complete;
+                bd.schedule       = &schedule;
+                statsStart(&timer, &bd);
                 computeUtility(result, evidence_ref, &bd);
+                statsStop(&timer, STATS_UTILITY, &bd);
+                bd.schedule       = NULL;
+        }
+        for (i = 0; i < bd.L; i++) {
+                result->complete->content[i] = complete[i];
+                if (!complete[i]) {
+                        result->utility->content[i] = -HUGE_VAL;
+                        for (j = 0; j < (size_t)events; j++) {
+                                result->expectation->content[j][i] = 0.0;
+                        }
+                }
         }
+        binProblemFree(&bp);
+        statsFinish(bd.stats);
+        bin_free(&bd);
+
+        return result;
+}
+
+/*
+ * Select a batch of q positions that are sampled next, the
+ * expected utility and the bin coverage are computed only once. The
+ * positions are returned in the batch field of the result. The
+ * utility is only implemented for prombs, which is therefore also
+ * used for the coverage if the multibin Gibbs sampler is selected.
+ */
+utility_t*
+utilityBatch(
+        int q,
+        int events,
+        matrix_t **counts,
+        matrix_t **alpha,
+        vector_t  *beta,
+        matrix_t  *gamma,
+        options_t *options)
+{
+        if (q <= 0) {
+                warn(NONE, "Batch size must be positive.");
+                return NULL;
+        }
+        options_t exact = *options;
+        exact.algorithm = 0;
+
+        binData bd;
+        stats_collector_t stats;
+        stats_timer_t timer;
+        bin_init(events, counts, alpha, beta, gamma, &exact, &bd);
+
+        utility_t *result   = (utility_t *)malloc(sizeof(utility_t));
+        result->expectation = alloc_matrix(events, bd.L);
+        result->utility     = alloc_vector(bd.L);
+        result->complete    = NULL;
+        result->batch       = alloc_vector((size_t)q < bd.L ? (size_t)q : bd.L);
+        result->stats       = allocStats(&stats, &bd);
+
+        binProblem bp; binProblemInit(&bp, &bd);
+
+        matrix_t *coverage = alloc_matrix(bd.L, bd.L);
+        matrix_t *samebin  = alloc_matrix(bd.L, bd.L);
+
+        if (options->hmm) {
+                prob_t forward [bd.L];
+                prob_t backward[bd.L];
+
+                statsStart(&timer, &bd);
+                hmm_forward (forward,  &bp);
+                hmm_backward(backward, &bp);
+                statsStop(&timer, STATS_EVIDENCE, &bd);
+                statsStart(&timer, &bd);
+                hmm_computeUtility(result, forward, backward, &bp);
+                statsStop(&timer, STATS_UTILITY, &bd);
+                statsStart(&timer, &bd);
+                hmm_computeBinCoverage(coverage, forward, backward, &bp);
+                statsStop(&timer, STATS_COVERAGE, &bd);
+        }
+        else {
+                prob_t evidence_log_tmp[bd.L];
+                statsStart(&timer, &bd);
+                prob_t evidence_ref = evidence(evidence_log_tmp, &bp);
+                statsStop(&timer, STATS_EVIDENCE, &bd);
+
+                statsStart(&timer, &bd);
+                computeUtility(result, evidence_ref, &bd);
+                statsStop(&timer, STATS_UTILITY, &bd);
+                /* the coverage is not needed if the utility was
+                 * interrupted */
+                if (!interruptPending()) {
+                        statsStart(&timer, &bd);
+                        computeBinCoverage(coverage, evidence_ref, &bd);
+                        statsStop(&timer, STATS_COVERAGE, &bd);
+                }
+        }
+        computeSameBin(samebin, coverage);
+        computeBatch(result->batch, result->utility, samebin);
+
+        free_matrix(coverage);
+        free_matrix(samebin);
+        binProblemFree(&bp);
+        statsFinish(bd.stats);
         bin_free(&bd);
 
         return result;
@@ -318,6 +1007,36 @@ utilityAt(
         return result;
 }
 
+/*
+ * Compute for each position the value of the best sampling path of
+ * the given length that starts at this position (path iteration)
+ */
+vector_t*
+utilityPath(
+        int length,
+        int events,
+        matrix_t **counts,
+        matrix_t **alpha,
+        vector_t  *beta,
+        matrix_t  *gamma,
+        options_t *options)
+{
+        binData bd;
+        bin_init(events, counts, alpha, beta, gamma, options, &bd);
+
+        vector_t *result = alloc_vector(bd.L);
+
+        if (options->hmm) {
+                hmm_computePathUtility(result, length, &bd);
+        }
+        else {
+                warn(NONE, "This function is only implemented the hidden Markov model.");
+        }
+        bin_free(&bd);
+
+        return result;
+}
+
 /*
  * Compute the Kullback-Leibler distance between the distribution
  * given by the counts and the one by adding the event (x,y)
@@ -354,3 +1073,375 @@ distance(
 
         return result;
 }
+
+/*
+ * Simulate replicates of a sampling experiment with the given ground
+ * truth, lapsing probability and strategy
+ */
+simulation_t*
+simulate(
+        int replicates,
+        int trials,
+        vector_t  *gt,
+        double lapsing,
+        int strategy,
+        unsigned long seed,
+        int events,
+        matrix_t **alpha,
+        vector_t  *beta,
+        matrix_t  *gamma,
+        options_t *options)
+{
+        simulation_t *result = (simulation_t *)malloc(sizeof(simulation_t));
+        result->stimulus     = alloc_matrix(replicates, trials);
+        result->event        = alloc_matrix(replicates, trials);
+        result->kl           = alloc_matrix(replicates, trials);
+        result->mean         = alloc_matrix(replicates, trials);
+        result->variance     = alloc_matrix(replicates, trials);
+
+        if (events != 2) {
+                warn(NONE, "The simulator requires exactly two events.");
+        }
+        else {
+                runSimulation(result, replicates, trials, gt, lapsing, strategy, seed,
+                              events, alpha, beta, gamma, options);
+        }
+
+        return result;
+}
+
+/******************************************************************************
+ * Library entry points for matrix views
+ ******************************************************************************/
+
+static
+void matricesFromViews(matrix_t **to, matrix_view_t **from, int n)
+{
+        int i;
+
+        for (i = 0; i < n; i++) {
+                to[i] = matrix_from_view(from[i]);
+        }
+}
+
+static
+void freeMatricesFromViews(matrix_t **m, matrix_view_t **from, int n)
+{
+        int i;
+
+        for (i = 0; i < n; i++) {
+                free_matrix_from_view(m[i], from[i]);
+        }
+}
+
+marginal_t *
+posteriorView(
+        int events,
+        matrix_view_t **counts,
+        matrix_view_t **alpha,
+        vector_t       *beta,
+        matrix_view_t  *gamma,
+        options_t *options)
+{
+        matrix_t *c[events], *a[events], *g = matrix_from_view(gamma);
+        marginal_t *result;
+
+        matricesFromViews(c, counts, events);
+        matricesFromViews(a, alpha,  events);
+        result = posterior(events, c, a, beta, g, options);
+        freeMatricesFromViews(c, counts, events);
+        freeMatricesFromViews(a, alpha,  events);
+        free_matrix_from_view(g, gamma);
+
+        return result;
+}
+
+marginal_t **
+posteriorBatchView(
+        int n,
+        int events,
+        matrix_view_t ***counts,
+        matrix_view_t ***alpha,
+        vector_t       **beta,
+        matrix_view_t  **gamma,
+        options_t *options)
+{
+        matrix_t *c[n][events], *a[n][events], *g[n];
+        matrix_t **cp[n], **ap[n];
+        marginal_t **result;
+        int i;
+
+        for (i = 0; i < n; i++) {
+                matricesFromViews(c[i], counts[i], events);
+                cp[i] = c[i];
+                ap[i] = NULL;
+                g [i] = NULL;
+                if (alpha[i] != NULL) {
+                        matricesFromViews(a[i], alpha[i], events);
+                        ap[i] = a[i];
+                }
+                if (gamma[i] != NULL) {
+                        g[i] = matrix_from_view(gamma[i]);
+                }
+        }
+        result = posteriorBatch(n, events, cp, ap, beta, g, options);
+        for (i = 0; i < n; i++) {
+                freeMatricesFromViews(c[i], counts[i], events);
+                if (alpha[i] != NULL) {
+                        freeMatricesFromViews(a[i], alpha[i], events);
+                }
+                if (gamma[i] != NULL) {
+                        free_matrix_from_view(g[i], gamma[i]);
+                }
+        }
+        return result;
+}
+
+utility_t*
+utilityView(
+        int events,
+        matrix_view_t **counts,
+        matrix_view_t **alpha,
+        vector_t       *beta,
+        matrix_view_t  *gamma,
+        options_t *options)
+{
+        matrix_t *c[events], *a[events], *g = matrix_from_view(gamma);
+        utility_t *result;
+
+        matricesFromViews(c, counts, events);
+        matricesFromViews(a, alpha,  events);
+        result = utility(events, c, a, beta, g, options);
+        freeMatricesFromViews(c, counts, events);
+        freeMatricesFromViews(a, alpha,  events);
+        free_matrix_from_view(g, gamma);
+
+        return result;
+}
+
+utility_t*
+utilityDeadlineView(
+        double budget,
+        vector_t       *priority,
+        int events,
+        matrix_view_t **counts,
+        matrix_view_t **alpha,
+        vector_t       *beta,
+        matrix_view_t  *gamma,
+        options_t *options)
+{
+        matrix_t *c[events], *a[events], *g = matrix_from_view(gamma);
+        utility_t *result;
+
+        matricesFromViews(c, counts, events);
+        matricesFromViews(a, alpha,  events);
+        result = utilityDeadline(budget, priority, events, c, a, beta, g, options);
+        freeMatricesFromViews(c, counts, events);
+        freeMatricesFromViews(a, alpha,  events);
+        free_matrix_from_view(g, gamma);
+
+        return result;
+}
+
+utility_t*
+utilityBatchView(
+        int q,
+        int events,
+        matrix_view_t **counts,
+        matrix_view_t **alpha,
+        vector_t       *beta,
+        matrix_view_t  *gamma,
+        options_t *options)
+{
+        matrix_t *c[events], *a[events], *g = matrix_from_view(gamma);
+        utility_t *result;
+
+        matricesFromViews(c, counts, events);
+        matricesFromViews(a, alpha,  events);
+        result = utilityBatch(q, events, c, a, beta, g, options);
+        freeMatricesFromViews(c, counts, events);
+        freeMatricesFromViews(a, alpha,  events);
+        free_matrix_from_view(g, gamma);
+
+        return result;
+}
+
+vector_t*
+utilityAtView(
+        int pos,
+        int events,
+        matrix_view_t **counts,
+        matrix_view_t **alpha,
+        vector_t       *beta,
+        matrix_view_t  *gamma,
+        options_t *options)
+{
+        matrix_t *c[events], *a[events], *g = matrix_from_view(gamma);
+        vector_t *result;
+
+        matricesFromViews(c, counts, events);
+        matricesFromViews(a, alpha,  events);
+        result = utilityAt(pos, events, c, a, beta, g, options);
+        freeMatricesFromViews(c, counts, events);
+        freeMatricesFromViews(a, alpha,  events);
+        free_matrix_from_view(g, gamma);
+
+        return result;
+}
+
+vector_t*
+utilityPathView(
+        int length,
+        int events,
+        matrix_view_t **counts,
+        matrix_view_t **alpha,
+        vector_t       *beta,
+        matrix_view_t  *gamma,
+        options_t *options)
+{
+        matrix_t *c[events], *a[events], *g = matrix_from_view(gamma);
+        vector_t *result;
+
+        matricesFromViews(c, counts, events);
+        matricesFromViews(a, alpha,  events);
+        result = utilityPath(length, events, c, a, beta, g, options);
+        freeMatricesFromViews(c, counts, events);
+        freeMatricesFromViews(a, alpha,  events);
+        free_matrix_from_view(g, gamma);
+
+        return result;
+}
+
+double
+distanceView(
+        int x,
+        int y,
+        int events,
+        matrix_view_t **counts,
+        matrix_view_t **alpha,
+        vector_t       *beta,
+        matrix_view_t  *gamma,
+        options_t *options)
+{
+        matrix_t *c[events], *a[events], *g = matrix_from_view(gamma);
+        double result;
+
+        matricesFromViews(c, counts, events);
+        matricesFromViews(a, alpha,  events);
+        result = distance(x, y, events, c, a, beta, g, options);
+        freeMatricesFromViews(c, counts, events);
+        freeMatricesFromViews(a, alpha,  events);
+        free_matrix_from_view(g, gamma);
+
+        return result;
+}
+
+simulation_t*
+simulateView(
+        int replicates,
+        int trials,
+        vector_t       *gt,
+        double lapsing,
+        int strategy,
+        unsigned long seed,
+        int events,
+        matrix_view_t **alpha,
+        vector_t       *beta,
+        matrix_view_t  *gamma,
+        options_t *options)
+{
+        matrix_t *a[events], *g = matrix_from_view(gamma);
+        simulation_t *result;
+
+        matricesFromViews(a, alpha, events);
+        result = simulate(replicates, trials, gt, lapsing, strategy, seed,
+                          events, a, beta, g, options);
+        freeMatricesFromViews(a, alpha, events);
+        free_matrix_from_view(g, gamma);
+
+        return result;
+}
+
+/******************************************************************************
+ * Library entry points for count statistics
+ ******************************************************************************/
+
+/*
+ * Count statistic of a KxL matrix of events, the result contains an
+ * LxL matrix for each of the K events
+ */
+matrix_t **
+countsFromEvents(matrix_view_t *events)
+{
+        matrix_t **result = (matrix_t **)malloc(events->rows*sizeof(matrix_t *));
+        int k;
+
+        for (k = 0; k < events->rows; k++) {
+                result[k] = alloc_matrix(events->columns, events->columns);
+        }
+        computeCountStatistic(result, events);
+
+        return result;
+}
+
+/*
+ * Count statistic of the spike timings of several trials, which are
+ * concatenated, for bins of size binsize in the range [from, to]. The
+ * result contains the statistics of successes and failures, or NULL
+ * if a bin has more spikes than trials.
+ */
+matrix_t **
+countsFromTimings(
+        int trials,
+        vector_t *timings,
+        double binsize,
+        double from,
+        double to)
+{
+        matrix_t **result = (matrix_t **)malloc(2*sizeof(matrix_t *));
+        size_t L = timingsPositions(binsize, from, to);
+        int skipped;
+
+        result[0] = alloc_matrix(L, L);
+        result[1] = alloc_matrix(L, L);
+
+        skipped = computeTimingCounts(result, trials, timings, binsize, from, to);
+        if (skipped == -1) {
+                warn(NONE, "Number of trials is smaller than some counts.");
+                free_matrix(result[0]);
+                free_matrix(result[1]);
+                free(result);
+                return NULL;
+        }
+        if (skipped > 0) {
+                warn(NONE, "Skipped %d spikes outside of the range.", skipped);
+        }
+
+        return result;
+}
+
+/*
+ * Count statistic of the `counts' option of a [Counts] section or
+ * the `timings' option of a [Trials] section of a configuration file,
+ * which is streamed from the file without storing the values. The
+ * number of events is saved in events, for [Trials] the range of the
+ * spike timings is saved in range (may be NULL). Returns NULL if the
+ * section can't be read.
+ */
+matrix_t **
+countsFromConfig(
+        const char *filename,
+        const char *section,
+        int *events,
+        double *range)
+{
+        if (strcmp(section, "Counts") == 0) {
+                return readConfigCounts(filename, events);
+        }
+        if (strcmp(section, "Trials") == 0) {
+                *events = 2;
+                return readConfigTimings(filename, range);
+        }
+        warn(NONE, "Invalid section `%s'.", section);
+        return NULL;
+}
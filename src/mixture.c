@@ -0,0 +1,473 @@
+/* Copyright (C) 2012 Philipp Benner
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <gsl/gsl_sf_gamma.h>
+
+#include <adaptive-sampling/exception.h>
+#include <adaptive-sampling/logarithmetic.h>
+#include <adaptive-sampling/datatypes.h>
+
+#include <bin-coverage.h>
+#include <datatypes.h>
+#include <mixture.h>
+
+/******************************************************************************
+ * Beta mixtures
+ ******************************************************************************/
+
+typedef struct {
+        prob_t weight;
+        prob_t a;
+        prob_t b;
+} component_t;
+
+static
+int component_cmp(const void *a, const void *b)
+{
+        const component_t *ca = (const component_t *)a;
+        const component_t *cb = (const component_t *)b;
+
+        if (ca->weight != cb->weight) {
+                return ca->weight < cb->weight ? 1 : -1;
+        }
+        return 0;
+}
+
+/* Collect the components of all bins [i,j] that cover position x. The
+ * lightest components are dropped as long as their total weight does
+ * not exceed the tolerance. Components that are lighter than the
+ * tolerance divided by the number of bins are dropped right away. */
+void mixtureInit(
+        beta_mixture_t *mixture,
+        size_t x,
+        matrix_t *coverage,
+        prob_t tolerance,
+        binProblem *bp)
+{
+        size_t L = bp->bd->L;
+        size_t i, j, n = 0;
+        prob_t dropped = 0.0, light = tolerance/((x+1)*(L-x));
+        component_t *tmp = (component_t *)malloc((x+1)*(L-x)*sizeof(component_t));
+
+        for (i = 0; i <= x; i++) {
+                for (j = x; j < L; j++) {
+                        if (coverage->content[i][j] <= light) {
+                                dropped += coverage->content[i][j];
+                        }
+                        else {
+                                tmp[n].weight = coverage->content[i][j];
+                                binParameters(&tmp[n].a, &tmp[n].b, i, j, bp);
+                                n++;
+                        }
+                }
+        }
+        qsort(tmp, n, sizeof(component_t), component_cmp);
+        while (n > 1 && dropped + tmp[n-1].weight <= tolerance) {
+                dropped += tmp[--n].weight;
+        }
+        mixture->n      = n;
+        mixture->mass   = 0.0;
+        mixture->weight = (prob_t *)malloc(n*sizeof(prob_t));
+        mixture->lnw    = (prob_t *)malloc(n*sizeof(prob_t));
+        mixture->a      = (prob_t *)malloc(n*sizeof(prob_t));
+        mixture->b      = (prob_t *)malloc(n*sizeof(prob_t));
+        for (i = 0; i < n; i++) {
+                mixture->weight[i] = tmp[i].weight;
+                mixture->a[i]      = tmp[i].a;
+                mixture->b[i]      = tmp[i].b;
+                mixture->lnw[i]    = LOG(tmp[i].weight) + gsl_sf_lngamma(tmp[i].a + tmp[i].b)
+                        - gsl_sf_lngamma(tmp[i].a) - gsl_sf_lngamma(tmp[i].b);
+                mixture->mass     += tmp[i].weight;
+        }
+        bp->counter.lngamma_calls += 3*n;
+        free(tmp);
+}
+
+void mixtureFree(beta_mixture_t *mixture)
+{
+        free(mixture->weight);
+        free(mixture->lnw);
+        free(mixture->a);
+        free(mixture->b);
+}
+
+/* the density is zero at the boundaries as for the full grid */
+prob_t mixtureDensity(beta_mixture_t *mixture, prob_t p)
+{
+        prob_t log_p, log_q, result = 0.0;
+        size_t i;
+
+        if (p <= 0.0 || p >= 1.0) {
+                return 0.0;
+        }
+        log_p = LOG(p);
+        log_q = LOG(1.0-p);
+        for (i = 0; i < mixture->n; i++) {
+                result += EXP(mixture->lnw[i] + (mixture->a[i]-1)*log_p + (mixture->b[i]-1)*log_q);
+        }
+        return result;
+}
+
+static
+void mixtureMoments(beta_mixture_t *mixture, prob_t *mean, prob_t *sd)
+{
+        prob_t a, c, m1 = 0.0, m2 = 0.0;
+        size_t i;
+
+        for (i = 0; i < mixture->n; i++) {
+                a   = mixture->a[i];
+                c   = mixture->a[i] + mixture->b[i];
+                m1 += mixture->weight[i]*a/c;
+                m2 += mixture->weight[i]*a*(a+1)/(c*(c+1));
+        }
+        if (mixture->mass <= 0.0) {
+                *mean = 0.0;
+                *sd   = 0.0;
+                return;
+        }
+        *mean = m1/mixture->mass;
+        *sd   = sqrt(fmax(m2/mixture->mass - (*mean)*(*mean), 0.0));
+}
+
+/******************************************************************************
+ * Adaptive density
+ ******************************************************************************/
+
+/* rows of position, p and density */
+typedef struct {
+        size_t n;
+        size_t size;
+        double *content;
+} points_t;
+
+static
+void points_add(points_t *points, size_t x, prob_t p, prob_t f)
+{
+        if (points->n == points->size) {
+                points->size    = points->size == 0 ? 1024 : 2*points->size;
+                points->content = (double *)realloc(points->content, 3*points->size*sizeof(double));
+        }
+        points->content[3*points->n+0] = x;
+        points->content[3*points->n+1] = p;
+        points->content[3*points->n+2] = f;
+        points->n++;
+}
+
+/* Bisect [l,r] until the linear interpolation at the midpoint is
+ * within the accuracy or the interval is not larger than the density
+ * step. All points in (l,r] are added in increasing order. */
+static
+void refine(
+        points_t *points,
+        size_t x,
+        beta_mixture_t *mixture,
+        prob_t l, prob_t fl,
+        prob_t r, prob_t fr,
+        prob_t accuracy,
+        prob_t step)
+{
+        prob_t m = (l+r)/2.0, fm;
+
+        if (r-l > step) {
+                fm = mixtureDensity(mixture, m);
+                if (FABS(fm - (fl+fr)/2.0) > accuracy) {
+                        refine(points, x, mixture, l, fl, m, fm, accuracy, step);
+                        refine(points, x, mixture, m, fm, r, fr, accuracy, step);
+                        return;
+                }
+        }
+        points_add(points, x, r, fr);
+}
+
+static
+int prob_cmp(const void *a, const void *b)
+{
+        const prob_t *pa = (const prob_t *)a;
+        const prob_t *pb = (const prob_t *)b;
+
+        return *pa < *pb ? -1 : (*pa > *pb);
+}
+
+#define ADAPTIVE_GRID 8
+#define ADAPTIVE_SEEDS (ADAPTIVE_GRID+8)
+
+/* The density range is split at a coarse grid and at the mean and
+ * up to three standard deviations around it, so that narrow peaks
+ * are not missed. */
+static
+void adaptiveDensityAt(points_t *points, size_t x, beta_mixture_t *mixture, prob_t accuracy, options_t *options)
+{
+        prob_t from = options->density_range.from;
+        prob_t to   = options->density_range.to;
+        prob_t seeds[ADAPTIVE_SEEDS], mean, sd, f_prev, f;
+        size_t i, n = 0;
+
+        mixtureMoments(mixture, &mean, &sd);
+        for (i = 0; i <= ADAPTIVE_GRID; i++) {
+                seeds[n++] = from + i*(to-from)/ADAPTIVE_GRID;
+        }
+        for (i = 1; i <= 3; i++) {
+                if (from < mean-i*sd) {
+                        seeds[n++] = mean-i*sd;
+                }
+                if (mean+i*sd < to) {
+                        seeds[n++] = mean+i*sd;
+                }
+        }
+        if (from < mean && mean < to) {
+                seeds[n++] = mean;
+        }
+        qsort(seeds, n, sizeof(prob_t), prob_cmp);
+
+        f_prev = mixtureDensity(mixture, seeds[0]);
+        points_add(points, x, seeds[0], f_prev);
+        for (i = 1; i < n; i++) {
+                if (seeds[i] == seeds[i-1]) {
+                        continue;
+                }
+                f = mixtureDensity(mixture, seeds[i]);
+                refine(points, x, mixture, seeds[i-1], f_prev, seeds[i], f, accuracy, options->density_step);
+                f_prev = f;
+        }
+}
+
+/* Linear interpolation of the adaptive density of position x on the
+ * full grid, which is used for plotting. */
+static
+void resampleDensity(matrix_t *density, size_t x, const double *points, size_t n, options_t *options)
+{
+        size_t g, k = 0;
+        prob_t p;
+
+        for (g = 0; g < density->columns; g++) {
+                p = g*options->density_step;
+                density->content[x][g] = 0.0;
+                if (options->density_range.from > p || options->density_range.to < p ||
+                    p == 0.0 || p == 1.0 || n == 0) {
+                        continue;
+                }
+                while (k+1 < n && points[3*(k+1)+1] < p) {
+                        k++;
+                }
+                if (k+1 == n || p <= points[3*k+1]) {
+                        density->content[x][g] = points[3*k+2];
+                }
+                else {
+                        density->content[x][g] = points[3*k+2] + (p - points[3*k+1])
+                                *(points[3*(k+1)+2] - points[3*k+2])/(points[3*(k+1)+1] - points[3*k+1]);
+                }
+        }
+}
+
+/* The density is evaluated only where it is needed to reach the
+ * requested accuracy, which bounds the L1 error of the linear
+ * interpolation. Half of the accuracy is spent on dropping light
+ * mixture components, the other half on the interpolation. The
+ * evaluated points are returned as rows of position, p and density,
+ * the full grid is filled by interpolation. */
+void computeAdaptiveDensity(
+        marginal_t *result,
+        matrix_t *coverage,
+        binProblem *bp)
+{
+        options_t *options = bp->bd->options;
+        prob_t accuracy = options->density_accuracy/2.0;
+        prob_t range    = options->density_range.to - options->density_range.from;
+        beta_mixture_t mixture;
+        points_t points = { 0, 0, NULL };
+        size_t x, first;
+
+        for (x = 0; x < bp->bd->L; x++) {
+                first = points.n;
+                mixtureInit(&mixture, x, coverage, accuracy, bp);
+                adaptiveDensityAt(&points, x, &mixture, range > 0.0 ? accuracy/range : accuracy, options);
+                mixtureFree(&mixture);
+                resampleDensity(result->density, x, points.content+3*first, points.n-first, options);
+        }
+        result->density_points = alloc_matrix(points.n, 3);
+        for (x = 0; x < points.n; x++) {
+                result->density_points->content[x][0] = points.content[3*x+0];
+                result->density_points->content[x][1] = points.content[3*x+1];
+                result->density_points->content[x][2] = points.content[3*x+2];
+        }
+        free(points.content);
+}
+
+/******************************************************************************
+ * Quantiles and highest density intervals
+ ******************************************************************************/
+
+#define QUANTILE_TOLERANCE 1e-10
+#define QUANTILE_MAX_ITER  200
+#define BETA_CF_TOLERANCE  1e-15
+
+/* continued fraction of the incomplete beta function, evaluated by
+ * the modified Lentz's method */
+static
+prob_t beta_cf(prob_t a, prob_t b, prob_t x)
+{
+        const prob_t tiny = 1e-300;
+        prob_t c = 1.0, d, h, aa, delta;
+        size_t m;
+
+        d = 1.0 - (a+b)*x/(a+1.0);
+        d = FABS(d) < tiny ? 1.0/tiny : 1.0/d;
+        h = d;
+        for (m = 1; m <= QUANTILE_MAX_ITER; m++) {
+                /* even step */
+                aa = m*(b-m)*x/((a+2*m-1)*(a+2*m));
+                d  = 1.0 + aa*d;
+                c  = 1.0 + aa/c;
+                d  = FABS(d) < tiny ? 1.0/tiny : 1.0/d;
+                c  = FABS(c) < tiny ? tiny : c;
+                h *= d*c;
+                /* odd step */
+                aa = -(a+m)*(a+b+m)*x/((a+2*m)*(a+2*m+1));
+                d  = 1.0 + aa*d;
+                c  = 1.0 + aa/c;
+                d  = FABS(d) < tiny ? 1.0/tiny : 1.0/d;
+                c  = FABS(c) < tiny ? tiny : c;
+                delta = d*c;
+                h *= delta;
+                if (FABS(delta-1.0) < BETA_CF_TOLERANCE) {
+                        break;
+                }
+        }
+        return h;
+}
+
+/* The posterior CDF is a mixture of regularized incomplete beta
+ * functions I_p(a,b). */
+static
+prob_t mixtureCdf(beta_mixture_t *mixture, prob_t p)
+{
+        prob_t a, b, tmp, result = 0.0;
+        size_t i;
+
+        if (p <= 0.0) {
+                return 0.0;
+        }
+        if (p >= 1.0) {
+                return 1.0;
+        }
+        for (i = 0; i < mixture->n; i++) {
+                a   = mixture->a[i];
+                b   = mixture->b[i];
+                tmp = EXP(mixture->lnw[i] + a*LOG(p) + b*LOG(1.0-p));
+                if (p < (a+1.0)/(a+b+2.0)) {
+                        result += tmp*beta_cf(a, b, p)/a;
+                }
+                else {
+                        result += mixture->weight[i] - tmp*beta_cf(b, a, 1.0-p)/b;
+                }
+        }
+        return result/mixture->mass;
+}
+
+/* Newton's method safeguarded by bisection, p is the initial guess */
+static
+prob_t mixtureQuantile(beta_mixture_t *mixture, prob_t q, prob_t p)
+{
+        prob_t lo = 0.0, hi = 1.0, F, f, next;
+        size_t i;
+
+        for (i = 0; i < QUANTILE_MAX_ITER && hi-lo > QUANTILE_TOLERANCE; i++) {
+                F = mixtureCdf(mixture, p) - q;
+                if (F == 0.0) {
+                        break;
+                }
+                if (F < 0.0) {
+                        lo = p;
+                }
+                else {
+                        hi = p;
+                }
+                f    = mixtureDensity(mixture, p)/mixture->mass;
+                next = p - F/f;
+                if (!(lo < next && next < hi)) {
+                        next = (lo+hi)/2.0;
+                }
+                if (FABS(next-p) < QUANTILE_TOLERANCE) {
+                        return next;
+                }
+                p = next;
+        }
+        return p;
+}
+
+/* The highest density interval [Q(t), Q(t+level)] is the shortest
+ * interval with the given mass. For unimodal densities the density at
+ * both limits is equal, t is found by bisection. */
+static
+void mixtureHdi(beta_mixture_t *mixture, prob_t level, prob_t *lower, prob_t *upper)
+{
+        prob_t lo = 0.0, hi = 1.0-level, t;
+        prob_t l = 0.0, u = mixtureQuantile(mixture, level, 0.5);
+
+        while (hi-lo > QUANTILE_TOLERANCE) {
+                t = (lo+hi)/2.0;
+                l = mixtureQuantile(mixture, t, l);
+                u = mixtureQuantile(mixture, t+level, u);
+                if (mixtureDensity(mixture, l) < mixtureDensity(mixture, u)) {
+                        lo = t;
+                }
+                else {
+                        hi = t;
+                }
+        }
+        *lower = mixtureQuantile(mixture, lo, l);
+        *upper = mixtureQuantile(mixture, lo+level, u);
+}
+
+void computeQuantiles(
+        marginal_t *result,
+        matrix_t *coverage,
+        binProblem *bp)
+{
+        options_t *options = bp->bd->options;
+        beta_mixture_t mixture;
+        prob_t levels[options->n_levels], mean, sd, lower, upper;
+        size_t x;
+        int l;
+
+        for (l = 0; l < options->n_levels; l++) {
+                levels[l] = options->levels[l];
+                if (levels[l] < 0.0 || levels[l] > 1.0) {
+                        std_warn(NONE, "Invalid probability level `%f'.", (double)levels[l]);
+                        levels[l] = levels[l] < 0.0 ? 0.0 : 1.0;
+                }
+        }
+        for (x = 0; x < bp->bd->L; x++) {
+                mixtureInit(&mixture, x, coverage, QUANTILE_TOLERANCE, bp);
+                mixtureMoments(&mixture, &mean, &sd);
+                for (l = 0; l < options->n_levels; l++) {
+                        result->quantiles->content[l][x] = mixtureQuantile(&mixture, levels[l], mean);
+                        mixtureHdi(&mixture, levels[l], &lower, &upper);
+                        result->hdi->content[2*l  ][x] = lower;
+                        result->hdi->content[2*l+1][x] = upper;
+                }
+                mixtureFree(&mixture);
+        }
+}
@@ -0,0 +1,47 @@
+/* Copyright (C) 2012 Philipp Benner
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef MIXTURE_H
+#define MIXTURE_H
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <datatypes.h>
+
+/* The posterior of the success probability at a single position is a
+ * mixture of Beta distributions over all bins that cover it. */
+typedef struct {
+        size_t n;
+        /* P([i,j]|D) and its log divided by B(a,b) */
+        prob_t *weight;
+        prob_t *lnw;
+        prob_t *a;
+        prob_t *b;
+        /* weight of all components that were kept */
+        prob_t mass;
+} beta_mixture_t;
+
+void mixtureInit(beta_mixture_t *mixture, size_t x, matrix_t *coverage, prob_t tolerance, binProblem *bp);
+void mixtureFree(beta_mixture_t *mixture);
+prob_t mixtureDensity(beta_mixture_t *mixture, prob_t p);
+
+void computeAdaptiveDensity(marginal_t *result, matrix_t *coverage, binProblem *bp);
+void computeQuantiles(marginal_t *result, matrix_t *coverage, binProblem *bp);
+
+#endif /* MIXTURE_H */
@@ -37,6 +37,7 @@
 
 #include <datatypes.h>
 #include <model.h>
+#include <threading.h>
 #include <tools.h>
 
 #ifdef HAVE_LIB_PTHREAD
@@ -111,6 +112,7 @@ prob_t mbeta_log(prob_t *p, binProblem *bp)
 
         sum1 = 0;
         sum2 = 0;
+        bp->counter.lngamma_calls += bp->bd->events+1;
         for (i = 0; i < bp->bd->events; i++) {
                 sum1 += p[i];
                 sum2 += gsl_sf_lngamma(p[i]);
@@ -121,6 +123,28 @@ prob_t mbeta_log(prob_t *p, binProblem *bp)
 /*        return sum2 - hashed_lngamma(sum1); */
 }
 
+/* Marginal density of component `which' of a Dirichlet distribution
+ * with parameters p at val times the normalization constant of the
+ * Dirichlet distribution. The marginal is a Beta distribution, where
+ * all other components are merged into a single one, and the Gamma
+ * function of component `which' cancels. */
+prob_t mbeta_marginal_log(prob_t *p, prob_t val, size_t which, binProblem *bp)
+{
+        size_t i;
+        prob_t rest = 0, result = 0;
+
+        bp->counter.lngamma_calls += bp->bd->events;
+        for (i = 0; i < bp->bd->events; i++) {
+                if (i != which) {
+                        rest   += p[i];
+                        result += gsl_sf_lngamma(p[i]);
+                }
+        }
+        result -= gsl_sf_lngamma(rest);
+
+        return result + (p[which]-1)*LOG(val) + (rest-1)*LOG(1-val);
+}
+
 /* P(E|B) */
 prob_t iec_log(int kk, int k, binProblem *bp)
 {
@@ -128,6 +152,7 @@ prob_t iec_log(int kk, int k, binProblem *bp)
         prob_t c[bp->bd->events];
         prob_t alpha[bp->bd->events];
         prob_t gamma = bp->bd->gamma->content[kk][k];
+        bp->counter.evaluations++;
         if (gamma == 0) {
                 return -HUGE_VAL;
         }
@@ -136,18 +161,9 @@ prob_t iec_log(int kk, int k, binProblem *bp)
                 alpha[i] = countAlpha(i, kk, k, bp);
         }
         if (bp != NULL && kk <= bp->fix_prob.pos && bp->fix_prob.pos <= k) {
-                /* compute density
-                 * TODO: extend to multinomial case */
-                if (bp->fix_prob.which == 0) {
-                        return LOG(gamma) + (c[0]-1)*LOG(bp->fix_prob.val)
-                                + (c[1]-1)*LOG(1-bp->fix_prob.val)
-                                - mbeta_log(alpha, bp);
-                }
-                else {
-                        return LOG(gamma) + (c[0]-1)*LOG(1-bp->fix_prob.val)
-                                + (c[1]-1)*LOG(bp->fix_prob.val)
-                                - mbeta_log(alpha, bp);
-                }
+                /* compute density */
+                return LOG(gamma) + mbeta_marginal_log(c, bp->fix_prob.val, bp->fix_prob.which, bp)
+                        - mbeta_log(alpha, bp);
         }
         else {
                 return LOG(gamma) + (mbeta_log(c, bp) - mbeta_log(alpha, bp));
@@ -158,7 +174,6 @@ prob_t iec_log(int kk, int k, binProblem *bp)
  * Hidden Markov model
  ******************************************************************************/
 
-static
 prob_t hmm_hp(int from, int to, binProblem* bp)
 {
         size_t i;
@@ -166,6 +181,7 @@ prob_t hmm_hp(int from, int to, binProblem* bp)
         prob_t alpha[bp->bd->events];
         prob_t result = 0;
 
+        bp->counter.evaluations++;
         for (i = 0; i < bp->bd->events; i++) {
                 alpha[i] = countAlpha(i, from, from, bp); 
         }
@@ -238,14 +254,26 @@ prob_t hmm_fb_rec(prob_t *forward, prob_t *backward, size_t j, prob_t (*f)(int,
         return tmp;
 }
 
+/* positions that are skipped after a cancellation are set to zero
+ * probability */
 void hmm_fb(prob_t *result, prob_t *forward, prob_t *backward, prob_t (*f)(int, int, binProblem*), binProblem* bp)
 {
+        progress_t progress;
         size_t j;
 
+        progressStart(&progress, "hmm-fb", "hmm_fb: %.1f%%", bp->bd->L);
         for (j = 0; j < bp->bd->L; j++) {
-                notice(NONE, "hmm_fb: %.1f%%", (float)100*(j+1)/bp->bd->L);
+                if (progressUpdate(&progress, j)) {
+                        break;
+                }
                 result[j] = hmm_fb_rec(forward, backward, j, f, bp) - forward[bp->bd->L-1];
         }
+        if (j == bp->bd->L) {
+                progressUpdate(&progress, j);
+        }
+        for (; j < bp->bd->L; j++) {
+                result[j] = -HUGE_VAL;
+        }
 }
 
 /******************************************************************************
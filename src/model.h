@@ -29,8 +29,10 @@ void __init_model__();
 void __free_model__();
 
 prob_t mbeta_log(prob_t *p, binProblem *bp);
+prob_t mbeta_marginal_log(prob_t *p, prob_t val, size_t which, binProblem *bp);
 prob_t iec_log(int kk, int k, binProblem *bp);
 
+prob_t hmm_hp(int from, int to, binProblem* bp);
 void hmm_forward(prob_t *result, binProblem* bp);
 void hmm_backward(prob_t *result, binProblem* bp);
 void hmm_fb(prob_t *result, prob_t *forward, prob_t *backward, prob_t (*f)(int, int, binProblem*), binProblem* bp);
@@ -117,7 +117,6 @@ void hmm_computeMoments(
  * Main
  ******************************************************************************/
 
-static
 void * computeMoments_thread(void* data_)
 {
         pthread_data_t *data  = (pthread_data_t *)data_;
@@ -139,5 +138,5 @@ void computeMoments(
         binData *bd)
 {
         threaded_computation((void *)moments, evidence_ref, bd, computeMoments_thread,
-                             "Computing moments: %.1f%%");
+                             "moments", "Computing moments: %.1f%%");
 }
@@ -25,6 +25,7 @@
 #include <adaptive-sampling/datatypes.h>
 
 void computeMoments(matrix_t *moments, prob_t evidence_ref, binData *bd);
+void * computeMoments_thread(void* data);
 prob_t hmm_computeMoments(
         matrix_t *moments,
         prob_t *forward,
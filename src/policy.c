@@ -0,0 +1,350 @@
+/* Copyright (C) 2012 Philipp Benner
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <adaptive-sampling/exception.h>
+#include <adaptive-sampling/logarithmetic.h>
+#include <adaptive-sampling/datatypes.h>
+#include <adaptive-sampling/uthash.h>
+
+#include <datatypes.h>
+#include <model.h>
+#include <policy.h>
+#include <threading.h>
+#include <tools.h>
+#include <utility.h>
+
+#ifdef HAVE_LIB_PTHREAD
+#include <pthread.h>
+#endif /* HAVE_LIB_PTHREAD */
+
+/******************************************************************************
+ * Hash table
+ ******************************************************************************/
+
+/* The count statistic of a node in the search tree is given by the
+ * original counts plus the events that were added along the path. An
+ * entry stores the local utility of sampling at position key[0] for
+ * such a count statistic (expectations of all events followed by the
+ * utility). The remaining elements of the key are the sorted events
+ * encoded as pos*events + which. */
+typedef struct {
+        int *key;
+        size_t keylen;
+        double *utility;
+        UT_hash_handle hh;
+} policy_hash_t;
+
+typedef struct {
+        vector_t *result;
+        size_t length;
+        policy_hash_t *map;
+#ifdef HAVE_LIB_PTHREAD
+        pthread_rwlock_t lock;
+#endif /* HAVE_LIB_PTHREAD */
+} policy_t;
+
+/* Forward and backward messages of the count statistics along the
+ * current path of a thread, depth d includes the first d events of
+ * bp->add_path. Messages are only computed if a local utility is
+ * missing in the hash table. */
+typedef struct {
+        prob_t **forward;
+        prob_t **backward;
+        int *valid;
+} policy_stack_t;
+
+static
+size_t policy_key(int *key, int pos, binProblem *bp)
+{
+        int i, j, tmp;
+
+        key[0] = pos;
+        for (i = 0; i < bp->add_path.n; i++) {
+                tmp = bp->add_path.pos[i]*bp->bd->events + bp->add_path.which[i];
+                for (j = i; j > 0 && key[j] > tmp; j--) {
+                        key[j+1] = key[j];
+                }
+                key[j+1] = tmp;
+        }
+        return (bp->add_path.n+1)*sizeof(int);
+}
+
+static
+policy_hash_t * policy_find(policy_t *policy, int *key, size_t keylen)
+{
+        policy_hash_t *s;
+#ifdef HAVE_LIB_PTHREAD
+        if (pthread_rwlock_rdlock(&policy->lock) != 0) {
+                std_err(NONE, "Can't get policy lock (r)");
+        }
+#endif /* HAVE_LIB_PTHREAD */
+        HASH_FIND(hh, policy->map, key, keylen, s);
+#ifdef HAVE_LIB_PTHREAD
+        pthread_rwlock_unlock(&policy->lock);
+#endif /* HAVE_LIB_PTHREAD */
+
+        return s;
+}
+
+/* Insert a new entry, if another thread was faster the new entry is
+ * released and the existing one returned. */
+static
+policy_hash_t * policy_insert(policy_t *policy, policy_hash_t *new)
+{
+        policy_hash_t *s;
+#ifdef HAVE_LIB_PTHREAD
+        if (pthread_rwlock_wrlock(&policy->lock) != 0) {
+                std_err(NONE, "Can't get policy lock (w)");
+        }
+#endif /* HAVE_LIB_PTHREAD */
+        HASH_FIND(hh, policy->map, new->key, new->keylen, s);
+        if (s == NULL) {
+                HASH_ADD_KEYPTR(hh, policy->map, new->key, new->keylen, new);
+        }
+#ifdef HAVE_LIB_PTHREAD
+        pthread_rwlock_unlock(&policy->lock);
+#endif /* HAVE_LIB_PTHREAD */
+        if (s != NULL) {
+                free(new->key);
+                free(new->utility);
+                free(new);
+                return s;
+        }
+        return new;
+}
+
+static
+policy_hash_t * policy_alloc(int *key, size_t keylen)
+{
+        policy_hash_t *new = (policy_hash_t *)malloc(sizeof(policy_hash_t));
+
+        new->key      = (int *)malloc(keylen);
+        new->keylen   = keylen;
+        new->utility  = NULL;
+        memcpy(new->key, key, keylen);
+
+        return new;
+}
+
+static
+void policy_free(policy_t *policy)
+{
+        policy_hash_t *current, *tmp;
+
+        HASH_ITER(hh, policy->map, current, tmp) {
+                HASH_DEL(policy->map, current);
+                free(current->key);
+                free(current->utility);
+                free(current);
+        }
+}
+
+/******************************************************************************
+ * Message stack
+ ******************************************************************************/
+
+static
+void policy_stack_init(policy_stack_t *stack, size_t depth, size_t L)
+{
+        size_t d;
+
+        stack->forward  = (prob_t **)malloc(depth*sizeof(prob_t *));
+        stack->backward = (prob_t **)malloc(depth*sizeof(prob_t *));
+        stack->valid    = (int *)malloc(depth*sizeof(int));
+        for (d = 0; d < depth; d++) {
+                stack->forward [d] = (prob_t *)malloc(L*sizeof(prob_t));
+                stack->backward[d] = (prob_t *)malloc(L*sizeof(prob_t));
+                stack->valid   [d] = 0;
+        }
+}
+
+static
+void policy_stack_free(policy_stack_t *stack, size_t depth)
+{
+        size_t d;
+
+        for (d = 0; d < depth; d++) {
+                free(stack->forward [d]);
+                free(stack->backward[d]);
+        }
+        free(stack->forward);
+        free(stack->backward);
+        free(stack->valid);
+}
+
+/******************************************************************************
+ * Value of a sampling path
+ ******************************************************************************/
+
+static
+const double * policy_utility(policy_t *policy, policy_stack_t *stack, int pos, binProblem *bp)
+{
+        int key[bp->add_path.n+1];
+        size_t keylen = policy_key(key, pos, bp);
+        policy_hash_t *s = policy_find(policy, key, keylen);
+        size_t d = bp->add_path.n;
+        vector_t tmp;
+
+        if (s == NULL) {
+                if (!stack->valid[d]) {
+                        hmm_forward (stack->forward [d], bp);
+                        hmm_backward(stack->backward[d], bp);
+                        stack->valid[d] = 1;
+                }
+                s            = policy_alloc(key, keylen);
+                s->utility   = (double *)malloc((bp->bd->events+1)*sizeof(double));
+                tmp.size     = bp->bd->events+1;
+                tmp.content  = s->utility;
+                hmm_computeUtilityAt(pos, &tmp, stack->forward[d], stack->backward[d], bp);
+                s = policy_insert(policy, s);
+        }
+        return s->utility;
+}
+
+static
+prob_t policy_value(policy_t *policy, policy_stack_t *stack, size_t *path, size_t length, binProblem *bp)
+{
+        const double *local;
+        prob_t result;
+        size_t i;
+
+        if (length == 0) {
+                return 0.0;
+        }
+        local  = policy_utility(policy, stack, path[0], bp);
+        result = local[bp->bd->events];
+
+        if (length > 1) {
+                for (i = 0; i < bp->bd->events; i++) {
+                        bp->add_path.pos  [bp->add_path.n] = path[0];
+                        bp->add_path.which[bp->add_path.n] = i;
+                        bp->add_path.n++;
+                        /* the messages of the next depth belong to
+                         * another prefix */
+                        stack->valid[bp->add_path.n] = 0;
+                        result += local[i]*policy_value(policy, stack, path+1, length-1, bp);
+                        bp->add_path.n--;
+                }
+        }
+        return result;
+}
+
+/* Optimize all but the first element of a path by coordinate ascent,
+ * similar to the policy iteration algorithm. */
+static
+prob_t policy_optimize(policy_t *policy, policy_stack_t *stack, size_t *path, binProblem *bp)
+{
+        size_t i, x, best;
+        prob_t value, value_prime;
+        int changed = 1;
+
+        value = policy_value(policy, stack, path, policy->length, bp);
+
+        while (changed) {
+                changed = 0;
+                for (i = 1; i < policy->length; i++) {
+                        best = path[i];
+                        for (x = 0; x < bp->bd->L; x++) {
+                                if (x == best) {
+                                        continue;
+                                }
+                                path[i]     = x;
+                                value_prime = policy_value(policy, stack, path, policy->length, bp);
+                                if (value_prime > value) {
+                                        value   = value_prime;
+                                        best    = x;
+                                        changed = 1;
+                                }
+                        }
+                        path[i] = best;
+                }
+        }
+        return value;
+}
+
+/******************************************************************************
+ * Threading
+ ******************************************************************************/
+
+static
+void * hmm_computePathUtility_thread(void* data_)
+{
+        pthread_data_t *data = (pthread_data_t *)data_;
+        binProblem *bp   = data->bp;
+        policy_t *policy = (policy_t *)data->result;
+        size_t path[policy->length];
+        int pos[policy->length];
+        int which[policy->length];
+        policy_stack_t stack;
+        size_t i;
+
+        /* the initial path samples the same stimulus repeatedly */
+        for (i = 0; i < policy->length; i++) {
+                path[i] = data->i;
+        }
+        bp->add_path.n     = 0;
+        bp->add_path.pos   = pos;
+        bp->add_path.which = which;
+        policy_stack_init(&stack, policy->length, bp->bd->L);
+
+        policy->result->content[data->i] = policy_optimize(policy, &stack, path, bp);
+
+        policy_stack_free(&stack, policy->length);
+        bp->add_path.pos   = NULL;
+        bp->add_path.which = NULL;
+
+        return NULL;
+}
+
+/******************************************************************************
+ * Main
+ ******************************************************************************/
+
+void hmm_computePathUtility(
+        vector_t *result,
+        size_t length,
+        binData *bd)
+{
+        policy_t policy;
+
+        if (length == 0) {
+                return;
+        }
+        policy.result = result;
+        policy.length = length;
+        policy.map    = NULL;
+#ifdef HAVE_LIB_PTHREAD
+        pthread_rwlock_init(&policy.lock, NULL);
+#endif /* HAVE_LIB_PTHREAD */
+
+        threaded_computation((void *)&policy, 0, bd, hmm_computePathUtility_thread,
+                             "path-utility", "Computing path utility: %.1f%%");
+
+        policy_free(&policy);
+#ifdef HAVE_LIB_PTHREAD
+        pthread_rwlock_destroy(&policy.lock);
+#endif /* HAVE_LIB_PTHREAD */
+}
@@ -0,0 +1,364 @@
+/* Copyright (C) 2012 Philipp Benner
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_SYS_MMAN_H
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif /* HAVE_SYS_MMAN_H */
+
+#include <adaptive-sampling/exception.h>
+#include <adaptive-sampling/datatypes.h>
+#include <adaptive-sampling/result-file.h>
+
+/******************************************************************************
+ * Tools
+ ******************************************************************************/
+
+static
+int little_endian(void)
+{
+        uint32_t x = 1;
+
+        return *(unsigned char *)&x == 1;
+}
+
+static
+size_t element_size(int type)
+{
+        switch (type) {
+        case RESULT_FLOAT64: return sizeof(double);
+        case RESULT_INT64:   return sizeof(int64_t);
+        case RESULT_CHAR:    return sizeof(char);
+        default:             return 0;
+        }
+}
+
+static
+uint64_t align(uint64_t offset)
+{
+        return (offset + RESULT_FILE_ALIGN - 1)/RESULT_FILE_ALIGN*RESULT_FILE_ALIGN;
+}
+
+/******************************************************************************
+ * Writing result files
+ ******************************************************************************/
+
+int writeResultFile(
+        const char *filename,
+        size_t n,
+        const result_array_t *arrays)
+{
+        static const char zeros[RESULT_FILE_ALIGN];
+        result_header_t header;
+        result_entry_t  entry[n];
+        uint64_t offset = sizeof(result_header_t) + n*sizeof(result_entry_t);
+        uint64_t bytes;
+        FILE *fp;
+        size_t i;
+
+        if (!little_endian()) {
+                warn(NONE, "Result files are only supported on little-endian machines.");
+                return -1;
+        }
+        memset(&header, 0, sizeof(header));
+        memset( entry,  0, sizeof(entry));
+
+        for (i = 0; i < n; i++) {
+                if (element_size(arrays[i].type) == 0 || strlen(arrays[i].name) >= sizeof(entry[i].name)) {
+                        warn(NONE, "Invalid array `%s'.", arrays[i].name);
+                        return -1;
+                }
+                strcpy(entry[i].name, arrays[i].name);
+                entry[i].type    = arrays[i].type;
+                entry[i].ndim    = arrays[i].ndim;
+                entry[i].rows    = arrays[i].rows;
+                entry[i].columns = arrays[i].ndim == 1 ? 1 : arrays[i].columns;
+                entry[i].offset  = align(offset);
+                offset = entry[i].offset + entry[i].rows*entry[i].columns*element_size(arrays[i].type);
+        }
+        memcpy(header.magic, RESULT_FILE_MAGIC, sizeof(header.magic));
+        header.version  = RESULT_FILE_VERSION;
+        header.n_arrays = n;
+        header.size     = offset;
+
+        if ((fp = fopen(filename, "wb")) == NULL) {
+                warn(NONE, "Could not open `%s'.", filename);
+                return -1;
+        }
+        fwrite(&header, sizeof(header), 1, fp);
+        fwrite( entry,  sizeof(result_entry_t), n, fp);
+        offset = sizeof(result_header_t) + n*sizeof(result_entry_t);
+        for (i = 0; i < n; i++) {
+                fwrite(zeros, 1, entry[i].offset - offset, fp);
+                bytes  = entry[i].rows*entry[i].columns*element_size(entry[i].type);
+                if (bytes > 0) {
+                        fwrite(arrays[i].data, 1, bytes, fp);
+                }
+                offset = entry[i].offset + bytes;
+        }
+        if (ferror(fp)) {
+                warn(NONE, "Could not write `%s'.", filename);
+                fclose(fp);
+                return -1;
+        }
+        fclose(fp);
+
+        return 0;
+}
+
+/******************************************************************************
+ * Reading result files
+ ******************************************************************************/
+
+static
+int checkResultFile(result_file_t *file)
+{
+        const result_entry_t *entry;
+        uint64_t bytes;
+        size_t i;
+
+        if (file->size < sizeof(result_header_t)) {
+                return -1;
+        }
+        file->header  = (const result_header_t *)file->map;
+        file->entries = (const result_entry_t *)(file->header + 1);
+
+        if (memcmp(file->header->magic, RESULT_FILE_MAGIC, sizeof(file->header->magic)) != 0 ||
+            file->header->version > RESULT_FILE_VERSION ||
+            file->header->size    > file->size ||
+            sizeof(result_header_t) + file->header->n_arrays*sizeof(result_entry_t) > file->size) {
+                return -1;
+        }
+        for (i = 0; i < file->header->n_arrays; i++) {
+                entry = &file->entries[i];
+                bytes = entry->rows*entry->columns*element_size(entry->type);
+                if (element_size(entry->type) == 0 ||
+                    entry->offset % RESULT_FILE_ALIGN != 0 ||
+                    entry->offset + bytes > file->size) {
+                        return -1;
+                }
+        }
+        return 0;
+}
+
+/* The file is mapped into memory if possible, arrays returned by
+ * getResultArray() are valid until the file is closed. */
+result_file_t* openResultFile(const char *filename)
+{
+        result_file_t *file = (result_file_t *)malloc(sizeof(result_file_t));
+#ifdef HAVE_SYS_MMAN_H
+        struct stat st;
+        int fd;
+
+        if ((fd = open(filename, O_RDONLY)) == -1 || fstat(fd, &st) == -1) {
+                warn(NONE, "Could not open `%s'.", filename);
+                if (fd != -1) {
+                        close(fd);
+                }
+                free(file);
+                return NULL;
+        }
+        file->size   = st.st_size;
+        file->mapped = 1;
+        file->map    = file->size > 0 ? mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        close(fd);
+        if (file->map == MAP_FAILED) {
+                file->map  = NULL;
+                file->size = 0;
+        }
+#else
+        FILE *fp;
+
+        if ((fp = fopen(filename, "rb")) == NULL) {
+                warn(NONE, "Could not open `%s'.", filename);
+                free(file);
+                return NULL;
+        }
+        fseek(fp, 0, SEEK_END);
+        file->size   = ftell(fp);
+        file->mapped = 0;
+        file->map    = malloc(file->size);
+        fseek(fp, 0, SEEK_SET);
+        if (fread(file->map, 1, file->size, fp) != file->size) {
+                file->size = 0;
+        }
+        fclose(fp);
+#endif /* HAVE_SYS_MMAN_H */
+        if (!little_endian() || checkResultFile(file) != 0) {
+                warn(NONE, "`%s' is not a valid result file.", filename);
+                closeResultFile(file);
+                return NULL;
+        }
+        return file;
+}
+
+const void* getResultArray(
+        result_file_t *file,
+        const char *name,
+        int *type,
+        size_t *rows,
+        size_t *columns)
+{
+        const result_entry_t *entry;
+        size_t i;
+
+        for (i = 0; i < file->header->n_arrays; i++) {
+                entry = &file->entries[i];
+                if (strncmp(entry->name, name, sizeof(entry->name)) == 0) {
+                        if (type)    *type    = entry->type;
+                        if (rows)    *rows    = entry->rows;
+                        if (columns) *columns = entry->columns;
+                        return (const char *)file->map + entry->offset;
+                }
+        }
+        return NULL;
+}
+
+void closeResultFile(result_file_t *file)
+{
+#ifdef HAVE_SYS_MMAN_H
+        if (file->map) {
+                munmap(file->map, file->size);
+        }
+#else
+        free(file->map);
+#endif /* HAVE_SYS_MMAN_H */
+        free(file);
+}
+
+/******************************************************************************
+ * Marginal posterior
+ ******************************************************************************/
+
+int saveResultFile(const char *filename, marginal_t *result)
+{
+        result_array_t arrays[8];
+        size_t n = 0;
+
+        if (result->moments) {
+                result_array_t tmp = { "moments", RESULT_FLOAT64, 2, result->moments->rows,
+                                       result->moments->columns, result->moments->content[0] };
+                arrays[n++] = tmp;
+        }
+        if (result->density) {
+                result_array_t tmp = { "density", RESULT_FLOAT64, 2, result->density->rows,
+                                       result->density->columns, result->density->content[0] };
+                arrays[n++] = tmp;
+        }
+        if (result->bprob) {
+                result_array_t tmp = { "bprob", RESULT_FLOAT64, 1, result->bprob->size, 1,
+                                       result->bprob->content };
+                arrays[n++] = tmp;
+        }
+        if (result->mpost) {
+                result_array_t tmp = { "mpost", RESULT_FLOAT64, 1, result->mpost->size, 1,
+                                       result->mpost->content };
+                arrays[n++] = tmp;
+        }
+        if (result->coverage) {
+                result_array_t tmp = { "coverage", RESULT_FLOAT64, 2, result->coverage->rows,
+                                       result->coverage->columns, result->coverage->content[0] };
+                arrays[n++] = tmp;
+        }
+        if (result->density_points) {
+                result_array_t tmp = { "density_points", RESULT_FLOAT64, 2, result->density_points->rows,
+                                       result->density_points->columns, result->density_points->content[0] };
+                arrays[n++] = tmp;
+        }
+        if (result->quantiles) {
+                result_array_t tmp = { "quantiles", RESULT_FLOAT64, 2, result->quantiles->rows,
+                                       result->quantiles->columns, result->quantiles->content[0] };
+                arrays[n++] = tmp;
+        }
+        if (result->hdi) {
+                result_array_t tmp = { "hdi", RESULT_FLOAT64, 2, result->hdi->rows,
+                                       result->hdi->columns, result->hdi->content[0] };
+                arrays[n++] = tmp;
+        }
+        return writeResultFile(filename, n, arrays);
+}
+
+static
+matrix_t * loadMatrix(result_file_t *file, const char *name)
+{
+        const double *data;
+        matrix_t *m;
+        size_t rows, columns;
+        int type;
+
+        data = (const double *)getResultArray(file, name, &type, &rows, &columns);
+        if (data == NULL || type != RESULT_FLOAT64 || rows == 0) {
+                return NULL;
+        }
+        m = alloc_matrix(rows, columns);
+        memcpy(m->content[0], data, rows*columns*sizeof(double));
+
+        return m;
+}
+
+static
+vector_t * loadVector(result_file_t *file, const char *name)
+{
+        const double *data;
+        vector_t *v;
+        size_t rows, columns;
+        int type;
+
+        data = (const double *)getResultArray(file, name, &type, &rows, &columns);
+        if (data == NULL || type != RESULT_FLOAT64 || rows == 0) {
+                return NULL;
+        }
+        v = alloc_vector(rows*columns);
+        memcpy(v->content, data, rows*columns*sizeof(double));
+
+        return v;
+}
+
+marginal_t* loadResultFile(const char *filename)
+{
+        result_file_t *file = openResultFile(filename);
+        marginal_t *result;
+
+        if (file == NULL) {
+                return NULL;
+        }
+        result = (marginal_t *)malloc(sizeof(marginal_t));
+        result->moments        = loadMatrix(file, "moments");
+        result->density        = loadMatrix(file, "density");
+        result->bprob          = loadVector(file, "bprob");
+        result->mpost          = loadVector(file, "mpost");
+        result->coverage       = loadMatrix(file, "coverage");
+        result->density_points = loadMatrix(file, "density_points");
+        result->quantiles      = loadMatrix(file, "quantiles");
+        result->hdi            = loadMatrix(file, "hdi");
+        result->events         = 0;
+        result->event          = NULL;
+        result->stats          = NULL;
+        closeResultFile(file);
+
+        return result;
+}
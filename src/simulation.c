@@ -0,0 +1,417 @@
+/* Copyright (C) 2012 Philipp Benner
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <limits.h>
+#include <time.h>
+
+#include <adaptive-sampling/exception.h>
+#include <adaptive-sampling/logarithmetic.h>
+#include <adaptive-sampling/datatypes.h>
+#include <adaptive-sampling/interface.h>
+
+#include <bin-coverage.h>
+#include <datatypes.h>
+#include <model.h>
+#include <simulation.h>
+#include <threading.h>
+#include <tools.h>
+#include <utility.h>
+
+#ifdef HAVE_LIB_PTHREAD
+#include <pthread.h>
+#endif /* HAVE_LIB_PTHREAD */
+
+/******************************************************************************
+ * Simulator
+ ******************************************************************************/
+
+typedef struct {
+        simulation_t *result;
+        size_t replicates;
+        size_t trials;
+        vector_t *gt;
+        double lapsing;
+        int strategy;
+        unsigned long seed;
+        size_t events;
+        matrix_t **alpha;
+        vector_t  *beta;
+        matrix_t  *gamma;
+        /* options of a single replicate */
+        options_t options;
+        /* next replicate, finished replicates and running threads */
+        size_t next;
+        size_t done;
+        size_t active;
+#ifdef HAVE_LIB_PTHREAD
+        pthread_mutex_t mutex;
+        pthread_cond_t cond;
+#endif /* HAVE_LIB_PTHREAD */
+} simulator_t;
+
+/* Each replicate has its own random number stream, which is seeded
+ * from the global seed and the index of the replicate. */
+static
+void seedStream(unsigned short xsubi[3], unsigned long seed, size_t r)
+{
+        unsigned long long z = seed + 0x9E3779B97F4A7C15ULL*(r+1);
+
+        z = (z ^ (z >> 30))*0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27))*0x94D049BB133111EBULL;
+        z =  z ^ (z >> 31);
+
+        xsubi[0] = (unsigned short)(z);
+        xsubi[1] = (unsigned short)(z >> 16);
+        xsubi[2] = (unsigned short)(z >> 32);
+}
+
+/* Select randomly one of the positions where the score is maximal. */
+static
+size_t selectMax(double *score, size_t L, unsigned short xsubi[3])
+{
+        size_t i, n = 0, result = 0;
+
+        for (i = 0; i < L; i++) {
+                if (n == 0 || score[i] > score[result]) {
+                        result = i;
+                        n      = 1;
+                }
+                else if (score[i] == score[result]) {
+                        /* reservoir sampling of all ties */
+                        n++;
+                        if (erand48(xsubi)*n < 1.0) {
+                                result = i;
+                        }
+                }
+        }
+        return result;
+}
+
+/* Same as experiment() in adaptive_sampling.py, event 0 is a success
+ * and the ground truth is the probability of a success. */
+static
+int observe(double gt, double lapsing, unsigned short xsubi[3])
+{
+        if (lapsing >= erand48(xsubi)) {
+                return 0.5 >= erand48(xsubi) ? 0 : 1;
+        }
+        return gt >= erand48(xsubi) ? 0 : 1;
+}
+
+static
+void addEvent(matrix_t *counts, size_t x)
+{
+        size_t i, j;
+
+        for (i = 0; i <= x; i++) {
+                for (j = x; j < counts->columns; j++) {
+                        counts->content[i][j] += 1;
+                }
+        }
+}
+
+static
+double bernoulliKL(double p, double q)
+{
+        double result = 0.0;
+
+        if (p > 0.0) {
+                result += p*log(p/q);
+        }
+        if (p < 1.0) {
+                result += (1.0-p)*log((1.0-p)/(1.0-q));
+        }
+        return result;
+}
+
+/******************************************************************************
+ * Replicates
+ ******************************************************************************/
+
+static
+void simulateReplicate(simulator_t *sim, size_t r)
+{
+        size_t L = sim->gt->size, K = sim->events;
+        size_t i, t, x, k;
+        unsigned short xsubi[3];
+        matrix_t *counts[K];
+        matrix_t *coverage = alloc_matrix(L, L);
+        matrix_t *moments  = alloc_matrix(2, L);
+        double score[L], n[L], kl;
+        prob_t evidence_ref = 0.0;
+        prob_t evidence_log_tmp[L];
+        prob_t forward[L], backward[L];
+        utility_t utility;
+        binData bd;
+        binProblem bp;
+        int event;
+
+        for (k = 0; k < K; k++) {
+                counts[k] = alloc_matrix(L, L);
+        }
+        for (x = 0; x < L; x++) {
+                n[x] = 0;
+        }
+        utility.expectation = alloc_matrix(K, L);
+        utility.utility     = alloc_vector(L);
+        utility.complete    = NULL;
+        utility.batch       = NULL;
+        utility.stats       = NULL;
+
+        seedStream(xsubi, sim->seed, r);
+        bin_init(K, counts, sim->alpha, sim->beta, sim->gamma, &sim->options, &bd);
+        binProblemInit(&bp, &bd);
+
+        /* the posterior after a trial is the prior of the next one */
+        if (sim->options.hmm) {
+                hmm_forward (forward,  &bp);
+                hmm_backward(backward, &bp);
+        }
+        else {
+                evidence_ref = evidence(evidence_log_tmp, &bp);
+        }
+        /* a cancelled replicate stops after the current trial */
+        for (t = 0; t < sim->trials && !interruptPending(); t++) {
+                /* select stimulus */
+                switch (sim->strategy) {
+                case SIMULATION_UNIFORM:
+                        for (x = 0; x < L; x++) {
+                                score[x] = -n[x];
+                        }
+                        break;
+                case SIMULATION_UNIFORM_RANDOM:
+                        for (x = 0; x < L; x++) {
+                                score[x] = 0.0;
+                        }
+                        break;
+                default:
+                case SIMULATION_UTILITY:
+                        for (x = 0; x < L; x++) {
+                                utility.utility->content[x] = 0.0;
+                        }
+                        if (sim->options.hmm) {
+                                hmm_computeUtility(&utility, forward, backward, &bp);
+                        }
+                        else {
+                                computeUtility(&utility, evidence_ref, &bd);
+                        }
+                        for (x = 0; x < L; x++) {
+                                score[x] = utility.utility->content[x];
+                        }
+                        break;
+                }
+                x     = selectMax(score, L, xsubi);
+                event = observe(sim->gt->content[x], sim->lapsing, xsubi);
+
+                addEvent(counts[event], x);
+                n[x] += 1;
+
+                /* posterior moments from the bin coverage */
+                if (sim->options.hmm) {
+                        hmm_forward (forward,  &bp);
+                        hmm_backward(backward, &bp);
+                        hmm_computeBinCoverage(coverage, forward, backward, &bp);
+                }
+                else {
+                        evidence_ref = evidence(evidence_log_tmp, &bp);
+                        computeBinCoverage(coverage, evidence_ref, &bd);
+                }
+                computeCoverageMoments(moments, coverage, &bp);
+
+                kl = 0.0;
+                for (i = 0; i < L; i++) {
+                        kl += bernoulliKL(sim->gt->content[i], moments->content[0][i]);
+                }
+                sim->result->stimulus->content[r][t] = x;
+                sim->result->event   ->content[r][t] = event;
+                sim->result->kl      ->content[r][t] = kl;
+                sim->result->mean    ->content[r][t] = moments->content[0][x];
+                sim->result->variance->content[r][t] = moments->content[1][x]
+                        - moments->content[0][x]*moments->content[0][x];
+        }
+        binProblemFree(&bp);
+        bin_free(&bd);
+
+        for (k = 0; k < K; k++) {
+                free_matrix(counts[k]);
+        }
+        free_matrix(coverage);
+        free_matrix(moments);
+        free_matrix(utility.expectation);
+        free_vector(utility.utility);
+}
+
+/******************************************************************************
+ * Threading
+ ******************************************************************************/
+
+/* Replicates are independent, hence they are distributed over all
+ * threads while each replicate runs single-threaded. The progress is
+ * reported by the thread that waits for the replicates. */
+#ifdef HAVE_LIB_PTHREAD
+
+static
+void * simulateReplicate_thread(void *data)
+{
+        simulator_t *sim = (simulator_t *)data;
+        size_t r;
+
+        progressWorker();
+        pthread_mutex_lock(&sim->mutex);
+        while (sim->next < sim->replicates && !interruptPending()) {
+                r = sim->next++;
+                pthread_mutex_unlock(&sim->mutex);
+                simulateReplicate(sim, r);
+                pthread_mutex_lock(&sim->mutex);
+                sim->done++;
+                pthread_cond_signal(&sim->cond);
+        }
+        sim->active--;
+        pthread_cond_signal(&sim->cond);
+        pthread_mutex_unlock(&sim->mutex);
+
+        return NULL;
+}
+
+static
+void simulateReplicate_wait(simulator_t *sim)
+{
+        progress_t progress;
+        struct timespec ts;
+        double timeout;
+        size_t done;
+
+        progressStart(&progress, "simulation", "Simulating replicates: %.1f%%", sim->replicates);
+
+        pthread_mutex_lock(&sim->mutex);
+        while (sim->active > 0) {
+                done = sim->done;
+                pthread_mutex_unlock(&sim->mutex);
+                progressUpdate(&progress, done);
+                pthread_mutex_lock(&sim->mutex);
+                /* wake up for the hooks */
+                if (sim->active > 0 && sim->done == done) {
+                        timeout    = walltime()+PROGRESS_INTERVAL;
+                        ts.tv_sec  = (time_t)timeout;
+                        ts.tv_nsec = (long)((timeout - ts.tv_sec)*1.0e9);
+                        pthread_cond_timedwait(&sim->cond, &sim->mutex, &ts);
+                }
+        }
+        done = sim->done;
+        pthread_mutex_unlock(&sim->mutex);
+        progressUpdate(&progress, done);
+}
+
+#endif /* HAVE_LIB_PTHREAD */
+
+/******************************************************************************
+ * Main
+ ******************************************************************************/
+
+void runSimulation(
+        simulation_t *result,
+        size_t replicates,
+        size_t trials,
+        vector_t *gt,
+        double lapsing,
+        int strategy,
+        unsigned long seed,
+        size_t events,
+        matrix_t **alpha,
+        vector_t  *beta,
+        matrix_t  *gamma,
+        options_t *options)
+{
+        simulator_t sim;
+
+        sim.result     = result;
+        sim.replicates = replicates;
+        sim.trials     = trials;
+        sim.gt         = gt;
+        sim.lapsing    = lapsing;
+        sim.strategy   = strategy;
+        sim.seed       = seed;
+        sim.events     = events;
+        sim.alpha      = alpha;
+        sim.beta       = beta;
+        sim.gamma      = gamma;
+        sim.next       = 0;
+        sim.done       = 0;
+        sim.options    = *options;
+        sim.options.threads = 1;
+        sim.options.verbose = 0;
+        /* the ground truth is the probability of event 0 */
+        sim.options.which   = 0;
+
+        if (sim.options.algorithm == 1) {
+                /* the sampler has a global state */
+                std_warn(NONE, "The simulator does not support mgs, using prombs.");
+                sim.options.algorithm = 0;
+        }
+#ifdef HAVE_LIB_PTHREAD
+        size_t i, rc, n = options->threads < replicates ? options->threads : replicates;
+        pthread_t threads[n];
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_mutex_init(&sim.mutex, NULL);
+        pthread_cond_init (&sim.cond,  NULL);
+        sim.active = n;
+
+        if (options->stacksize < PTHREAD_STACK_MIN) {
+                if (pthread_attr_setstacksize (&attr, PTHREAD_STACK_MIN) != 0) {
+                        std_warn(NONE, "Couldn't set stack size.");
+                }
+        }
+        else {
+                if (pthread_attr_setstacksize (&attr, (size_t)options->stacksize) != 0) {
+                        std_warn(NONE, "Couldn't set stack size.");
+                }
+        }
+        for (i = 0; i < n; i++) {
+                rc = pthread_create(&threads[i], &attr, simulateReplicate_thread, (void *)&sim);
+                if (rc) {
+                        std_err(NONE, "Couldn't create thread.");
+                }
+        }
+        simulateReplicate_wait(&sim);
+        for (i = 0; i < n; i++) {
+                rc = pthread_join(threads[i], NULL);
+                if (rc) {
+                        std_err(NONE, "Couldn't join thread.");
+                }
+        }
+        pthread_cond_destroy (&sim.cond);
+        pthread_mutex_destroy(&sim.mutex);
+        pthread_attr_destroy (&attr);
+#else
+        progress_t progress;
+        size_t r;
+
+        progressStart(&progress, "simulation", "Simulating replicates: %.1f%%", replicates);
+        for (r = 0; r < replicates && !progressUpdate(&progress, r); r++) {
+                simulateReplicate(&sim, r);
+        }
+        progressUpdate(&progress, r);
+#endif /* HAVE_LIB_PTHREAD */
+}
@@ -0,0 +1,149 @@
+/* Copyright (C) 2012 Philipp Benner
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <adaptive-sampling/datatypes.h>
+
+#include <datatypes.h>
+#include <stats.h>
+#include <threading.h>
+#include <trace.h>
+
+#ifdef HAVE_LIB_PTHREAD
+#include <pthread.h>
+#endif /* HAVE_LIB_PTHREAD */
+
+/******************************************************************************
+ * Statistics
+ ******************************************************************************/
+
+/* All collectors share a single lock, which is only taken when a
+ * phase ends, a binProblem is freed or scratch memory is allocated,
+ * work counters are local to each thread. */
+#ifdef HAVE_LIB_PTHREAD
+static pthread_mutex_t stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define STATS_LOCK()   pthread_mutex_lock  (&stats_mutex)
+#define STATS_UNLOCK() pthread_mutex_unlock(&stats_mutex)
+#else
+#define STATS_LOCK()
+#define STATS_UNLOCK()
+#endif /* HAVE_LIB_PTHREAD */
+
+void statsInit(stats_collector_t *sc, stats_t *result)
+{
+        memset(result, 0, sizeof(stats_t));
+
+        sc->result     = result;
+        sc->scratch    = 0.0;
+        sc->worker_cpu = 0.0;
+        sc->busy       = 0.0;
+        sc->running    = 0.0;
+}
+
+void statsFinish(stats_collector_t *sc)
+{
+        if (sc != NULL && sc->running > 0.0) {
+                sc->result->thread_utilization = sc->busy/sc->running;
+        }
+}
+
+static const char *phase_names[STATS_PHASES] = {
+        "evidence", "coverage", "moments", "density", "bprob", "utility"
+};
+
+/* Phases are timed by the thread that executes them. The cpu time
+ * includes all workers that were started and finished by this thread
+ * during the phase. Phases are also recorded in the trace, even if
+ * no statistics are collected. */
+void statsStart(stats_timer_t *timer, binData *bd)
+{
+        timer->trace = traceBegin();
+        if (bd->stats == NULL) {
+                return;
+        }
+        STATS_LOCK();
+        timer->worker_cpu = bd->stats->worker_cpu;
+        STATS_UNLOCK();
+        timer->wall = walltime();
+        timer->cpu  = cputime();
+}
+
+void statsStop(stats_timer_t *timer, int phase, binData *bd)
+{
+        double wall, cpu;
+
+        traceEnd(phase_names[phase], "phase", -1, timer->trace);
+        if (bd->stats == NULL) {
+                return;
+        }
+        wall = walltime() - timer->wall;
+        cpu  = cputime()  - timer->cpu;
+
+        STATS_LOCK();
+        bd->stats->result->wall[phase] += wall;
+        bd->stats->result->cpu [phase] += cpu + bd->stats->worker_cpu - timer->worker_cpu;
+        STATS_UNLOCK();
+}
+
+void statsMerge(binProblem *bp)
+{
+        stats_t *result;
+
+        if (bp->bd->stats == NULL) {
+                return;
+        }
+        result = bp->bd->stats->result;
+
+        STATS_LOCK();
+        result->prombs_calls  += bp->counter.prombs_calls;
+        result->evaluations   += bp->counter.evaluations;
+        result->lngamma_calls += bp->counter.lngamma_calls;
+        STATS_UNLOCK();
+
+        memset(&bp->counter, 0, sizeof(bp->counter));
+}
+
+/* bytes is negative if the memory is released */
+void statsScratch(binData *bd, double bytes)
+{
+        stats_collector_t *sc = bd->stats;
+
+        if (sc == NULL) {
+                return;
+        }
+        STATS_LOCK();
+        sc->scratch += bytes;
+        if (sc->scratch > sc->result->peak_scratch) {
+                sc->result->peak_scratch = sc->scratch;
+        }
+        STATS_UNLOCK();
+}
+
+void statsWorkers(stats_collector_t *sc, double busy, double running, double cpu)
+{
+        STATS_LOCK();
+        sc->busy       += busy;
+        sc->running    += running;
+        sc->worker_cpu += cpu;
+        STATS_UNLOCK();
+}
@@ -0,0 +1,43 @@
+/* Copyright (C) 2012 Philipp Benner
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <datatypes.h>
+
+typedef struct {
+        double wall;
+        double cpu;
+        double worker_cpu;
+        /* start of the phase in the trace */
+        double trace;
+} stats_timer_t;
+
+void statsInit(stats_collector_t *sc, stats_t *result);
+void statsFinish(stats_collector_t *sc);
+void statsStart(stats_timer_t *timer, binData *bd);
+void statsStop(stats_timer_t *timer, int phase, binData *bd);
+void statsMerge(binProblem *bp);
+void statsScratch(binData *bd, double bytes);
+void statsWorkers(stats_collector_t *sc, double busy, double running, double cpu);
+
+#endif /* STATS_H */
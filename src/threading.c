@@ -22,79 +22,452 @@
 #include <adaptive-sampling/exception.h>
 
 #include <datatypes.h>
+#include <stats.h>
 #include <threading.h>
 #include <tools.h>
+#include <trace.h>
 
 #include <limits.h>
+#include <time.h>
+#include <sys/time.h>
 #ifdef HAVE_LIB_PTHREAD
 #include <pthread.h>
 #endif /* HAVE_LIB_PTHREAD */
 
-void threaded_computation(
-        void *result,
-        prob_t evidence_ref,
-        binData *bd,
-        void *(*f_thread)(void*),
+double walltime(void)
+{
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+
+        return tv.tv_sec + tv.tv_usec/1.0e6;
+}
+
+double cputime(void)
+{
+#ifdef CLOCK_THREAD_CPUTIME_ID
+        struct timespec ts;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+
+        return ts.tv_sec + ts.tv_nsec/1.0e9;
+#else
+        return (double)clock()/CLOCKS_PER_SEC;
+#endif /* CLOCK_THREAD_CPUTIME_ID */
+}
+
+static
+size_t schedule_position(schedule_t *schedule, size_t n)
+{
+        if (schedule && schedule->order) {
+                return schedule->order[n];
+        }
+        return n;
+}
+
+static
+int schedule_expired(schedule_t *schedule)
+{
+        if (schedule && schedule->deadline > 0 && walltime() >= schedule->deadline) {
+                schedule->cancel = 1;
+        }
+        return schedule && schedule->cancel;
+}
+
+/******************************************************************************
+ * Interrupts
+ ******************************************************************************/
+
+/* seconds between two calls of the interrupt hook */
+#define INTERRUPT_INTERVAL 0.1
+
+static int (*interrupt_hook)(void) = NULL;
+static volatile int interrupt_pending = 0;
+
+/* hooks are only called by the thread that called the library,
+ * threads started by the library just read the cancellation flag */
+static __thread int progress_worker = 0;
+
+void progressWorker(void)
+{
+        progress_worker = 1;
+}
+
+void setInterruptHook(int (*hook)(void))
+{
+        interrupt_hook    = hook;
+        interrupt_pending = 0;
+}
+
+void setCancelled(int cancelled)
+{
+        interrupt_pending = cancelled != 0;
+}
+
+int interruptPending(void)
+{
+        return interrupt_pending;
+}
+
+static
+int interrupted(void)
+{
+        if (!progress_worker && !interrupt_pending && interrupt_hook && (*interrupt_hook)()) {
+                interrupt_pending = 1;
+        }
+        return interrupt_pending;
+}
+
+/******************************************************************************
+ * Progress
+ ******************************************************************************/
+
+static int (*progress_hook)(const char *, size_t, size_t) = NULL;
+
+void setProgressHook(int (*hook)(const char *phase, size_t done, size_t total))
+{
+        progress_hook     = hook;
+        interrupt_pending = 0;
+}
+
+void progressStart(progress_t *progress, const char *phase, const char *msg, size_t total)
+{
+        progress->phase = phase;
+        progress->msg   = msg;
+        progress->total = total;
+        progress->last  = 0.0;
+}
+
+/* Reports are throttled, except for the last one. Without hooks and
+ * notices only the cancellation flag is read. */
+int progressUpdate(progress_t *progress, size_t done)
+{
+        double now;
+
+        if (progress_worker || (!progress_hook && !interrupt_hook && verbose != 1)) {
+                return interrupt_pending;
+        }
+        if (done < progress->total) {
+                now = walltime();
+                if (now < progress->last + PROGRESS_INTERVAL) {
+                        return interrupt_pending;
+                }
+                progress->last = now;
+        }
+        if (progress_hook && (*progress_hook)(progress->phase, done, progress->total)) {
+                interrupt_pending = 1;
+        }
+        notice(NONE, progress->msg, (float)100*done/progress->total);
+
+        return interrupted();
+}
+
+/******************************************************************************
+ * Thread pool
+ ******************************************************************************/
+
+#ifdef HAVE_LIB_PTHREAD
+
+/* Tasks of all jobs are distributed to a fixed number of workers
+ * through a shared counter, the main thread only waits for the
+ * deadline and reports the progress. */
+typedef struct {
+        job_t *jobs;
+        size_t n_jobs;
+        size_t job;
+        size_t next;
+        size_t done;
+        size_t tasks;
+        schedule_t *schedule;
+        stats_collector_t *stats;
+        pthread_mutex_t mutex;
+        pthread_cond_t cond;
+} queue_t;
+
+typedef struct {
+        pthread_data_t data;
+        binProblem bp;
+        binData *bd;
+        queue_t *queue;
+        /* time spent on tasks and cpu time, only measured if
+         * statistics are collected */
+        double busy;
+        double cpu;
+        /* trace buffer and the time at which the worker ran out of
+         * tasks */
+        trace_buffer_t *trace;
+        double finished;
+} worker_t;
+
+/* skip jobs without any outstanding tasks */
+static
+void queue_advance(queue_t *queue)
+{
+        while (queue->job < queue->n_jobs && queue->next >= queue->jobs[queue->job].tasks) {
+                queue->job++;
+                queue->next = 0;
+        }
+}
+
+static
+void * worker_thread(void *worker_)
+{
+        worker_t *worker = (worker_t *)worker_;
+        queue_t  *queue  = worker->queue;
+        schedule_t *schedule = queue->schedule;
+        job_t *job;
+        size_t i;
+        double start = 0.0, trace;
+
+        progressWorker();
+        traceAttach(worker->trace);
+        if (queue->stats) {
+                worker->cpu = cputime();
+        }
+        pthread_mutex_lock(&queue->mutex);
+        queue_advance(queue);
+        while (queue->job < queue->n_jobs && !(schedule && schedule->cancel) && !interrupt_pending) {
+                job = &queue->jobs[queue->job];
+                i   = schedule_position(schedule, queue->next++);
+                queue_advance(queue);
+                pthread_mutex_unlock(&queue->mutex);
+
+                /* the thread-local data depends on the data set */
+                if (worker->bd != job->bd) {
+                        if (worker->bd != NULL) {
+                                binProblemFree(&worker->bp);
+                        }
+                        worker->bd = job->bd;
+                        binProblemInit(&worker->bp, job->bd);
+                }
+                worker->data.result = job->result;
+                worker->data.evidence_ref = job->evidence_ref;
+
+                worker->data.i = i;
+                if (queue->stats) {
+                        start = walltime();
+                }
+                trace = traceBegin();
+                (*job->f_thread)((void *)&worker->data);
+                traceEnd(job->name, "task", i, trace);
+                if (queue->stats) {
+                        worker->busy += walltime() - start;
+                }
+
+                pthread_mutex_lock(&queue->mutex);
+                /* a task that returns after cancellation might be
+                 * incomplete */
+                if (schedule && schedule->complete && !schedule->cancel) {
+                        schedule->complete[i] = 1;
+                }
+                queue->done++;
+                pthread_cond_signal(&queue->cond);
+        }
+        pthread_mutex_unlock(&queue->mutex);
+        worker->finished = traceBegin();
+
+        if (worker->bd != NULL) {
+                binProblemFree(&worker->bp);
+        }
+        if (queue->stats) {
+                worker->cpu = cputime() - worker->cpu;
+        }
+        return NULL;
+}
+
+static
+void queue_wait(queue_t *queue, const char *name, const char *msg)
+{
+        schedule_t *schedule = queue->schedule;
+        progress_t progress;
+        struct timespec ts;
+        double timeout;
+        size_t done = 0;
+
+        progressStart(&progress, name, msg, queue->tasks);
+
+        pthread_mutex_lock(&queue->mutex);
+        while (queue->done < queue->tasks) {
+                if (schedule_expired(schedule) || interrupted()) {
+                        break;
+                }
+                /* wake up for the deadline and for the interrupt hook */
+                timeout = schedule ? schedule->deadline : 0;
+                if (interrupt_hook && (timeout <= 0 || timeout > walltime()+INTERRUPT_INTERVAL)) {
+                        timeout = walltime()+INTERRUPT_INTERVAL;
+                }
+                if (timeout > 0) {
+                        ts.tv_sec  = (time_t)timeout;
+                        ts.tv_nsec = (long)((timeout - ts.tv_sec)*1.0e9);
+                        pthread_cond_timedwait(&queue->cond, &queue->mutex, &ts);
+                }
+                else {
+                        pthread_cond_wait(&queue->cond, &queue->mutex);
+                }
+                /* the hooks are called without holding the lock */
+                if (queue->done > done) {
+                        done = queue->done;
+                        pthread_mutex_unlock(&queue->mutex);
+                        progressUpdate(&progress, done);
+                        pthread_mutex_lock(&queue->mutex);
+                }
+        }
+        pthread_mutex_unlock(&queue->mutex);
+}
+
+#endif /* HAVE_LIB_PTHREAD */
+
+static
+void run_jobs(
+        job_t *jobs,
+        size_t n_jobs,
+        schedule_t *schedule,
+        options_t *options,
+        const char *name,
         const char *msg)
 {
+        stats_collector_t *stats = n_jobs > 0 ? jobs[0].bd->stats : NULL;
+        double start = walltime();
+        double trace = traceBegin();
+        size_t i, tasks = 0;
+
+        for (i = 0; i < n_jobs; i++) {
+                tasks += jobs[i].tasks;
+        }
+        /* skip all remaining computations after an interrupt */
+        if (interrupt_pending) {
+                return;
+        }
 #ifdef HAVE_LIB_PTHREAD
-        size_t i, j, rc;
-        binProblem bp[bd->options->threads];
-        pthread_t threads[bd->options->threads];
-        pthread_data_t data[bd->options->threads];
+        size_t rc, n = options->threads < tasks ? options->threads : tasks;
+        pthread_t threads[n];
+        worker_t workers[n];
+        queue_t queue;
         pthread_attr_t attr;
         pthread_attr_init(&attr);
 
-        for (i = 0; i < bd->options->threads && i < bd->L; i++) {
-                binProblemInit(&bp[i], bd);
-                data[i].bp = &bp[i];
-                data[i].result = result;
-                data[i].evidence_ref = evidence_ref;
+        queue.jobs     = jobs;
+        queue.n_jobs   = n_jobs;
+        queue.job      = 0;
+        queue.next     = 0;
+        queue.done     = 0;
+        queue.tasks    = tasks;
+        queue.schedule = schedule;
+        queue.stats    = stats;
+        pthread_mutex_init(&queue.mutex, NULL);
+        pthread_cond_init (&queue.cond,  NULL);
+
+        for (i = 0; i < n; i++) {
+                workers[i].data.bp = &workers[i].bp;
+                workers[i].bd      = NULL;
+                workers[i].queue   = &queue;
+                workers[i].busy    = 0.0;
+                workers[i].cpu     = 0.0;
+                workers[i].trace   = traceAcquire();
         }
-        if (bd->options->stacksize < PTHREAD_STACK_MIN) {
+        if (options->stacksize < PTHREAD_STACK_MIN) {
                 if (pthread_attr_setstacksize (&attr, PTHREAD_STACK_MIN) != 0) {
                         std_warn(NONE, "Couldn't set stack size.");
                 }
         }
         else {
-                if (pthread_attr_setstacksize (&attr, (size_t)bd->options->stacksize) != 0) {
+                if (pthread_attr_setstacksize (&attr, (size_t)options->stacksize) != 0) {
                         std_warn(NONE, "Couldn't set stack size.");
                 }
         }
-        for (i = 0; i < bd->L; i += bd->options->threads) {
-                for (j = 0; j < bd->options->threads && i+j < bd->L; j++) {
-                        notice(NONE, msg, (float)100*(i+j+1)/bd->L);
-                        data[j].i = i+j;
-                        rc = pthread_create(&threads[j], &attr, f_thread, (void *)&data[j]);
-                        if (rc) {
-                                std_err(NONE, "Couldn't create thread.");
-                        }
+        for (i = 0; i < n; i++) {
+                rc = pthread_create(&threads[i], &attr, worker_thread, (void *)&workers[i]);
+                if (rc) {
+                        std_err(NONE, "Couldn't create thread.");
                 }
-                for (j = 0; j < bd->options->threads && i+j < bd->L; j++) {
-                        rc = pthread_join(threads[j], NULL);
-                        if (rc) {
-                                std_err(NONE, "Couldn't join thread.");
-                        }
+        }
+        queue_wait(&queue, name, msg);
+        for (i = 0; i < n; i++) {
+                rc = pthread_join(threads[i], NULL);
+                if (rc) {
+                        std_err(NONE, "Couldn't join thread.");
+                }
+                if (stats) {
+                        statsWorkers(stats, workers[i].busy, walltime() - start, workers[i].cpu);
                 }
         }
-        for (j = 0; j < bd->options->threads && j < bd->L; j++) {
-                binProblemFree(&bp[j]);
+        /* workers that ran out of tasks are idle until the last
+         * worker is joined */
+        for (i = 0; i < n; i++) {
+                traceRecord(workers[i].trace, "idle", "idle", -1, workers[i].finished, traceBegin());
+                traceRelease(workers[i].trace);
         }
+        traceEnd("wait", "wait", -1, trace);
+        pthread_mutex_destroy(&queue.mutex);
+        pthread_cond_destroy (&queue.cond);
+        pthread_attr_destroy (&attr);
 #else
-        size_t i;
+        size_t j, done = 0;
         pthread_data_t data;
         binProblem bp;
+        progress_t progress;
 
-        binProblemInit(&bp, bd);
-        data.bp = &bp;
-        data.result = result;
-        data.evidence_ref = evidence_ref;
+        progressStart(&progress, name, msg, tasks);
 
-        for (i = 0; i < bd->L; i++ ) {
-                notice(NONE, msg, (float)100*(i+1)/bd->L);
-                data.i = i;
-                (*f_thread)(&data);
-        }
+        for (j = 0; j < n_jobs; j++) {
+                if (jobs[j].tasks == 0) {
+                        continue;
+                }
+                binProblemInit(&bp, jobs[j].bd);
+                data.bp = &bp;
+                data.result = jobs[j].result;
+                data.evidence_ref = jobs[j].evidence_ref;
 
+                for (i = 0; i < jobs[j].tasks; i++) {
+                        if (schedule_expired(schedule) || progressUpdate(&progress, done)) {
+                                break;
+                        }
+                        data.i = schedule_position(schedule, i);
+                        trace  = traceBegin();
+                        (*jobs[j].f_thread)(&data);
+                        traceEnd(jobs[j].name, "task", data.i, trace);
+                        if (schedule && schedule->complete && !schedule_expired(schedule)) {
+                                schedule->complete[data.i] = 1;
+                        }
+                        done++;
+                }
+                binProblemFree(&bp);
+        }
+        if (done == tasks) {
+                progressUpdate(&progress, done);
+        }
+        /* tasks are executed by the calling thread, which measures
+         * its own cpu time */
+        if (stats) {
+                statsWorkers(stats, walltime() - start, walltime() - start, 0.0);
+        }
 #endif /* HAVE_LIB_PTHREAD */
 }
+
+void threaded_computation(
+        void *result,
+        prob_t evidence_ref,
+        binData *bd,
+        void *(*f_thread)(void*),
+        const char *name,
+        const char *msg)
+{
+        job_t job;
+
+        job.result       = result;
+        job.evidence_ref = evidence_ref;
+        job.bd           = bd;
+        job.tasks        = bd->L;
+        job.f_thread     = f_thread;
+        job.name         = name;
+
+        run_jobs(&job, 1, bd->schedule, bd->options, name, msg);
+}
+
+void threaded_jobs(
+        job_t *jobs,
+        size_t n,
+        options_t *options,
+        const char *name,
+        const char *msg)
+{
+        run_jobs(jobs, n, NULL, options, name, msg);
+}
@@ -30,11 +30,64 @@ typedef struct {
         prob_t evidence_ref;
 } pthread_data_t;
 
+/* A job calls f_thread for tasks 0,...,tasks-1 of a single data
+ * set. */
+typedef struct {
+        void *result;
+        prob_t evidence_ref;
+        binData *bd;
+        size_t tasks;
+        void *(*f_thread)(void*);
+        /* name of the tasks in traces */
+        const char *name;
+} job_t;
+
+/* seconds between two progress reports of a phase */
+#define PROGRESS_INTERVAL 0.1
+
+/* Progress of a phase with a given number of steps, which is
+ * reported to the progress hook and as a notice. */
+typedef struct {
+        const char *phase;
+        const char *msg;
+        size_t total;
+        double last;
+} progress_t;
+
+void progressStart(progress_t *progress, const char *phase, const char *msg, size_t total);
+
+/* Report that done steps are finished, returns nonzero if the
+ * computation was cancelled. */
+int progressUpdate(progress_t *progress, size_t done);
+
+/* Mark the calling thread as started by the library, it never calls
+ * the progress or interrupt hooks. */
+void progressWorker(void);
+
+/* Current wall-clock time in seconds. */
+double walltime(void);
+
+/* Cpu time of the calling thread in seconds. */
+double cputime(void);
+
+/* Call f_thread for all positions. If bd->schedule is set, positions
+ * are processed in the given order until the deadline is reached,
+ * after which outstanding tasks are cancelled. */
 void threaded_computation(
         void *result,
         prob_t evidence_ref,
         binData *bd,
         void *(*f_thread)(void*),
+        const char *name,
+        const char *msg);
+
+/* Run the tasks of several jobs, possibly of different data sets, on
+ * a single pool of options->threads workers. */
+void threaded_jobs(
+        job_t *jobs,
+        size_t n,
+        options_t *options,
+        const char *name,
         const char *msg);
 
 #endif /* THREADING_H */
@@ -22,8 +22,11 @@
 #include <config.h>
 #endif /* HAVE_CONFIG_H */
 
+#include <string.h>
+
 #include <datatypes.h>
 #include <model.h>
+#include <stats.h>
 
 #include <adaptive-sampling/datatypes.h>
 #include <adaptive-sampling/logarithmetic.h>
@@ -88,18 +91,22 @@ void binProblemInit(binProblem *bp, binData* bd)
         bp->bd              = bd;
         if (bd->options->algorithm == 0) {
                 bp->ak      = alloc_prombs_matrix(bd->L);
+                statsScratch(bd, bd->L*(bd->L*sizeof(prob_t) + sizeof(prob_t *)));
         }
         else {
                 bp->ak      = NULL;
         }
-        bp->bprob_pos       = -1;
         bp->counts_pos      = -1;
         bp->add_event.pos   = -1;
         bp->add_event.n     = 0;
         bp->add_event.which = bd->options->which;
+        bp->add_path.n      = 0;
+        bp->add_path.pos    = NULL;
+        bp->add_path.which  = NULL;
         bp->fix_prob.pos    = -1;
         bp->fix_prob.val    = 0;
         bp->fix_prob.which  = bd->options->which;
+        memset(&bp->counter, 0, sizeof(bp->counter));
 }
 
 static __inline__
@@ -107,7 +114,18 @@ void binProblemFree(binProblem *bp)
 {
         if (bp->ak) {
                 free_prombs_matrix(bp->ak, bp->bd->L);
+                statsScratch(bp->bd, -(double)bp->bd->L*(bp->bd->L*sizeof(prob_t) + sizeof(prob_t *)));
         }
+        statsMerge(bp);
+}
+
+/* True if the current computation was cancelled, workers check this
+ * between calls to the binning algorithm and leave the result
+ * incomplete. */
+static __inline__
+int cancelled(binProblem *bp)
+{
+        return bp->bd->schedule != NULL && bp->bd->schedule->cancel;
 }
 
 /******************************************************************************
@@ -117,12 +135,20 @@ void binProblemFree(binProblem *bp)
 static __inline__
 size_t countStatistic(size_t event, int ks, int ke, binProblem *bp)
 {
+        size_t result = bp->bd->counts[event]->content[ks][ke];
+        int i;
+
         if (bp->add_event.which == event &&
             ks <= bp->add_event.pos && bp->add_event.pos <= ke) {
-                return bp->bd->counts[event]->content[ks][ke] +
-                        bp->add_event.n;
+                result += bp->add_event.n;
+        }
+        for (i = 0; i < bp->add_path.n; i++) {
+                if (bp->add_path.which[i] == event &&
+                    ks <= bp->add_path.pos[i] && bp->add_path.pos[i] <= ke) {
+                        result++;
+                }
         }
-        return bp->bd->counts[event]->content[ks][ke];
+        return result;
 }
 
 static __inline__
@@ -141,6 +167,7 @@ void callBinningAlgorithm(
         prob_t *ev_log,
         binProblem *bp)
 {
+        bp->counter.prombs_calls++;
         switch (bp->bd->options->algorithm) {
         default:
         case 0:
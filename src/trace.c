@@ -0,0 +1,281 @@
+/* Copyright (C) 2012 Philipp Benner
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <adaptive-sampling/exception.h>
+#include <adaptive-sampling/interface.h>
+
+#include <datatypes.h>
+#include <threading.h>
+#include <trace.h>
+
+#ifdef HAVE_LIB_PTHREAD
+#include <pthread.h>
+#endif /* HAVE_LIB_PTHREAD */
+
+/******************************************************************************
+ * Trace buffers
+ ******************************************************************************/
+
+/* default number of events kept by each thread */
+#define TRACE_CAPACITY 65536
+
+typedef struct {
+        const char *name;
+        const char *category;
+        long position;
+        double start;
+        double end;
+} trace_event_t;
+
+/* Ring buffer of a single thread, only the last `capacity' events
+ * are kept. Events are written without locks by the thread that owns
+ * the buffer. */
+struct _trace_buffer_ {
+        size_t tid;
+        size_t n;
+        int in_use;
+        trace_event_t *events;
+};
+
+/* The lock is only taken when buffers are acquired or released,
+ * which happens once for each worker thread. */
+#ifdef HAVE_LIB_PTHREAD
+static pthread_mutex_t trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define TRACE_LOCK()   pthread_mutex_lock  (&trace_mutex)
+#define TRACE_UNLOCK() pthread_mutex_unlock(&trace_mutex)
+#else
+#define TRACE_LOCK()
+#define TRACE_UNLOCK()
+#endif /* HAVE_LIB_PTHREAD */
+
+static volatile int trace_enabled = 0;
+static trace_buffer_t **trace_buffers = NULL;
+static size_t trace_threads  = 0;
+static size_t trace_capacity = TRACE_CAPACITY;
+static double trace_origin;
+/* buffers of threads that outlive a trace are replaced when the
+ * generation changes */
+static unsigned long trace_generation = 0;
+
+static __thread trace_buffer_t *trace_local = NULL;
+static __thread unsigned long trace_local_generation = 0;
+
+static
+double traceClock(void)
+{
+#ifdef CLOCK_MONOTONIC
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+
+        return ts.tv_sec*1.0e6 + ts.tv_nsec/1.0e3;
+#else
+        return walltime()*1.0e6;
+#endif /* CLOCK_MONOTONIC */
+}
+
+static
+void traceFree(void)
+{
+        size_t i;
+
+        for (i = 0; i < trace_threads; i++) {
+                free(trace_buffers[i]->events);
+                free(trace_buffers[i]);
+        }
+        free(trace_buffers);
+        trace_buffers = NULL;
+        trace_threads = 0;
+}
+
+trace_buffer_t * traceAcquire(void)
+{
+        trace_buffer_t *buffer = NULL;
+        size_t i;
+
+        if (!trace_enabled) {
+                return NULL;
+        }
+        TRACE_LOCK();
+        for (i = 0; i < trace_threads; i++) {
+                if (!trace_buffers[i]->in_use) {
+                        buffer = trace_buffers[i];
+                        break;
+                }
+        }
+        if (buffer == NULL) {
+                buffer = (trace_buffer_t *)malloc(sizeof(trace_buffer_t));
+                buffer->tid    = trace_threads;
+                buffer->n      = 0;
+                buffer->events = (trace_event_t *)malloc(trace_capacity*sizeof(trace_event_t));
+                trace_buffers  = (trace_buffer_t **)realloc(trace_buffers, (trace_threads+1)*sizeof(trace_buffer_t *));
+                trace_buffers[trace_threads++] = buffer;
+        }
+        buffer->in_use = 1;
+        TRACE_UNLOCK();
+
+        return buffer;
+}
+
+void traceRelease(trace_buffer_t *buffer)
+{
+        if (buffer == NULL) {
+                return;
+        }
+        TRACE_LOCK();
+        buffer->in_use = 0;
+        TRACE_UNLOCK();
+}
+
+void traceAttach(trace_buffer_t *buffer)
+{
+        trace_local            = buffer;
+        trace_local_generation = trace_generation;
+}
+
+/******************************************************************************
+ * Recording
+ ******************************************************************************/
+
+double traceBegin(void)
+{
+        if (!trace_enabled) {
+                return -1.0;
+        }
+        return traceClock() - trace_origin;
+}
+
+void traceRecord(
+        trace_buffer_t *buffer,
+        const char *name,
+        const char *category,
+        long position,
+        double start,
+        double end)
+{
+        trace_event_t *event;
+
+        if (buffer == NULL || start < 0.0 || end < 0.0) {
+                return;
+        }
+        event = &buffer->events[buffer->n++ % trace_capacity];
+        event->name     = name;
+        event->category = category;
+        event->position = position;
+        event->start    = start;
+        event->end      = end;
+}
+
+void traceEnd(const char *name, const char *category, long position, double start)
+{
+        if (start < 0.0 || !trace_enabled) {
+                return;
+        }
+        /* threads that are not started by the library keep their
+         * buffer until the trace is stopped */
+        if (trace_local == NULL || trace_local_generation != trace_generation) {
+                traceAttach(traceAcquire());
+        }
+        traceRecord(trace_local, name, category, position, start, traceBegin());
+}
+
+/******************************************************************************
+ * Library entry points
+ ******************************************************************************/
+
+void traceStart(int capacity)
+{
+        TRACE_LOCK();
+        traceFree();
+        trace_capacity = capacity > 0 ? capacity : TRACE_CAPACITY;
+        trace_generation++;
+        trace_origin  = traceClock();
+        trace_enabled = 1;
+        TRACE_UNLOCK();
+}
+
+/* Events are written in the Chrome trace-event format as complete
+ * events with timestamps in microseconds. Threads are numbered by
+ * their buffers, which are reused by the workers of consecutive
+ * computations. */
+static
+int traceWrite(const char *filename)
+{
+        FILE *fp = fopen(filename, "w");
+        trace_event_t *event;
+        size_t i, j, first, dropped = 0;
+        const char *sep = "";
+
+        if (fp == NULL) {
+                warn(NONE, "Couldn't open `%s' for writing.", filename);
+                return -1;
+        }
+        fprintf(fp, "{\"traceEvents\":[");
+        for (i = 0; i < trace_threads; i++) {
+                fprintf(fp, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%lu,"
+                        "\"args\":{\"name\":\"thread %lu\"}}",
+                        sep, (unsigned long)i, (unsigned long)i);
+                sep = ",";
+        }
+        for (i = 0; i < trace_threads; i++) {
+                first = trace_buffers[i]->n > trace_capacity ? trace_buffers[i]->n - trace_capacity : 0;
+                dropped += first;
+                for (j = first; j < trace_buffers[i]->n; j++) {
+                        event = &trace_buffers[i]->events[j % trace_capacity];
+                        fprintf(fp, "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%lu,"
+                                "\"ts\":%.3f,\"dur\":%.3f",
+                                sep, event->name, event->category, (unsigned long)i,
+                                event->start, event->end - event->start);
+                        if (event->position >= 0) {
+                                fprintf(fp, ",\"args\":{\"position\":%ld}", event->position);
+                        }
+                        fprintf(fp, "}");
+                        sep = ",";
+                }
+        }
+        fprintf(fp, "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped\":%lu}}\n",
+                (unsigned long)dropped);
+
+        if (fclose(fp) != 0) {
+                warn(NONE, "Couldn't write `%s'.", filename);
+                return -1;
+        }
+        return 0;
+}
+
+int traceStop(const char *filename)
+{
+        int result = 0;
+
+        TRACE_LOCK();
+        trace_enabled = 0;
+        if (filename != NULL) {
+                result = traceWrite(filename);
+        }
+        traceFree();
+        TRACE_UNLOCK();
+
+        return result;
+}
@@ -0,0 +1,51 @@
+/* Copyright (C) 2012 Philipp Benner
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+typedef struct _trace_buffer_ trace_buffer_t;
+
+/* Time in microseconds since the trace was started, or -1 if tracing
+ * is disabled. */
+double traceBegin(void);
+
+/* Record an event of the calling thread from start to now, position
+ * is -1 if the event does not belong to a position. Does nothing if
+ * start is negative. */
+void traceEnd(const char *name, const char *category, long position, double start);
+
+/* Buffers of worker threads are acquired and released by the thread
+ * that starts and joins the workers, a worker attaches its buffer to
+ * record events with traceEnd(). All functions accept NULL, which
+ * is returned if tracing is disabled. */
+trace_buffer_t * traceAcquire(void);
+void traceRelease(trace_buffer_t *buffer);
+void traceAttach(trace_buffer_t *buffer);
+void traceRecord(
+        trace_buffer_t *buffer,
+        const char *name,
+        const char *category,
+        long position,
+        double start,
+        double end);
+
+#endif /* TRACE_H */
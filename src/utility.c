@@ -24,6 +24,7 @@
 #include <strings.h>
 #include <math.h>
 #include <limits.h>
+#include <float.h>
 #include <sys/time.h>
 
 #include <adaptive-sampling/exception.h>
@@ -35,7 +36,9 @@
 
 #include <gsl/gsl_sf_psi.h>
 
+#include <bin-coverage.h>
 #include <datatypes.h>
+#include <effective-counts.h>
 #include <model.h>
 #include <utility.h>
 #include <threading.h>
@@ -122,7 +125,7 @@ void KLPsiUtility(utility_t* result, size_t i, prob_t evidence_ref, binProblem *
         prob_t sum1, sum2;
         size_t j;
 
-        for (j = 0; j < bp->bd->events; j++) {
+        for (j = 0; j < bp->bd->events && !cancelled(bp); j++) {
                 bp->add_event.n     = 1;
                 bp->add_event.pos   = i;
                 bp->add_event.which = j;
@@ -177,7 +180,7 @@ void KLMultibinUtility(utility_t* result, size_t i, prob_t evidence_ref, binProb
         prob_t sum;
         size_t j;
 
-        for (j = 0; j < bp->bd->events; j++) {
+        for (j = 0; j < bp->bd->events && !cancelled(bp); j++) {
 
                 bp->add_event.n     = 1;
                 bp->add_event.pos   = i;
@@ -221,7 +224,7 @@ void computeExpectation(utility_t* result, size_t i, prob_t evidence_ref, binPro
 {
         size_t j;
 
-        for (j = 0; j < bp->bd->events; j++) {
+        for (j = 0; j < bp->bd->events && !cancelled(bp); j++) {
                 result->expectation->content[j][i] = expectation(j, i, evidence_ref, bp);
         }
 }
@@ -231,25 +234,182 @@ void computeExpectation(utility_t* result, size_t i, prob_t evidence_ref, binPro
  ******************************************************************************/
 
 static
-void * computeKLUtility_thread(void* data_)
+void computeKLUtilityAt(utility_t *result, size_t i, prob_t evidence_ref, binProblem *bp)
 {
-        pthread_data_t *data  = (pthread_data_t *)data_;
-        binProblem *bp = data->bp;
-        int i = data->i;
-        utility_t *result    = (utility_t *)data->result;
-        prob_t evidence_ref = data->evidence_ref;
-
         /* for each event compute its expectation */
         computeExpectation(result, i, evidence_ref, bp);
 
         /* compute utilities */
-        if (bp->bd->options->kl_psi) {
+        if (bp->bd->options->kl_psi && !cancelled(bp)) {
                 KLPsiUtility(result, i, evidence_ref, bp);
         }
-        if (bp->bd->options->kl_multibin) {
+        if (bp->bd->options->kl_multibin && !cancelled(bp)) {
                 KLMultibinUtility(result, i, evidence_ref, bp);
         }
+}
+
+static
+void * computeKLUtility_thread(void* data_)
+{
+        pthread_data_t *data  = (pthread_data_t *)data_;
+
+        computeKLUtilityAt((utility_t *)data->result, data->i, data->evidence_ref, data->bp);
+
+        return NULL;
+}
+
+/******************************************************************************
+ * Utility bounds
+ ******************************************************************************/
+
+/* Bounds are placed symmetrically around the estimate, they only
+ * have to absorb rounding errors since the decomposition below is
+ * exact */
+#define KL_PRUNE_TOLERANCE 1.0e-8
+
+typedef struct {
+        utility_t *utility;
+        int *candidates;
+} pruned_utility_t;
+
+/* Both KL utilities depend only on the bin that covers the position
+ * where the new event is added, hence they are mixtures over the bin
+ * coverage P([i,j] is a bin|D):
+ *
+ *   U_psi(x)      = sum_{[i,j] covers x} P([i,j]|D) sum_k p_k (psi(c_k+1) - psi(n+1) - log p_k)
+ *   U_multibin(x) = H(E[p(x)|D]) - sum_{[i,j] covers x} P([i,j]|D) H(p)
+ *
+ * where c are the counts plus pseudo counts of bin [i,j], n = sum_k c_k
+ * and p = c/n is its predictive distribution. All mixtures are computed
+ * in O(L^2) from running sums over the end of the interval. */
+static
+void KLUtilityMixture(utility_t *result, matrix_t *coverage, binProblem *bp)
+{
+        size_t L = bp->bd->L, K = bp->bd->events;
+        size_t i, x, k;
+        prob_t c[K], n, p, P, t_psi, t_h;
+        prob_t s_psi, s_h, s_e[K];
+        prob_t u_psi[L], u_h[L];
+
+        for (x = 0; x < L; x++) {
+                u_psi[x] = 0.0;
+                u_h  [x] = 0.0;
+                for (k = 0; k < K; k++) {
+                        result->expectation->content[k][x] = 0.0;
+                }
+        }
+        for (i = 0; i < L; i++) {
+                s_psi = 0.0;
+                s_h   = 0.0;
+                for (k = 0; k < K; k++) {
+                        s_e[k] = 0.0;
+                }
+                /* x runs over the end of the interval [i,x] */
+                for (x = L; x-- > i;) {
+                        P = coverage->content[i][x];
+                        if (P > 0.0) {
+                                n = 0.0;
+                                for (k = 0; k < K; k++) {
+                                        c[k] = countStatistic(k, i, x, bp) + countAlpha(k, i, x, bp);
+                                        n   += c[k];
+                                }
+                                t_psi = 0.0;
+                                t_h   = 0.0;
+                                for (k = 0; k < K; k++) {
+                                        p = c[k]/n;
+                                        if (p > 0.0) {
+                                                t_h   -= p*LOG(p);
+                                                t_psi += p*(gsl_sf_psi(c[k]+1) - gsl_sf_psi(n+1));
+                                        }
+                                        s_e[k] += P*p;
+                                }
+                                s_psi += P*(t_psi + t_h);
+                                s_h   += P*t_h;
+                        }
+                        u_psi[x] += s_psi;
+                        u_h  [x] += s_h;
+                        for (k = 0; k < K; k++) {
+                                result->expectation->content[k][x] += s_e[k];
+                        }
+                }
+        }
+        for (x = 0; x < L; x++) {
+                result->utility->content[x] = 0.0;
+                if (bp->bd->options->kl_psi) {
+                        result->utility->content[x] += u_psi[x];
+                }
+                if (bp->bd->options->kl_multibin) {
+                        result->utility->content[x] -= u_h[x];
+                        for (k = 0; k < K; k++) {
+                                p = result->expectation->content[k][x];
+                                if (p > 0.0) {
+                                        result->utility->content[x] -= p*LOG(p);
+                                }
+                        }
+                }
+        }
+}
+
+/* Compute lower and upper bounds for the utility at all positions and
+ * mark those positions as candidates where the upper bound exceeds
+ * the best lower bound. The estimates are stored in result. The
+ * coverage is always computed with prombs, since no chain of the
+ * sampler is available here. */
+static
+void computeKLUtilityBounds(
+        utility_t *result,
+        int *candidates,
+        prob_t evidence_ref,
+        binData *bd)
+{
+        binProblem bp; binProblemInit(&bp, bd);
+        matrix_t *coverage = alloc_matrix(bd->L, bd->L);
+        prob_t lower[bd->L], upper[bd->L];
+        prob_t tol = 0.0, best = -HUGE_VAL;
+        options_t exact = *bd->options;
+        binData bd_exact = *bd;
+        size_t i;
+
+        exact.algorithm  = 0;
+        bd_exact.options = &exact;
+        computeBinCoverage(coverage, evidence_ref, &bd_exact);
+        KLUtilityMixture(result, coverage, &bp);
 
+        for (i = 0; i < bd->L; i++) {
+                if (fabs(result->utility->content[i]) > tol) {
+                        tol = fabs(result->utility->content[i]);
+                }
+        }
+        tol = KL_PRUNE_TOLERANCE*tol + DBL_EPSILON;
+        for (i = 0; i < bd->L; i++) {
+                lower[i] = result->utility->content[i] - tol;
+                upper[i] = result->utility->content[i] + tol;
+                if (lower[i] > best) {
+                        best = lower[i];
+                }
+        }
+        for (i = 0; i < bd->L; i++) {
+                if (bd->options->prune_ties) {
+                        candidates[i] = upper[i] >= best;
+                }
+                else {
+                        candidates[i] = upper[i] >  best;
+                }
+        }
+        free_matrix(coverage);
+        binProblemFree(&bp);
+}
+
+static
+void * computePrunedKLUtility_thread(void* data_)
+{
+        pthread_data_t *data     = (pthread_data_t *)data_;
+        pruned_utility_t *pruned = (pruned_utility_t *)data->result;
+
+        if (pruned->candidates[data->i]) {
+                pruned->utility->utility->content[data->i] = 0.0;
+                computeKLUtilityAt(pruned->utility, data->i, data->evidence_ref, data->bp);
+        }
         return NULL;
 }
 
@@ -458,7 +618,37 @@ void computeKLUtility(
         prob_t evidence_ref,
         binData* bd)
 {
-        /* compute utilities */
-        threaded_computation((void *)result, evidence_ref, bd, computeKLUtility_thread,
-                             "Computing utility: %.1f%%");
+        pruned_utility_t pruned;
+        int candidates[bd->L];
+
+        if (bd->options->prune) {
+                /* compute bounds and evaluate the exact utility only
+                 * where it might be maximal */
+                computeKLUtilityBounds(result, candidates, evidence_ref, bd);
+                pruned.utility    = result;
+                pruned.candidates = candidates;
+                threaded_computation((void *)&pruned, evidence_ref, bd, computePrunedKLUtility_thread,
+                                     "kl-utility", "Computing utility: %.1f%%");
+        }
+        else {
+                /* compute utilities */
+                threaded_computation((void *)result, evidence_ref, bd, computeKLUtility_thread,
+                                     "kl-utility", "Computing utility: %.1f%%");
+        }
+}
+
+void computeUtility(utility_t *result, prob_t evidence_ref, binData* bd)
+{
+        /* compute kl-divergence */
+        if (bd->options->kl_psi || bd->options->kl_multibin) {
+                computeKLUtility(result, evidence_ref, bd);
+        }
+        /* compute effective counts */
+        else if (bd->options->effective_counts) {
+                computeEffectiveCountsUtility(result, evidence_ref, bd);
+        }
+        /* compute effective posterior counts */
+        else if (bd->options->effective_posterior_counts) {
+                computeEffectivePosteriorCountsUtility(result, evidence_ref, bd);
+        }
 }
@@ -24,6 +24,10 @@
 
 #include <adaptive-sampling/datatypes.h>
 
+void computeUtility(
+        utility_t *result,
+        prob_t evidence_ref,
+        binData *bd);
 void computeKLUtility(
         utility_t *result,
         prob_t evidence_ref,